@@ -0,0 +1,364 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014 <tsujan2000@gmail.com>
+ *
+ * FeatherPad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FeatherPad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bracketindex.h"
+#include "highlighter.h"
+#include <QTextDocument>
+#include <QTextBlock>
+
+namespace FeatherPad {
+
+BracketIndex::BracketIndex (QTextDocument *doc) :
+    doc_ (doc),
+    root_ (-1),
+    count_ (-1), // not built yet
+    seed_ (2463534242u)
+{
+}
+/*************************/
+int BracketIndex::kindOf (char c)
+{
+    switch (c) {
+    case '(': case ')':
+        return parenthesis;
+    case '{': case '}':
+        return brace;
+    case '[': case ']':
+        return squareBracket;
+    default:
+        return -1;
+    }
+}
+/*************************/
+BracketIndex::Depths BracketIndex::summarize (const QTextBlock &block)
+{
+    Depths node;
+    TextBlockData *data = static_cast<TextBlockData *>(block.userData());
+    if (!data) return node;
+    const TextBlockData::Brackets &brackets = data->brackets();
+    for (int i = 0; i < brackets.size(); ++i)
+    {
+        const char c = brackets.at (i).character;
+        const int k = kindOf (c);
+        if (k == -1) continue;
+        Summary &s = node.kinds[k];
+        if (c == '(' || c == '{' || c == '[')
+            ++ s.sum;
+        else
+        {
+            -- s.sum;
+            s.minPrefix = qMin (s.minPrefix, s.sum);
+        }
+    }
+    /* the highest depth to the end is the net depth minus the lowest depth from the start */
+    for (int k = 0; k < kindCount; ++k)
+    {
+        Summary &s = node.kinds[k];
+        s.maxSuffix = s.sum - s.minPrefix;
+    }
+    return node;
+}
+/*************************/
+BracketIndex::Depths BracketIndex::combine (const Depths &left, const Depths &right)
+{
+    Depths node;
+    for (int k = 0; k < kindCount; ++k)
+    {
+        const Summary &l = left.kinds[k];
+        const Summary &r = right.kinds[k];
+        Summary &s = node.kinds[k];
+        s.sum = l.sum + r.sum;
+        s.minPrefix = qMin (l.minPrefix, l.sum + r.minPrefix);
+        s.maxSuffix = qMax (r.maxSuffix, r.sum + l.maxSuffix);
+    }
+    return node;
+}
+/*************************/
+int BracketIndex::newItem (const Depths &depths)
+{
+    /* xorshift is enough for the priorities */
+    seed_ ^= seed_ << 13;
+    seed_ ^= seed_ >> 17;
+    seed_ ^= seed_ << 5;
+    Item item;
+    item.own = item.all = depths;
+    item.left = item.right = -1;
+    item.size = 1;
+    item.priority = seed_;
+    if (!free_.isEmpty())
+    {
+        const int t = free_.takeLast();
+        items_[t] = item;
+        return t;
+    }
+    items_.append (item);
+    return items_.size() - 1;
+}
+/*************************/
+void BracketIndex::release (int t)
+{
+    if (t == -1) return;
+    release (items_.at (t).left);
+    release (items_.at (t).right);
+    free_.append (t);
+}
+/*************************/
+// Updates the subtree data of an item from its children.
+void BracketIndex::pull (int t)
+{
+    Item &item = items_[t];
+    item.size = 1;
+    item.all = item.own;
+    if (item.left != -1)
+    {
+        item.size += items_.at (item.left).size;
+        item.all = combine (items_.at (item.left).all, item.all);
+    }
+    if (item.right != -1)
+    {
+        item.size += items_.at (item.right).size;
+        item.all = combine (item.all, items_.at (item.right).all);
+    }
+}
+/*************************/
+void BracketIndex::pullAll (int t)
+{
+    if (t == -1) return;
+    pullAll (items_.at (t).left);
+    pullAll (items_.at (t).right);
+    pull (t);
+}
+/*************************/
+// Builds a treap of "count" blocks, starting from "block", in linear time
+// (as a Cartesian tree, whose right spine is kept in a stack).
+int BracketIndex::build (QTextBlock block, int count)
+{
+    QVector<int> spine;
+    for (int i = 0; i < count && block.isValid(); ++i, block = block.next())
+    {
+        const int t = newItem (summarize (block));
+        int last = -1;
+        while (!spine.isEmpty() && items_.at (spine.last()).priority < items_.at (t).priority)
+            last = spine.takeLast();
+        items_[t].left = last;
+        if (!spine.isEmpty())
+            items_[spine.last()].right = t;
+        spine.append (t);
+    }
+    if (spine.isEmpty()) return -1;
+    pullAll (spine.first());
+    return spine.first();
+}
+/*************************/
+int BracketIndex::merge (int a, int b)
+{
+    if (a == -1) return b;
+    if (b == -1) return a;
+    if (items_.at (a).priority > items_.at (b).priority)
+    {
+        const int right = merge (items_.at (a).right, b);
+        items_[a].right = right;
+        pull (a);
+        return a;
+    }
+    const int left = merge (a, items_.at (b).left);
+    items_[b].left = left;
+    pull (b);
+    return b;
+}
+/*************************/
+// Splits a treap into its first "k" blocks and the rest.
+void BracketIndex::split (int t, int k, int &a, int &b)
+{
+    if (t == -1)
+    {
+        a = b = -1;
+        return;
+    }
+    const int left = items_.at (t).left;
+    const int leftSize = left == -1 ? 0 : items_.at (left).size;
+    int l, r;
+    if (k <= leftSize)
+    {
+        split (left, k, l, r);
+        items_[t].left = r;
+        a = l;
+        b = t;
+    }
+    else
+    {
+        split (items_.at (t).right, k - leftSize - 1, l, r);
+        items_[t].right = l;
+        a = t;
+        b = r;
+    }
+    pull (t);
+}
+/*************************/
+void BracketIndex::setLeaf (int t, int n, const Depths &depths)
+{
+    const int left = items_.at (t).left;
+    const int leftSize = left == -1 ? 0 : items_.at (left).size;
+    if (n < leftSize)
+        setLeaf (left, n, depths);
+    else if (n == leftSize)
+        items_[t].own = depths;
+    else
+        setLeaf (items_.at (t).right, n - leftSize - 1, depths);
+    pull (t);
+}
+/*************************/
+void BracketIndex::rebuild()
+{
+    items_.clear();
+    free_.clear();
+    pending_.clear();
+    count_ = doc_->blockCount();
+    root_ = build (doc_->firstBlock(), count_);
+}
+/*************************/
+void BracketIndex::sync()
+{
+    if (count_ != doc_->blockCount())
+        rebuild();
+}
+/*************************/
+void BracketIndex::update (const QTextBlock &block)
+{
+    if (count_ < 0) return; // the treap will be built when needed
+    const int n = block.blockNumber();
+    if (count_ != doc_->blockCount())
+    { // the block is highlighted before contentsChange() is called
+        pending_.append (n);
+        return;
+    }
+    if (n >= 0 && n < count_)
+        setLeaf (root_, n, summarize (block));
+}
+/*************************/
+// The blocks of the changed range replace the old ones, whose number is found
+// from the difference of the block counts. Then, the blocks that were updated
+// before this call (in the rehighlighting of the change) are updated again.
+void BracketIndex::contentsChange (int position, int charsRemoved, int charsAdded)
+{
+    Q_UNUSED (charsRemoved);
+    if (count_ < 0) return;
+    const int newCount = doc_->blockCount();
+    const int first = doc_->findBlock (position).blockNumber();
+    const int last = doc_->findBlock (qMin (position + charsAdded, doc_->characterCount() - 1)).blockNumber();
+    const int oldSpan = last - first + 1 + count_ - newCount;
+    if (first < 0 || last < first || oldSpan < 1 || first + oldSpan > count_)
+    { // impossible
+        count_ = -1;
+        pending_.clear();
+        return;
+    }
+
+    int a, b, c;
+    split (root_, first, a, b);
+    split (b, oldSpan, b, c);
+    release (b);
+    b = build (doc_->findBlockByNumber (first), last - first + 1);
+    root_ = merge (merge (a, b), c);
+    count_ = newCount;
+
+    for (int i = 0; i < pending_.size(); ++i)
+    {
+        const int n = pending_.at (i);
+        if (n >= 0 && n < count_ && (n < first || n > last))
+            setLeaf (root_, n, summarize (doc_->findBlockByNumber (n)));
+    }
+    pending_.clear();
+}
+/*************************/
+// Finds the first block of the subtree (whose first block is "lo") that isn't
+// before "from" and in which the depth reaches zero.
+int BracketIndex::descendForward (int t, int lo, int from, int kind, int &depth) const
+{
+    if (t == -1) return -1;
+    const Item &item = items_.at (t);
+    if (lo + item.size <= from) return -1;
+    const Summary &s = item.all.kinds[kind];
+    if (lo >= from && depth + s.minPrefix > 0)
+    { // the whole subtree can be skipped
+        depth += s.sum;
+        return -1;
+    }
+    int res = descendForward (item.left, lo, from, kind, depth);
+    if (res != -1) return res;
+    const int n = lo + (item.left == -1 ? 0 : items_.at (item.left).size);
+    if (n >= from)
+    {
+        const Summary &own = item.own.kinds[kind];
+        if (depth + own.minPrefix <= 0)
+            return n;
+        depth += own.sum;
+    }
+    return descendForward (item.right, n + 1, from, kind, depth);
+}
+/*************************/
+// Finds the last block of the subtree (whose first block is "lo") that isn't
+// after "to" and in which the depth reaches zero backward.
+int BracketIndex::descendBackward (int t, int lo, int to, int kind, int &depth) const
+{
+    if (t == -1) return -1;
+    const Item &item = items_.at (t);
+    if (lo > to) return -1;
+    const Summary &s = item.all.kinds[kind];
+    if (lo + item.size - 1 <= to && depth - s.maxSuffix > 0)
+    {
+        depth -= s.sum;
+        return -1;
+    }
+    const int n = lo + (item.left == -1 ? 0 : items_.at (item.left).size);
+    int res = descendBackward (item.right, n + 1, to, kind, depth);
+    if (res != -1) return res;
+    if (n <= to)
+    {
+        const Summary &own = item.own.kinds[kind];
+        if (depth - own.maxSuffix <= 0)
+            return n;
+        depth -= own.sum;
+    }
+    return descendBackward (item.left, lo, to, kind, depth);
+}
+/*************************/
+QTextBlock BracketIndex::findForward (const QTextBlock &block, Kind kind, int &depth)
+{
+    sync();
+    const int from = block.blockNumber() + 1;
+    if (depth <= 0 || from <= 0 || from >= count_)
+        return QTextBlock();
+    const int n = descendForward (root_, 0, from, kind, depth);
+    if (n == -1)
+        return QTextBlock();
+    return doc_->findBlockByNumber (n);
+}
+/*************************/
+QTextBlock BracketIndex::findBackward (const QTextBlock &block, Kind kind, int &depth)
+{
+    sync();
+    const int to = block.blockNumber() - 1;
+    if (depth <= 0 || to < 0 || to >= count_)
+        return QTextBlock();
+    const int n = descendBackward (root_, 0, to, kind, depth);
+    if (n == -1)
+        return QTextBlock();
+    return doc_->findBlockByNumber (n);
+}
+
+}
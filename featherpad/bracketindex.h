@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014 <tsujan2000@gmail.com>
+ *
+ * FeatherPad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FeatherPad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BRACKETINDEX_H
+#define BRACKETINDEX_H
+
+#include <QVector>
+
+class QTextDocument;
+class QTextBlock;
+
+namespace FeatherPad {
+
+/* An index of the nesting depths of parentheses, braces and square brackets
+   over the blocks of a document, so that the block of a matching bracket can
+   be found in logarithmic time, however far it may be.
+
+   For each kind of bracket, a block is summarized by its net depth (opening
+   minus closing brackets), the lowest depth reached inside it and the highest
+   depth from any of its points to its end. The summaries are kept in a treap
+   that is ordered by the block numbers (implicitly, by its subtree sizes), so
+   that a block can be updated when it's highlighted and the blocks of an edited
+   range can be replaced, both in logarithmic time (plus the edited blocks). */
+class BracketIndex
+{
+public:
+    enum Kind {
+        parenthesis = 0,
+        brace,
+        squareBracket,
+        kindCount
+    };
+
+    BracketIndex (QTextDocument *doc);
+
+    /* the kind of a bracket character, or -1 */
+    static int kindOf (char c);
+
+    /* should be called when the brackets of a block are changed */
+    void update (const QTextBlock &block);
+    /* should be called after the contents of the document are changed */
+    void contentsChange (int position, int charsRemoved, int charsAdded);
+
+    /* The first block after "block" in which the closing bracket of "kind" is
+       found when "depth" brackets are open at the start of the next block.
+       On returning, "depth" is the number of open brackets at the start of
+       the found block. An invalid block is returned if there's no match. */
+    QTextBlock findForward (const QTextBlock &block, Kind kind, int &depth);
+    /* The last block before "block" in which the opening bracket of "kind" is
+       found when "depth" brackets are closed after the end of the previous
+       block. On returning, "depth" is the number of closed brackets after the
+       end of the found block. */
+    QTextBlock findBackward (const QTextBlock &block, Kind kind, int &depth);
+
+private:
+    struct Summary
+    {
+        Summary() : sum (0), minPrefix (0), maxSuffix (0) {}
+        int sum; // opening minus closing brackets
+        int minPrefix; // the lowest depth from the start (<= 0)
+        int maxSuffix; // the highest depth from a point to the end (>= 0)
+    };
+    struct Depths
+    {
+        Summary kinds[kindCount];
+    };
+    struct Item
+    {
+        Depths own; // of this block
+        Depths all; // of the blocks of the subtree
+        int left; // -1 if there's none
+        int right;
+        int size; // the number of blocks in the subtree
+        quint32 priority; // greater than those of the children
+    };
+
+    static Depths summarize (const QTextBlock &block);
+    static Depths combine (const Depths &left, const Depths &right);
+    void rebuild();
+    void sync();
+    int newItem (const Depths &depths);
+    void release (int t);
+    void pull (int t);
+    void pullAll (int t);
+    int build (QTextBlock block, int count);
+    int merge (int a, int b);
+    void split (int t, int k, int &a, int &b);
+    void setLeaf (int t, int n, const Depths &depths);
+    int descendForward (int t, int lo, int from, int kind, int &depth) const;
+    int descendBackward (int t, int lo, int to, int kind, int &depth) const;
+
+    QTextDocument *doc_;
+    QVector<Item> items_; // the pool of the treap's items
+    QVector<int> free_; // the released items
+    int root_; // -1 if the treap is empty
+    int count_; // the number of blocks in the treap (-1 if it should be rebuilt)
+    QVector<int> pending_; // the blocks that were updated before the last change was seen
+    quint32 seed_; // for the priorities
+};
+
+}
+
+#endif // BRACKETINDEX_H
@@ -44,179 +44,116 @@ void FPwin::matchBrackets()
     /* position of cursor in block */
     int curBlockPos = textEdit->textCursor().position() - blockPos;
 
-    /* parenthesis */
-    QVector<ParenthesisInfo *> infos = data->parentheses();
-    for (int i = 0; i < infos.size(); ++i)
-    {
-        ParenthesisInfo *info = infos.at (i);
-
-        if (info->position == curBlockPos && info->character == '(')
-        {
-            if (matchLeftParenthesis (textEdit->textCursor().block(), i + 1, 0))
-            {
-                createSelection (blockPos + info->position);
-                break;
-            }
-        }
-        else if (info->position == curBlockPos - 1 && info->character == ')')
-        {
-            if (matchRightParenthesis (textEdit->textCursor().block(), infos.size() - i, 0))
-            {
-                createSelection (blockPos + info->position);
-                break;
-            }
-        }
-    }
+    Highlighter *highlighter = qobject_cast< Highlighter *>(textEdit->getHighlighter());
+    if (!highlighter) return;
 
-    /* bracket */
-    QVector<BraceInfo *> braceInfos = data->braces();
-    for (int i = 0; i < braceInfos.size(); ++i)
+    /* parentheses, braces and square brackets (a bracket of each kind may be matched) */
+    bool matched[BracketIndex::kindCount] = {false, false, false};
+    const TextBlockData::Brackets &infos = data->brackets();
+    for (int i = 0; i < infos.size(); ++i)
     {
-        BraceInfo *info = braceInfos.at (i);
+        const BracketInfo &info = infos.at (i);
+        const int kind = BracketIndex::kindOf (info.character);
+        if (kind == -1 || matched[kind]) continue;
 
-        if (info->position == curBlockPos && info->character == '{')
+        if (info.position == curBlockPos
+            && (info.character == '(' || info.character == '{' || info.character == '['))
         {
-            if (matchLeftBrace (textEdit->textCursor().block(), i + 1, 0))
+            if (matchLeftBracket (highlighter, textEdit->textCursor().block(), i))
             {
-                createSelection (blockPos + info->position);
-                break;
+                createSelection (blockPos + info.position);
+                matched[kind] = true;
             }
         }
-        else if (info->position == curBlockPos - 1 && info->character == '}')
+        else if (info.position == curBlockPos - 1
+                 && (info.character == ')' || info.character == '}' || info.character == ']'))
         {
-            if (matchRightBrace (textEdit->textCursor().block(), braceInfos.size() - i, 0))
+            if (matchRightBracket (highlighter, textEdit->textCursor().block(), i))
             {
-                createSelection (blockPos + info->position);
-                break;
+                createSelection (blockPos + info.position);
+                matched[kind] = true;
             }
         }
     }
 }
 /*************************/
-bool FPwin::matchLeftParenthesis (QTextBlock currentBlock, int i, int numLeftParentheses)
+// Finds the partner of an opening bracket after the index "from" of a block's brackets,
+// with "depth" open brackets. Returns its index or -1 (in which case, "depth" is updated).
+static int scanForward (const TextBlockData::Brackets &infos, int from, char left, char right, int &depth)
 {
-    TextBlockData *data = static_cast<TextBlockData *>(currentBlock.userData());
-    if (!data) return false;
-    QVector<ParenthesisInfo *> infos = data->parentheses();
-
-    int docPos = currentBlock.position();
-    for (; i < infos.size(); ++i)
+    for (int i = from; i < infos.size(); ++i)
     {
-        ParenthesisInfo *info = infos.at (i);
-        if (info->character == '(')
-        {
-            ++numLeftParentheses;
-            continue;
-        }
-
-        if (info->character == ')' && numLeftParentheses == 0)
-        {
-            createSelection (docPos + info->position);
-            return true;
-        }
-        else
-            --numLeftParentheses;
+        const char c = infos.at (i).character;
+        if (c == left)
+            ++ depth;
+        else if (c == right && -- depth == 0)
+            return i;
     }
-
-    currentBlock = currentBlock.next();
-    if (currentBlock.isValid())
-        return matchLeftParenthesis (currentBlock, 0, numLeftParentheses);
-
-    return false;
+    return -1;
 }
 /*************************/
-bool FPwin::matchRightParenthesis (QTextBlock currentBlock, int i, int numRightParentheses)
+// The same as scanForward() but backward, with "depth" closed brackets.
+static int scanBackward (const TextBlockData::Brackets &infos, int from, char left, char right, int &depth)
 {
-    TextBlockData *data = static_cast<TextBlockData *>(currentBlock.userData());
-    if (!data) return false;
-    QVector<ParenthesisInfo *> infos = data->parentheses();
-
-    int docPos = currentBlock.position();
-    for (; i < infos.size(); ++i)
+    for (int i = from; i >= 0; --i)
     {
-        ParenthesisInfo *info = infos.at (infos.size() - 1 - i);
-        if (info->character == ')')
-        {
-            ++numRightParentheses;
-            continue;
-        }
-        if (info->character == '(' && numRightParentheses == 0)
-        {
-            createSelection (docPos + info->position);
-            return true;
-        }
-        else
-            --numRightParentheses;
+        const char c = infos.at (i).character;
+        if (c == right)
+            ++ depth;
+        else if (c == left && -- depth == 0)
+            return i;
     }
-
-    currentBlock = currentBlock.previous();
-    if (currentBlock.isValid())
-        return matchRightParenthesis (currentBlock, 0, numRightParentheses);
-
-    return false;
+    return -1;
 }
 /*************************/
-bool FPwin::matchLeftBrace (QTextBlock currentBlock, int i, int numRightBraces)
+// Selects the closing partner of the opening bracket at the index "i" of the block's brackets.
+// Instead of walking over the next blocks, the block of the partner is found by the index.
+// Nothing is selected if a block on the way isn't highlighted yet because its brackets
+// aren't known.
+bool FPwin::matchLeftBracket (Highlighter *highlighter, QTextBlock block, int i)
 {
-    TextBlockData *data = static_cast<TextBlockData *>(currentBlock.userData());
+    TextBlockData *data = static_cast<TextBlockData *>(block.userData());
     if (!data) return false;
-    QVector<BraceInfo *> infos = data->braces();
+    const char left = data->brackets().at (i).character;
+    const char right = left == '(' ? ')' : left == '{' ? '}' : ']';
 
-    int docPos = currentBlock.position();
-    for (; i < infos.size(); ++i)
+    int depth = 1;
+    int indx = scanForward (data->brackets(), i + 1, left, right, depth);
+    if (indx == -1)
     {
-        BraceInfo *info = infos.at (i);
-        if (info->character == '{')
-        {
-            ++numRightBraces;
-            continue;
-        }
-
-        if (info->character == '}' && numRightBraces == 0)
-        {
-            createSelection (docPos + info->position);
-            return true;
-        }
-        else
-            --numRightBraces;
+        const int first = block.blockNumber();
+        block = highlighter->bracketIndex().findForward (block, static_cast<BracketIndex::Kind>(BracketIndex::kindOf (left)), depth);
+        if (!block.isValid() || !highlighter->isCaughtUp (first, block.blockNumber())) return false;
+        data = static_cast<TextBlockData *>(block.userData());
+        if (!data) return false;
+        indx = scanForward (data->brackets(), 0, left, right, depth);
+        if (indx == -1) return false; // impossible
     }
-
-    currentBlock = currentBlock.next();
-    if (currentBlock.isValid())
-        return matchLeftBrace (currentBlock, 0, numRightBraces);
-
-    return false;
+    createSelection (block.position() + data->brackets().at (indx).position);
+    return true;
 }
 /*************************/
-bool FPwin::matchRightBrace (QTextBlock currentBlock, int i, int numLeftBraces)
+bool FPwin::matchRightBracket (Highlighter *highlighter, QTextBlock block, int i)
 {
-    TextBlockData *data = static_cast<TextBlockData *>(currentBlock.userData());
+    TextBlockData *data = static_cast<TextBlockData *>(block.userData());
     if (!data) return false;
-    QVector<BraceInfo *> infos = data->braces();
+    const char right = data->brackets().at (i).character;
+    const char left = right == ')' ? '(' : right == '}' ? '{' : '[';
 
-    int docPos = currentBlock.position();
-    for (; i < infos.size(); ++i)
+    int depth = 1;
+    int indx = scanBackward (data->brackets(), i - 1, left, right, depth);
+    if (indx == -1)
     {
-        BraceInfo *info = infos.at (infos.size() - 1 - i);
-        if (info->character == '}')
-        {
-            ++numLeftBraces;
-            continue;
-        }
-        if (info->character == '{' && numLeftBraces == 0)
-        {
-            createSelection (docPos + info->position);
-            return true;
-        }
-        else
-            --numLeftBraces;
+        const int last = block.blockNumber();
+        block = highlighter->bracketIndex().findBackward (block, static_cast<BracketIndex::Kind>(BracketIndex::kindOf (right)), depth);
+        if (!block.isValid() || !highlighter->isCaughtUp (block.blockNumber(), last)) return false;
+        data = static_cast<TextBlockData *>(block.userData());
+        if (!data) return false;
+        indx = scanBackward (data->brackets(), data->brackets().size() - 1, left, right, depth);
+        if (indx == -1) return false; // impossible
     }
-
-    currentBlock = currentBlock.previous();
-    if (currentBlock.isValid())
-        return matchRightBrace (currentBlock, 0, numLeftBraces);
-
-    return false;
+    createSelection (block.position() + data->brackets().at (indx).position);
+    return true;
 }
 /*************************/
 void FPwin::createSelection (int pos)
@@ -47,6 +47,7 @@ Config::Config():
     darkBgColorValue_ (15),
     recentFilesNumber_ (10),
     curRecentFilesNumber_ (10), // not needed
+    charsetSampleSize_ (384),
     winSize_ (QSize (700, 500)),
     startSize_ (QSize (700, 500)),
     font_ (QFont ("Monospace", 9)),
@@ -146,6 +147,9 @@ void Config::readConfig()
 
     maxSHSize_ = qBound (1, settings.value ("maxSHSize", 2).toInt(), 10);
 
+    /* the charset of a big file is guessed from a sample of its head, middle and tail */
+    charsetSampleSize_ = qBound (0, settings.value ("charsetSampleSize", 384).toInt(), 65536);
+
     /* don't let the dark bg be darker than #e6e6e6 */
     lightBgColorValue_ = qBound (230, settings.value ("lightBgColorValue", 255).toInt(), 255);
 
@@ -229,6 +233,7 @@ void Config::writeConfig()
     settings.setValue ("darkColorScheme", darkColScheme_);
     settings.setValue ("scrollJumpWorkaround", scrollJumpWorkaround_);
     settings.setValue ("maxSHSize", maxSHSize_);
+    settings.setValue ("charsetSampleSize", charsetSampleSize_);
 
     settings.setValue ("lightBgColorValue", lightBgColorValue_);
     settings.setValue ("darkBgColorValue", darkBgColorValue_);
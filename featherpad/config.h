@@ -225,6 +225,10 @@ public:
         maxSHSize_ = max;
     }
 
+    int getCharsetSampleSize() const {
+        return charsetSampleSize_;
+    }
+
     bool getScrollJumpWorkaround() const {
         return scrollJumpWorkaround_;
     }
@@ -283,6 +287,7 @@ private:
          scrollJumpWorkaround_; // Should a workaround for Qt5's "scroll jump" bug be applied?
     int tabPosition_, maxSHSize_, lightBgColorValue_, darkBgColorValue_, recentFilesNumber_;
     int curRecentFilesNumber_; // the start value of recentFilesNumber_ -- fixed during a session
+    int charsetSampleSize_; // in KiB -- not in Preferences; 0 means that the whole text is checked
     QSize winSize_, startSize_;
     QFont font_;
     QString executeCommand_;
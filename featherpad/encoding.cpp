@@ -10,6 +10,12 @@
 #include <langinfo.h> // CODESET, nl_langinfo
 #include <stdint.h> // uint8_t, uint32_t
 #include <locale.h> // needed by FreeBSD for setlocale
+#include <string.h> // memchr, memcpy
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 #include "encoding.h"
 
 namespace FeatherPad {
@@ -134,9 +140,16 @@ static const std::string encodingItem[ENCODING_MAX_ITEM_NUM] = {encodingTable[lo
                                                                 encodingTable[localeNum][1],
                                                                 encodingTable[localeNum][2]};
 /*************************/
-static const std::string detectCharsetLatin (const char *text)
+/* The buffer may not be null-terminated (it may be a memory-mapped file),
+   so the end is always checked. A null byte is returned at the end. */
+static inline uint8_t nextByte (const char *&text, const char *end)
 {
-    uint8_t c = *text;
+    return text < end ? static_cast<uint8_t>(*text++) : '\0';
+}
+/*************************/
+static const std::string detectCharsetLatin (const char *text, const char *end)
+{
+    uint8_t c = text < end ? static_cast<uint8_t>(*text) : '\0';
     bool noniso = false;
     bool noniso15 = false;
     uint32_t xl = 0, xa = 0, xac = 0, xcC = 0, xcC1 = 0, xcS = 0, xcna = 0;
@@ -182,7 +195,7 @@ static const std::string detectCharsetLatin (const char *text)
                     xa++;
             }
         }
-        c = *text++;
+        c = nextByte (text, end);
     }
 
     /* when there is a difference fom ISO-8859-1 and ISO-8859-15,
@@ -214,9 +227,9 @@ static const std::string detectCharsetLatin (const char *text)
     return charset;
 }
 /*************************/
-static const std::string detectCharsetCyrillic (const char *text)
+static const std::string detectCharsetCyrillic (const char *text, const char *end)
 {
-    uint8_t c = *text;
+    uint8_t c = text < end ? static_cast<uint8_t>(*text) : '\0';
     bool noniso = false;
     uint32_t xl = 0, xa = 0, xac = 0, xcC = 0, xcC1 = 0, xcS = 0, xcna = 0;
     std::string charset = encodingItem[OPENI18N];
@@ -246,7 +259,7 @@ static const std::string detectCharsetCyrillic (const char *text)
                     xa++;
             }
         }
-        c = *text++;
+        c = nextByte (text, end);
     }
 
     if (xl < xac)
@@ -264,9 +277,9 @@ static const std::string detectCharsetCyrillic (const char *text)
     return charset;
 }
 /*************************/
-static const std::string detectCharsetWinArabic (const char *text)
+static const std::string detectCharsetWinArabic (const char *text, const char *end)
 {
-    uint8_t c = *text;
+    uint8_t c = text < end ? static_cast<uint8_t>(*text) : '\0';
     uint32_t xl = 0, xa = 0;
     std::string charset = encodingItem[IANA];
 
@@ -276,7 +289,7 @@ static const std::string detectCharsetWinArabic (const char *text)
             xl ++;
         else if (c >= 0xC0)
             xa ++;
-        c = *text++;
+        c = nextByte (text, end);
     }
 
     if (xl < xa)
@@ -285,12 +298,12 @@ static const std::string detectCharsetWinArabic (const char *text)
     return charset;
 }
 /*************************/
-static const std::string detectCharsetChinese (const char *text)
+static const std::string detectCharsetChinese (const char *text, const char *end)
 {
-    uint8_t c = *text;
+    uint8_t c = text < end ? static_cast<uint8_t>(*text) : '\0';
     std::string charset = encodingItem[IANA];
 
-    while ((c = *text++) != '\0')
+    while ((c = nextByte (text, end)) != '\0')
     {
         if (c >= 0x81 && c <= 0x87)
         {
@@ -299,7 +312,7 @@ static const std::string detectCharsetChinese (const char *text)
         }
         else if (c >= 0x88 && c <= 0xA0)
         {
-            c = *text++;
+            c = nextByte (text, end);
             if ((c >= 0x30 && c <= 0x39) || (c >= 0x80 && c <= 0xA0))
             {
                 charset = "GB18030";
@@ -308,7 +321,7 @@ static const std::string detectCharsetChinese (const char *text)
         }
         else if ((c >= 0xA1 && c <= 0xC6) || (c >= 0xC9 && c <= 0xF9))
         {
-            c = *text++;
+            c = nextByte (text, end);
             if (c >= 0x40 && c <= 0x7E)
                 charset = "BIG5";
             else if ((c >= 0x30 && c <= 0x39) || (c >= 0x80 && c <= 0xA0))
@@ -319,7 +332,7 @@ static const std::string detectCharsetChinese (const char *text)
         }
         else if (c >= 0xC7)
         {
-            c = *text++;
+            c = nextByte (text, end);
             if ((c >= 0x30 && c <= 0x39) || (c >= 0x80 && c <= 0xA0))
             {
                 charset = "GB18030";
@@ -331,24 +344,24 @@ static const std::string detectCharsetChinese (const char *text)
     return charset;
 }
 /*************************/
-static const std::string detectCharsetJapanese (const char *text)
+static const std::string detectCharsetJapanese (const char *text, const char *end)
 {
-    uint8_t c = *text;
+    uint8_t c = text < end ? static_cast<uint8_t>(*text) : '\0';
     std::string charset = "";
 
-    while (charset.empty() && (c = *text++) != '\0')
+    while (charset.empty() && (c = nextByte (text, end)) != '\0')
     {
         if (c >= 0x81 && c <= 0x9F)
         {
             if (c == 0x8E) /* SS2 */
             {
-                c = *text++;
+                c = nextByte (text, end);
                 if ((c >= 0x40 && c <= 0xA0) || (c >= 0xE0 && c <= 0xFC))
                     charset = "CP932";
             }
             else if (c == 0x8F) /* SS3 */
             {
-                c = *text++;
+                c = nextByte (text, end);
                 if (c >= 0x40 && c <= 0xA0)
                     charset = "CP932";
                 else if (c >= 0xFD)
@@ -359,7 +372,7 @@ static const std::string detectCharsetJapanese (const char *text)
         }
         else if (c >= 0xA1 && c <= 0xDF)
         {
-            c = *text++;
+            c = nextByte (text, end);
             if (c <= 0x9F)
                 charset = "CP932";
             else if (c >= 0xFD)
@@ -367,7 +380,7 @@ static const std::string detectCharsetJapanese (const char *text)
         }
         else if (c >= 0xE0 && c <= 0xEF)
         {
-            c = *text++;
+            c = nextByte (text, end);
             if (c >= 0x40 && c <= 0xA0)
                 charset = "CP932";
             else if (c >= 0xFD)
@@ -383,14 +396,14 @@ static const std::string detectCharsetJapanese (const char *text)
     return charset;
 }
 /*************************/
-static const std::string detectCharsetKorean (const char *text)
+static const std::string detectCharsetKorean (const char *text, const char *end)
 {
-    uint8_t c = *text;
+    uint8_t c = text < end ? static_cast<uint8_t>(*text) : '\0';
     bool noneuc = false;
     bool nonjohab = false;
     std::string charset = "";
 
-    while (charset.empty() && (c = *text++) != '\0')
+    while (charset.empty() && (c = nextByte (text, end)) != '\0')
     {
         if (c >= 0x81 && c < 0x84)
         {
@@ -399,7 +412,7 @@ static const std::string detectCharsetKorean (const char *text)
         else if (c >= 0x84 && c < 0xA1)
         {
             noneuc = true;
-            c = *text++;
+            c = nextByte (text, end);
             if ((c > 0x5A && c < 0x61) || (c > 0x7A && c < 0x81))
                 charset = "CP1361";
             else if (c == 0x52 || c == 0x72 || c == 0x92 || (c > 0x9D && c < 0xA1)
@@ -409,7 +422,7 @@ static const std::string detectCharsetKorean (const char *text)
         }
         else if (c >= 0xA1 && c <= 0xC6)
         {
-            c = *text++;
+            c = nextByte (text, end);
             if (c < 0xA1)
             {
                 noneuc = true;
@@ -424,18 +437,18 @@ static const std::string detectCharsetKorean (const char *text)
         }
         else if (c > 0xC6 && c <= 0xD3)
         {
-            c = *text++;
+            c = nextByte (text, end);
             if (c < 0xA1)
                 charset = "CP1361";
         }
         else if (c > 0xD3 && c < 0xD8)
         {
             nonjohab = true;
-            c = *text++;
+            c = nextByte (text, end);
         }
         else if (c >= 0xD8)
         {
-            c = *text++;
+            c = nextByte (text, end);
             if (c < 0xA1)
                 charset = "CP1361";
         }
@@ -465,11 +478,11 @@ static const std::string getDefaultCharset()
     return charset;
 }
 /*************************/
-static bool detect_noniso (const char *text)
+static bool detect_noniso (const char *text, const char *end)
 {
-    uint8_t c = *text;
+    uint8_t c = text < end ? static_cast<uint8_t>(*text) : '\0';
 
-    while ((c = *text++) != '\0')
+    while ((c = nextByte (text, end)) != '\0')
     {
         if (c >= 0x80 && c <= 0x9F)
             return true;
@@ -477,121 +490,271 @@ static bool detect_noniso (const char *text)
     return false;
 }
 /*************************/
-/* In the GTK+ version, I used g_utf8_validate()
-   but this function validates UTF-8 directly
-   and seems faster than using QTextCodec::ConverterState
-   with QTextCodec::toUnicode(), which may give incorrect results. */
-bool validateUTF8 (const QByteArray byteArray)
+/* Skip the ASCII bytes that are neither null nor ESC. With SSE2 or AVX2,
+   16 or 32 bytes are checked at once; otherwise, 8 bytes are checked
+   at once by using bitwise operations on 64-bit words. */
+static inline const unsigned char* skipPlainAscii (const unsigned char *p, const unsigned char *end)
+{
+#if defined(__AVX2__)
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i esc = _mm256_set1_epi8 (0x1B);
+    while (end - p >= 32)
+    {
+        __m256i v = _mm256_loadu_si256 (reinterpret_cast<const __m256i*>(p));
+        unsigned int mask = static_cast<unsigned int>(_mm256_movemask_epi8 (v)
+                                                      | _mm256_movemask_epi8 (_mm256_cmpeq_epi8 (v, zero))
+                                                      | _mm256_movemask_epi8 (_mm256_cmpeq_epi8 (v, esc)));
+        if (mask != 0)
+            return p + __builtin_ctz (mask);
+        p += 32;
+    }
+#elif defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i esc = _mm_set1_epi8 (0x1B);
+    while (end - p >= 16)
+    {
+        __m128i v = _mm_loadu_si128 (reinterpret_cast<const __m128i*>(p));
+        unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8 (v)
+                                                      | _mm_movemask_epi8 (_mm_cmpeq_epi8 (v, zero))
+                                                      | _mm_movemask_epi8 (_mm_cmpeq_epi8 (v, esc)));
+        if (mask != 0)
+            return p + __builtin_ctz (mask);
+        p += 16;
+    }
+#else
+    const uint64_t ones = 0x0101010101010101ULL;
+    const uint64_t highs = 0x8080808080808080ULL;
+    while (end - p >= 8)
+    {
+        uint64_t w;
+        memcpy (&w, p, 8);
+        uint64_t e = w ^ (ones * 0x1B);
+        /* a byte is non-ASCII, null or ESC */
+        if (((w | ((w - ones) & ~w) | ((e - ones) & ~e)) & highs) != 0)
+            break;
+        p += 8;
+    }
+#endif
+    while (p < end && *p < 0x80 && *p != 0x00 && *p != 0x1B)
+        ++p;
+    return p;
+}
+/*************************/
+/* In the GTK+ version, I used g_utf8_validate() but this function validates
+   UTF-8 directly and, in the same pass, finds whatever detectCharset() needs.
+   Unlike the old code, it doesn't stop at the first null byte. */
+const CharsetInfo scanBytes (const char *data, qint64 size)
 {
-    const char *string = byteArray.constData();
-    if (!string) return true;
+    CharsetInfo info;
+    info.validUTF8 = true;
+    info.hasNonAscii = false;
+    info.hasEscape = false;
+    info.nullPos = -1;
+    if (!data || size <= 0) return info;
+
+    static const unsigned int minCodePoint[5] = {0, 0, 0x80, 0x800, 0x10000}; // against overlong forms
+    const unsigned char *start = reinterpret_cast<const unsigned char*>(data);
+    const unsigned char *end = start + size;
+    const unsigned char *p = start;
+    while (p < end)
+    {
+        p = skipPlainAscii (p, end);
+        if (p == end) break;
+
+        const unsigned char c = *p;
+        if (c == 0x00)
+        {
+            if (info.nullPos == -1)
+                info.nullPos = p - start;
+            ++p;
+            continue;
+        }
+        if (c == 0x1B)
+        {
+            info.hasEscape = true;
+            ++p;
+            continue;
+        }
 
-    const unsigned char *bytes = (const unsigned char*)string;
-    unsigned int cp; // code point
-    int bn; // bytes number
+        info.hasNonAscii = true;
+        if (!info.validUTF8)
+        {
+            if (info.hasEscape && info.nullPos != -1)
+                break; // nothing more to find
+            ++p;
+            continue;
+        }
 
-    while (*bytes != 0x00)
-    {
         /* assuming that UTF-8 maps a sequence of 1-4 bytes,
            we find the code point and the number of bytes */
-        if ((*bytes & 0x80) == 0x00)
-        { // 0xxxxxxx, all ASCII characters (0-127)
-            cp = (*bytes & 0x7F);
-            bn = 1;
-        }
-        else if ((*bytes & 0xE0) == 0xC0)
+        unsigned int cp; // code point
+        int bn; // bytes number
+        if ((c & 0xE0) == 0xC0)
         { // 110xxxxx 10xxxxxx
-            cp = (*bytes & 0x1F);
+            cp = (c & 0x1F);
             bn = 2;
         }
-        else if ((*bytes & 0xF0) == 0xE0)
+        else if ((c & 0xF0) == 0xE0)
         { // 1110xxxx 10xxxxxx 10xxxxxx
-            cp = (*bytes & 0x0F);
+            cp = (c & 0x0F);
             bn = 3;
         }
-        else if ((*bytes & 0xF8) == 0xF0)
+        else if ((c & 0xF8) == 0xF0)
         { // 11110xxx 10xxxxxx 10xxxxxx 10xxxxxx
-            cp = (*bytes & 0x07);
+            cp = (c & 0x07);
             bn = 4;
         }
         else
-            return false;
+            bn = 0;
 
-        bytes += 1;
-        for (int i = 1; i < bn; ++i)
+        bool valid = (bn > 0 && end - p >= bn);
+        for (int i = 1; valid && i < bn; ++i)
         {
             /* all the other bytes should be of the form 10xxxxxx */
-            if ((*bytes & 0xC0) != 0x80)
-                return false;
-            cp = (cp << 6) | (*bytes & 0x3F);
-            bytes += 1;
-        }
-
-        if (cp > 0x10FFFF // max code point by definition
-            /* the range from 0xd800 to 0xdfff is reserved
-               for use with UTF-16 and excluded from UTF-8 */
-            || (cp >= 0xD800 && cp <= 0xDFFF)
-            /* logically impossible situations */
-            || (cp <= 0x007F && bn != 1)
-            || (cp >= 0x0080 && cp <= 0x07FF && bn != 2)
-            || (cp >= 0x0800 && cp <= 0xFFFF && bn != 3)
-            || (cp >= 0x10000 && cp <= 0x1FFFFF && bn != 4))
+            if ((p[i] & 0xC0) != 0x80)
+                valid = false;
+            else
+                cp = (cp << 6) | (p[i] & 0x3F);
+        }
+        if (valid
+            && (cp > 0x10FFFF // max code point by definition
+                /* the range from 0xd800 to 0xdfff is reserved
+                   for use with UTF-16 and excluded from UTF-8 */
+                || (cp >= 0xD800 && cp <= 0xDFFF)
+                /* logically impossible situations */
+                || cp < minCodePoint[bn]))
+        {
+            valid = false;
+        }
+
+        if (valid)
+            p += bn;
+        else
         {
-            return false;
+            info.validUTF8 = false;
+            ++p;
         }
     }
 
-    return true;
+    return info;
 }
 /*************************/
-const QString detectCharset (const QByteArray byteArray)
+static const std::string detectCharsetIso2022 (const char *text, const char *end)
 {
-    const char* text = byteArray.constData();
-    uint8_t c = *text;
     std::string charset;
+    uint8_t c;
 
-    if (validateUTF8 (byteArray))
+    while (const char *esc = static_cast<const char*>(memchr (text, 0x1B, end - text)))
     {
-        while ((c = *text++) != '\0')
+        text = esc + 1;
+        c = nextByte (text, end);
+        if (c != '$') continue;
+        c = nextByte (text, end);
+        switch (c)
         {
-            if (c > 0x7F)
+        case 'B': // JIS X 0208-1983
+        case '@': // JIS X 0208-1978
+            charset = "ISO-2022-JP";
+            continue;
+        case 'A': // GB2312-1980
+            charset = "ISO-2022-JP-2";
+            break;
+        case '(':
+            c = nextByte (text, end);
+            switch (c)
             {
-                charset = "UTF-8";
-                break;
+            case 'C': // KSC5601-1987
+            case 'D': // JIS X 0212-1990
+                charset = "ISO-2022-JP-2";
             }
-            if (c == 0x1B) /* ESC */
+            break;
+        case ')':
+            c = nextByte (text, end);
+            if (c == 'C')
+                charset = "ISO-2022-KR"; // KSC5601-1987
+        }
+        break;
+    }
+
+    return charset;
+}
+/*************************/
+/* A sample of a big text for charset detection, made of its head, middle
+   and tail. The parts are cut at line boundaries when possible; otherwise,
+   they are cut so that no UTF-8 sequence is split. */
+const QByteArray charsetSample (const QByteArray& byteArray, int sampleSize)
+{
+    const int size = byteArray.size();
+    if (sampleSize <= 0 || size <= sampleSize)
+        return byteArray;
+
+    const char *data = byteArray.constData();
+    const int part = sampleSize / 3;
+    const int starts[3] = {0, (size - part) / 2, size - part};
+    QByteArray sample;
+    sample.reserve (sampleSize + 2);
+    for (int i = 0; i < 3; ++i)
+    {
+        int start = starts[i];
+        int end = start + part;
+        if (i > 0)
+        { // start after a newline
+            if (const char *nl = static_cast<const char*>(memchr (data + start, '\n', part)))
+                start = nl - data + 1;
+            else
             {
-                c = *text++;
-                if (c == '$')
+                for (int n = 0; n < 3 && start < end
+                                && (static_cast<uint8_t>(data[start]) & 0xC0) == 0x80; ++n)
                 {
-                    c = *text++;
-                    switch (c)
-                    {
-                    case 'B': // JIS X 0208-1983
-                    case '@': // JIS X 0208-1978
-                        charset = "ISO-2022-JP";
-                        continue;
-                    case 'A': // GB2312-1980
-                        charset = "ISO-2022-JP-2";
-                        break;
-                    case '(':
-                        c = *text++;
-                        switch (c)
-                        {
-                        case 'C': // KSC5601-1987
-                        case 'D': // JIS X 0212-1990
-                            charset = "ISO-2022-JP-2";
-                        }
-                        break;
-                    case ')':
-                        c = *text++;
-                        if (c == 'C')
-                            charset = "ISO-2022-KR"; // KSC5601-1987
-                    }
-                    break;
+                    ++start;
                 }
             }
         }
+        if (i < 2)
+        { // end at a newline
+            int e = end;
+            while (e > start && data[e - 1] != '\n')
+                --e;
+            if (e > start)
+                end = e;
+            else
+            { // remove the last multibyte character, complete or not
+                for (int n = 0; n < 3 && end > start
+                                && (static_cast<uint8_t>(data[end - 1]) & 0xC0) == 0x80; ++n)
+                {
+                    --end;
+                }
+                if (end > start && static_cast<uint8_t>(data[end - 1]) >= 0xC0)
+                    --end;
+            }
+        }
+        if (start < end)
+        {
+            if (!sample.isEmpty())
+                sample.append ('\n');
+            sample.append (data + start, end - start);
+        }
+    }
+    return sample;
+}
+/*************************/
+const QString detectCharset (const QByteArray byteArray)
+{
+    return detectCharset (byteArray, scanBytes (byteArray.constData(), byteArray.size()));
+}
+/*************************/
+const QString detectCharset (const QByteArray byteArray, const CharsetInfo& info)
+{
+    const char* text = byteArray.constData();
+    const char* end = text + byteArray.size();
+    std::string charset;
+
+    if (info.validUTF8)
+    {
+        if (info.hasNonAscii)
+            charset = "UTF-8";
+        else if (info.hasEscape)
+            charset = detectCharsetIso2022 (text, end);
         if (charset.empty())
             charset = getDefaultCharset();
     }
@@ -602,28 +765,28 @@ const QString detectCharset (const QByteArray byteArray)
         {
             case LATIN1:
                 /* Windows-1252 */
-                charset = detectCharsetLatin (text);
+                charset = detectCharsetLatin (text, end);
                 break;
             case LATINC:
             case LATINC_UA:
             case LATINC_TJ:
                 /* Cyrillic */
-                charset = detectCharsetCyrillic (text);
+                charset = detectCharsetCyrillic (text, end);
                 break;
             case LATINA:
                 /* MS Windows Arabic */
-                charset = detectCharsetWinArabic (text);
+                charset = detectCharsetWinArabic (text, end);
                 break;
             case CHINESE_CN:
             case CHINESE_TW:
             case CHINESE_HK:
-                charset = detectCharsetChinese (text);
+                charset = detectCharsetChinese (text, end);
                 break;
             case JAPANESE:
-                charset = detectCharsetJapanese (text);
+                charset = detectCharsetJapanese (text, end);
                 break;
             case KOREAN:
-                charset = detectCharsetKorean (text);
+                charset = detectCharsetKorean (text, end);
                 break;
             case VIETNAMESE:
             case THAI:
@@ -633,7 +796,7 @@ const QString detectCharset (const QByteArray byteArray)
             default:
                 if (getDefaultCharset() != "UTF-8")
                     charset = getDefaultCharset();
-                else if (detect_noniso (text))
+                else if (detect_noniso (text, end))
                     charset = encodingItem[CODEPAGE];
                 else
                     charset = encodingItem[OPENI18N];
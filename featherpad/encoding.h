@@ -5,7 +5,19 @@
 
 namespace FeatherPad {
 
+/* what a single pass over the bytes of a text tells about its encoding */
+struct CharsetInfo
+{
+    bool validUTF8;
+    bool hasNonAscii;
+    bool hasEscape; // ESC may start an ISO-2022 sequence
+    qint64 nullPos; // the position of the first null byte (-1 if there's none)
+};
+
+const CharsetInfo scanBytes (const char *data, qint64 size);
 const QString detectCharset (const QByteArray byteArray);
+const QString detectCharset (const QByteArray byteArray, const CharsetInfo& info);
+const QByteArray charsetSample (const QByteArray& byteArray, int sampleSize);
 
 }
 
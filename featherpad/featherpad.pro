@@ -1,5 +1,6 @@
 QT += core gui \
       widgets \
+      concurrent \
       printsupport \
       network \
       x11extras \
@@ -24,12 +25,20 @@ SOURCES += main.cpp \
            pref.cpp \
            config.cpp \
            brackets.cpp \
+           bracketindex.cpp \
            syntax.cpp \
            highlighter-sh.cpp \
            highlighter-html.cpp \
            highlighter-patterns.cpp \
            vscrollbar.cpp \
            loading.cpp \
+           largefile.cpp \
+           textfinder.cpp \
+           findall.cpp \
+           matchcache.cpp \
+           regexfinder.cpp \
+           multifind.cpp \
+           textwriter.cpp \
            tabpage.cpp \
            searchbar.cpp \
            session.cpp
@@ -43,11 +52,19 @@ HEADERS += singleton.h \
            tabbar.h \
            x11.h \
            highlighter.h \
+           bracketindex.h \
            vscrollbar.h \
            filedialog.h \
            config.h \
            pref.h \
            loading.h \
+           largefile.h \
+           textfinder.h \
+           findall.h \
+           matchcache.h \
+           regexfinder.h \
+           multifind.h \
+           textwriter.h \
            messagebox.h \
            tabpage.h \
            searchbar.h \
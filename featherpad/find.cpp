@@ -15,308 +15,53 @@
  * with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include "fpwin.h"
+#include "singleton.h"
 #include "ui_fp.h"
+#include "textfinder.h"
+#include "findall.h"
+#include "matchcache.h"
+#include "regexfinder.h"
+#include "multifind.h"
+#include <QFileInfo>
+
+#include "x11.h"
 
 namespace FeatherPad {
 
 /* This order is preserved everywhere for selections:
    current line -> replacement -> found matches -> bracket matches */
 
-/************************************************************************
- ***** Qt's backward search has some bugs. Therefore, we do our own *****
- ***** backward search by using the following two static functions. *****
- ************************************************************************/
-static bool findBackwardInBlock (const QTextBlock &block, const QString &str, int offset,
-                                 QTextCursor &cursor, QTextDocument::FindFlags flags)
-{
-    Qt::CaseSensitivity cs = !(flags & QTextDocument::FindCaseSensitively)
-                             ? Qt::CaseInsensitive : Qt::CaseSensitive;
-
-    QString text = block.text();
-    text.replace (QChar::Nbsp, QLatin1Char (' '));
-
-    int idx = -1;
-    while (offset >= 0 && offset <= text.length())
-    {
-        idx = text.lastIndexOf (str, offset, cs);
-        if (idx == -1)
-            return false;
-        if (flags & QTextDocument::FindWholeWords)
-        {
-            const int start = idx;
-            const int end = start + str.length();
-            if ((start != 0 && text.at (start - 1).isLetterOrNumber())
-                || (end != text.length() && text.at (end).isLetterOrNumber()))
-            { // if this is not a whole word, continue the backward search
-                offset = idx - 1;
-                idx = -1;
-                continue;
-            }
-        }
-        cursor.setPosition (block.position() + idx);
-        cursor.setPosition (cursor.position() + str.length(), QTextCursor::KeepAnchor);
-        return true;
-    }
-    return false;
-}
-
-static bool findBackward (const QTextDocument *txtdoc, const QString str,
-                          QTextCursor &cursor, QTextDocument::FindFlags flags)
-{
-    if (!str.isEmpty() && !cursor.isNull())
-    {
-        int pos = cursor.anchor()
-                  - str.size(); // we don't want a match with the cursor inside it
-        if (pos >= 0)
-        {
-            QTextBlock block = txtdoc->findBlock (pos);
-            int blockOffset = pos - block.position();
-            while (block.isValid())
-            {
-                if (findBackwardInBlock (block, str, blockOffset, cursor, flags))
-                    return true;
-                block = block.previous();
-                blockOffset = block.length() - 2; // newline is included in length()
-            }
-        }
-    }
-    cursor = QTextCursor();
-    return false;
-}
-/*************************/
-// This method extends the searchable strings to those with line breaks.
-// It also corrects the behavior of Qt's backward search and can set an
-// end limit to the forward search.
+// The search is done on the plain text of the document, which is made once after each
+// change. Strings with line breaks are found like other strings. Like the old search, a
+// backward search doesn't find a match with the cursor inside it and the forward search
+// can have an end limit for the start of the match.
+// Regular expressions aren't searched for here because the GUI shouldn't wait
+// for them; their callers use RegexSearch instead.
 QTextCursor FPwin::finding (const QString str, const QTextCursor& start, QTextDocument::FindFlags flags,
-                            const int end) const
+                            const int end)
 {
     /* let's be consistent first */
-    if (ui->tabWidget->currentIndex() == -1 || str.isEmpty())
+    if (ui->tabWidget->currentIndex() == -1 || str.isEmpty() || start.isNull())
         return QTextCursor(); // null cursor
 
-    QTextDocument *txtdoc = qobject_cast< TabPage *>(ui->tabWidget->currentWidget())
-                            ->textEdit()->document();
-    QTextCursor res = start;
-    if (str.contains ('\n'))
-    {
-        QTextCursor cursor = start;
-        QTextCursor found;
-        QStringList sl = str.split ("\n");
-        int i = 0;
-        Qt::CaseSensitivity cs = !(flags & QTextDocument::FindCaseSensitively)
-                                 ? Qt::CaseInsensitive : Qt::CaseSensitive;
-        QString subStr;
-        if (!(flags & QTextDocument::FindBackward))
-        {
-            /* this loop searches for the consecutive
-               occurrences of newline separated strings */
-            while (i < sl.count())
-            {
-                if (i == 0) // the first string
-                {
-                    subStr = sl.at (0);
-                    /* when the first string is empty... */
-                    if (subStr.isEmpty())
-                    {
-                        /* ... search anew from the next block */
-                        cursor.movePosition (QTextCursor::EndOfBlock);
-                        if (end > 0 && cursor.anchor() > end)
-                            return QTextCursor();
-                        res.setPosition (cursor.position());
-                        if (!cursor.movePosition (QTextCursor::NextBlock))
-                            return QTextCursor();
-                        ++i;
-                    }
-                    else
-                    {
-                        if ((found = txtdoc->find (subStr, cursor, flags)).isNull())
-                            return QTextCursor();
-                        if (end > 0 && found.anchor() > end)
-                            return QTextCursor();
-                        cursor.setPosition (found.position());
-                        /* if the match doesn't end the block... */
-                        while (!cursor.atBlockEnd())
-                        {
-                            /* ... move the cursor to right and search until a match is found */
-                            cursor.movePosition (QTextCursor::EndOfBlock);
-                            cursor.setPosition (cursor.position() - subStr.length());
-                            if ((found = txtdoc->find (subStr, cursor, flags)).isNull())
-                                return QTextCursor();
-                            if (end > 0 && found.anchor() > end)
-                                return QTextCursor();
-                            cursor.setPosition (found.position());
-                        }
-
-                        res.setPosition (found.anchor());
-                        if (!cursor.movePosition (QTextCursor::NextBlock))
-                            return QTextCursor();
-                        ++i;
-                    }
-                }
-                else if (i != sl.count() - 1) // middle strings
-                {
-                    /* when the next block's test isn't the next string... */
-                    if (QString::compare (cursor.block().text(), sl.at (i), cs) != 0)
-                    {
-                        /* ... reset the loop cautiously */
-                        cursor.setPosition (res.position());
-                        if (!cursor.movePosition (QTextCursor::NextBlock))
-                            return QTextCursor();
-                        i = 0;
-                        continue;
-                    }
-
-                    if (!cursor.movePosition (QTextCursor::NextBlock))
-                        return QTextCursor();
-                    ++i;
-                }
-                else // the last string (i == sl.count() - 1)
-                {
-                    subStr = sl.at (i);
-                    if (subStr.isEmpty()) break;
-                    if (!(flags & QTextDocument::FindWholeWords))
-                    {
-                        /* when the last string doesn't start the next block... */
-                        if (!cursor.block().text().startsWith (subStr, cs))
-                        {
-                            /* ... reset the loop cautiously */
-                            cursor.setPosition (res.position());
-                            if (!cursor.movePosition (QTextCursor::NextBlock))
-                                return QTextCursor();
-                            i = 0;
-                            continue;
-                        }
-                        cursor.setPosition (cursor.anchor() + subStr.count());
-                        break;
-                    }
-                    else
-                    {
-                        if ((found = txtdoc->find (subStr, cursor, flags)).isNull()
-                            || found.anchor() != cursor.position())
-                        {
-                            cursor.setPosition (res.position());
-                            if (!cursor.movePosition (QTextCursor::NextBlock))
-                                return QTextCursor();
-                            i = 0;
-                            continue;
-                        }
-                        cursor.setPosition (found.position());
-                        break;
-                    }
-                }
-            }
-            res.setPosition (cursor.position(), QTextCursor::KeepAnchor);
-        }
-        else // backward search
-        {
-            cursor.setPosition (cursor.anchor());
-            int endPos = cursor.position();
-            while (i < sl.count())
-            {
-                if (i == 0) // the last string
-                {
-                    subStr = sl.at (sl.count() - 1);
-                    if (subStr.isEmpty())
-                    {
-                        cursor.movePosition (QTextCursor::StartOfBlock);
-                        endPos = cursor.position();
-                        if (!cursor.movePosition (QTextCursor::PreviousBlock))
-                            return QTextCursor();
-                        cursor.movePosition (QTextCursor::EndOfBlock);
-                        ++i;
-                    }
-                    else
-                    {
-                        if (!findBackward (txtdoc, subStr, cursor, flags))
-                            return QTextCursor();
-                        /* if the match doesn't start the block... */
-                        while (cursor.anchor() > cursor.block().position())
-                        {
-                            /* ... move the cursor to left and search backward until a match is found */
-                            cursor.setPosition (cursor.block().position() + subStr.count());
-                            if (!findBackward (txtdoc, subStr, cursor, flags))
-                                return QTextCursor();
-                        }
-
-                        endPos = cursor.position();
-                        if (!cursor.movePosition (QTextCursor::PreviousBlock))
-                            return QTextCursor();
-                        cursor.movePosition (QTextCursor::EndOfBlock);
-                        ++i;
-                    }
-                }
-                else if (i != sl.count() - 1) // the middle strings
-                {
-                    if (QString::compare (cursor.block().text(), sl.at (sl.count() - i - 1), cs) != 0)
-                    { // reset the loop if the block text doesn't match
-                        cursor.setPosition (endPos);
-                        if (!cursor.movePosition (QTextCursor::PreviousBlock))
-                            return QTextCursor();
-                        cursor.movePosition (QTextCursor::EndOfBlock);
-                        i = 0;
-                        continue;
-                    }
-
-                    if (!cursor.movePosition (QTextCursor::PreviousBlock))
-                        return QTextCursor();
-                    cursor.movePosition (QTextCursor::EndOfBlock);
-                    ++i;
-                }
-                else // the first string
-                {
-                    subStr = sl.at (0);
-                    if (subStr.isEmpty()) break;
-                    if (!(flags & QTextDocument::FindWholeWords))
-                    {
-                        /* when the first string doesn't end the previous block... */
-                        if (!cursor.block().text().endsWith (subStr, cs))
-                        {
-                            /* ... reset the loop */
-                            cursor.setPosition (endPos);
-                            if (!cursor.movePosition (QTextCursor::PreviousBlock))
-                                return QTextCursor();
-                            cursor.movePosition (QTextCursor::EndOfBlock);
-                            i = 0;
-                            continue;
-                        }
-                        cursor.setPosition (cursor.anchor() - subStr.count());
-                        break;
-                    }
-                    else
-                    {
-                        found = cursor; // block end
-                        if (!findBackward (txtdoc, subStr, found, flags)
-                            || found.position() != cursor.position())
-                        {
-                            cursor.setPosition (endPos);
-                            if (!cursor.movePosition (QTextCursor::PreviousBlock))
-                                return QTextCursor();
-                            cursor.movePosition (QTextCursor::EndOfBlock);
-                            i = 0;
-                            continue;
-                        }
-                        cursor.setPosition (found.anchor());
-                        break;
-                    }
-                }
-            }
-            res.setPosition (cursor.anchor());
-            res.setPosition (endPos, QTextCursor::KeepAnchor);
-        }
-    }
-    else // there's no line break
-    {
-        if (!(flags & QTextDocument::FindBackward))
-        {
-            res = txtdoc->find (str, start, flags);
-            if (end > 0 && res.anchor() > end)
-                return QTextCursor();
-        }
-        else
-            findBackward (txtdoc, str, res, flags);
-    }
+    TabPage *tabPage = qobject_cast< TabPage *>(ui->tabWidget->currentWidget());
+    TextEdit *textEdit = tabPage->textEdit();
+    const QString &text = textEdit->plainTextSnapshot();
+    Qt::CaseSensitivity cs = flags & QTextDocument::FindCaseSensitively ? Qt::CaseSensitive : Qt::CaseInsensitive;
+    const TextFinder finder (str, cs, flags & QTextDocument::FindWholeWords);
+    int pos;
+    if (flags & QTextDocument::FindBackward)
+        pos = finder.findBackward (text, start.selectionStart() - str.length());
+    else
+        pos = finder.findForward (text, start.selectionEnd(), end > 0 ? end + 1 : -1);
+    if (pos == -1)
+        return QTextCursor();
+    const int length = str.length();
 
+    /* only the found match is mapped to a cursor */
+    QTextCursor res = start;
+    res.setPosition (pos);
+    res.setPosition (pos + length, QTextCursor::KeepAnchor);
     return res;
 }
 /*************************/
@@ -335,6 +80,10 @@ void FPwin::find(bool forward)
     {
         textEdit->setSearchedText (txt);
         newSrch = true;
+        if (ui->dockFindAll->isVisible())
+            findAll();
+        if (ui->dockFindDocs->isVisible())
+            findInDocs();
     }
 
     disconnect (textEdit, &TextEdit::resized, this, &FPwin::hlight);
@@ -357,25 +106,74 @@ void FPwin::find(bool forward)
     QTextDocument::FindFlags newFlags = searchFlags;
     if (!forward)
         newFlags = searchFlags | QTextDocument::FindBackward;
-    QTextCursor start = textEdit->textCursor();
-    QTextCursor found = finding (txt, start, newFlags);
-
-    if (found.isNull())
+    if (textEdit->getLargeFile()) // search the whole huge file, not just its page
     {
-        if (!forward)
-            start.movePosition (QTextCursor::End, QTextCursor::MoveAnchor);
+        if (tabPage->matchRegex()) // only "Find All" can search a huge file for a regex
+            showWarningBar ("<center><b><big>" + tr ("Use \"Find All\" to search a huge file for a regular expression.") + "</big></b></center>");
         else
-            start.movePosition (QTextCursor::Start, QTextCursor::MoveAnchor);
-        found = finding (txt, start, newFlags);
+            textEdit->findInLargeFile (txt, newFlags);
     }
-
-    if (!found.isNull())
+    else if (tabPage->matchRegex())
+    { // the match is selected by onRegexFound() when it's found in a worker thread
+        const RegexFinder finder (txt, searchFlags & QTextDocument::FindCaseSensitively
+                                           ? Qt::CaseSensitive : Qt::CaseInsensitive);
+        if (!finder.isValid())
+        {
+            findSearch_->cancel();
+            showWarningBar ("<center><b><big>" + tr ("Invalid regular expression!") + "</big></b></center>\n"
+                            + "<center>" + finder.errorString() + "</center>");
+        }
+        else
+        {
+            const QTextCursor cur = textEdit->textCursor();
+            pendingFind_.textEdit = textEdit;
+            pendingFind_.revision = textEdit->textRevision();
+            pendingFind_.anchor = cur.anchor();
+            pendingFind_.position = cur.position();
+            pendingFind_.newSearch = newSrch;
+            const QString text = textEdit->plainTextSnapshot();
+            const int selStart = cur.selectionStart();
+            const int selEnd = cur.selectionEnd();
+            findSearch_->start ([finder, text, forward, selStart, selEnd] (const QAtomicInt *stop) {
+                QVector<RegexMatch> matches;
+                if (forward)
+                {
+                    matches = finder.search (text, selEnd, text.length(), 1, QString(), stop);
+                    if (matches.isEmpty()) // search again from the start
+                        matches = finder.search (text, 0, text.length(), 1, QString(), stop);
+                }
+                else
+                {
+                    matches = finder.searchBackward (text, selStart, QString(), stop);
+                    if (matches.isEmpty()) // search again from the end
+                        matches = finder.searchBackward (text, text.length(), QString(), stop);
+                }
+                return matches;
+            }, RegexFinder::timeout);
+        }
+    }
+    else
     {
-        start.setPosition (found.anchor());
-        /* this is needed for selectionChanged() to be emitted */
-        if (newSrch) textEdit->setTextCursor (start);
-        start.setPosition (found.position(), QTextCursor::KeepAnchor);
-        textEdit->setTextCursor (start);
+        QTextCursor start = textEdit->textCursor();
+        QTextCursor found = finding (txt, start, newFlags);
+
+        if (found.isNull())
+        {
+            if (!forward)
+                start.movePosition (QTextCursor::End, QTextCursor::MoveAnchor);
+            else
+                start.movePosition (QTextCursor::Start, QTextCursor::MoveAnchor);
+            found = finding (txt, start, newFlags);
+        }
+
+        if (!found.isNull())
+        {
+            start.setPosition (found.anchor());
+            /* this is needed for selectionChanged() to be emitted */
+            if (newSrch) textEdit->setTextCursor (start);
+            start.setPosition (found.position(), QTextCursor::KeepAnchor);
+            textEdit->setTextCursor (start);
+        }
     }
     /* matches highlights should come here, after the text area is
        scrolled and even when no match is found (it may be added later) */
@@ -397,45 +195,99 @@ void FPwin::hlight() const
     QString txt = textEdit->getSearchedText();
     if (txt.isEmpty()) return;
 
-    QTextDocument::FindFlags searchFlags = getSearchFlags();
-
     /* prepend green highlights */
     QList<QTextEdit::ExtraSelection> es = textEdit->getGreenSel();
     QColor color = QColor (textEdit->hasDarkScheme() ? QColor (115, 115, 0) : Qt::yellow);
-    QTextCursor found;
     /* first put a start cursor at the top left edge... */
     QPoint Point (0, 0);
     QTextCursor start = textEdit->cursorForPosition (Point);
     /* ... then move it backward by the search text length */
-    int startPos = start.position() - txt.length();
-    if (startPos >= 0)
-        start.setPosition (startPos);
-    else
-        start.setPosition (0);
+    int startPos = qMax (start.position() - txt.length(), 0);
     int w = textEdit->geometry().width();
     int h = textEdit->geometry().height();
-    /* get the visible text to check if
-       the search string is inside it */
     Point = QPoint (w, h);
-    QTextCursor end = textEdit->cursorForPosition (Point);
-    int endLimit = end.anchor();
-    int endPos = end.position() + txt.length();
-    end.movePosition (QTextCursor::End);
-    if (endPos <= end.position())
-        end.setPosition (endPos);
-    QTextCursor visCur = start;
-    visCur.setPosition (end.position(), QTextCursor::KeepAnchor);
-    QString str = visCur.selection().toPlainText(); // '\n' is included in this way
-    Qt::CaseSensitivity cs = Qt::CaseInsensitive;
-    if (tabPage->matchCase()) cs = Qt::CaseSensitive;
-    while (str.contains (txt, cs) // don't waste time if the searched text isn't visible
-           && !(found = finding (txt, start, searchFlags, endLimit)).isNull())
+    int endLimit = textEdit->cursorForPosition (Point).anchor();
+
+    Qt::CaseSensitivity cs = tabPage->matchCase() ? Qt::CaseSensitive : Qt::CaseInsensitive;
+    if (tabPage->matchRegex())
     {
-        QTextEdit::ExtraSelection extra;
-        extra.format.setBackground (color);
-        extra.cursor = found;
-        es.append (extra);
-        start.setPosition (found.position());
+        /* the visible blocks and a page above and below them are searched in a worker
+           thread, which is given up quickly if the regex is too slow, and the matches
+           are shown by onVisibleRegexFound(); so, scrolling by less than a page doesn't
+           need searching and the GUI doesn't wait for the worker */
+        const int revision = textEdit->textRevision();
+        const bool cached = visibleRegex_.textEdit == textEdit && visibleRegex_.revision == revision
+                            && visibleRegex_.pattern == txt && visibleRegex_.cs == cs;
+        if (cached)
+        {
+            const QVector<RegexMatch> &matches = visibleRegex_.matches;
+            for (int i = 0; i < matches.size(); ++i)
+            {
+                if (matches.at (i).position < startPos || matches.at (i).position > endLimit)
+                    continue;
+                QTextEdit::ExtraSelection extra;
+                extra.format.setBackground (color);
+                extra.cursor = start;
+                extra.cursor.setPosition (matches.at (i).position);
+                extra.cursor.setPosition (matches.at (i).position + matches.at (i).length,
+                                          QTextCursor::KeepAnchor);
+                es.append (extra);
+            }
+        }
+        if (!cached || startPos < visibleRegex_.from || endLimit >= visibleRegex_.to)
+        {
+            const bool pending = visibleSearch_->isRunning()
+                                 && pendingVisible_.textEdit == textEdit && pendingVisible_.revision == revision
+                                 && pendingVisible_.pattern == txt && pendingVisible_.cs == cs
+                                 && startPos >= pendingVisible_.from && endLimit < pendingVisible_.to;
+            const RegexFinder finder (txt, cs);
+            if (!pending && finder.isValid())
+            {
+                const int page = endLimit - startPos;
+                const int from = qMax (startPos - page, 0);
+                const int to = qMin (endLimit + page, textEdit->document()->characterCount() - 1) + 1;
+                /* not much of very long blocks is taken */
+                QTextBlock block = textEdit->document()->findBlock (from);
+                const int textStart = qMax (block.position(), from - 1024);
+                block = textEdit->document()->findBlock (to - 1);
+                const int textEnd = qMin (block.position() + block.length() - 1, to + 1024);
+                QTextCursor visCur = start;
+                visCur.setPosition (textStart);
+                visCur.setPosition (textEnd, QTextCursor::KeepAnchor);
+                const QString str = visCur.selection().toPlainText(); // '\n' is included in this way
+
+                pendingVisible_.textEdit = textEdit;
+                pendingVisible_.revision = revision;
+                pendingVisible_.pattern = txt;
+                pendingVisible_.cs = cs;
+                pendingVisible_.from = from;
+                pendingVisible_.to = to;
+                visibleSearch_->start ([finder, str, from, to, textStart] (const QAtomicInt *stop) {
+                    QVector<RegexMatch> matches = finder.search (str, from - textStart, to - textStart,
+                                                                 0, QString(), stop);
+                    for (int i = 0; i < matches.size(); ++i)
+                        matches[i].position += textStart;
+                    return matches;
+                }, RegexFinder::visibleTimeout);
+            }
+        }
+    }
+    else
+    {
+        /* the matches are searched for only in the parts of the text that haven't been
+           visible since the last change, so that scrolling doesn't need searching */
+        MatchCache *matchCache = textEdit->getMatchCache();
+        matchCache->setQuery (txt, cs, tabPage->matchWhole());
+        const QVector<int> matches = matchCache->matches (startPos, endLimit + 1);
+        for (int i = 0; i < matches.size(); ++i)
+        {
+            QTextEdit::ExtraSelection extra;
+            extra.format.setBackground (color);
+            extra.cursor = start;
+            extra.cursor.setPosition (matches.at (i));
+            extra.cursor.setPosition (matches.at (i) + txt.length(), QTextCursor::KeepAnchor);
+            es.append (extra);
+        }
     }
 
     /* also prepend the current line highlight,
@@ -447,6 +299,45 @@ void FPwin::hlight() const
     textEdit->setExtraSelections (es);
 }
 /*************************/
+// Selects the regex match found by find() if the text and its selection are the same as before.
+void FPwin::onRegexFound (const QVector<RegexMatch> &matches, bool timedOut)
+{
+    TabPage *tabPage = qobject_cast< TabPage *>(ui->tabWidget->currentWidget());
+    if (tabPage == nullptr) return;
+    TextEdit *textEdit = tabPage->textEdit();
+    QTextCursor start = textEdit->textCursor();
+    if (pendingFind_.textEdit != textEdit
+        || pendingFind_.revision != textEdit->textRevision()
+        || pendingFind_.anchor != start.anchor()
+        || pendingFind_.position != start.position())
+    {
+        return;
+    }
+    if (timedOut)
+    {
+        showWarningBar ("<center><b><big>" + tr ("The regular expression took too long and its search was abandoned.") + "</big></b></center>");
+        return;
+    }
+    if (matches.isEmpty())
+        return;
+
+    start.setPosition (matches.first().position);
+    /* this is needed for selectionChanged() to be emitted */
+    if (pendingFind_.newSearch) textEdit->setTextCursor (start);
+    start.setPosition (matches.first().position + matches.first().length, QTextCursor::KeepAnchor);
+    textEdit->setTextCursor (start);
+    hlight();
+}
+/*************************/
+// Keeps the regex matches found by hlight() (even when the search is given up,
+// so that it isn't repeated on scrolling) and shows them.
+void FPwin::onVisibleRegexFound (const QVector<RegexMatch> &matches, bool /*timedOut*/)
+{
+    visibleRegex_ = pendingVisible_;
+    visibleRegex_.matches = matches;
+    hlight();
+}
+/*************************/
 void FPwin::hlighting (const QRect&, int dy) const
 {
     if (dy) hlight();
@@ -469,6 +360,10 @@ void FPwin::searchFlagChanged()
     }
 
     hlight();
+    if (ui->dockFindAll->isVisible())
+        findAll();
+    if (ui->dockFindDocs->isVisible())
+        findInDocs();
 }
 /*************************/
 QTextDocument::FindFlags FPwin::getSearchFlags() const
@@ -481,5 +376,362 @@ QTextDocument::FindFlags FPwin::getSearchFlags() const
         searchFlags |= QTextDocument::FindCaseSensitively;
     return searchFlags;
 }
+/*************************/
+void FPwin::findAllDock()
+{
+    if (!isReady()) return;
+
+    if (!ui->dockFindAll->isVisible())
+    {
+        int count = ui->tabWidget->count();
+        for (int i = 0; i < count; ++i) // the search entry is in the searchbar
+            qobject_cast< TabPage *>(ui->tabWidget->widget (i))->setSearchBarVisible (true);
+        ui->dockFindAll->setVisible (true);
+        ui->dockFindAll->raise();
+        // findAllDockVisibility(true) is automatically called here
+        qobject_cast< TabPage *>(ui->tabWidget->currentWidget())->focusSearchBar();
+        return;
+    }
+
+    ui->dockFindAll->setVisible (false);
+}
+/*************************/
+// When the dock becomes invisible, stop all searches and remove their results. When
+// docking or undocking, the dock becomes invisible for a moment and then visible again,
+// so that the search of the current tab is restarted.
+void FPwin::findAllDockVisibility (bool visible)
+{
+    if (visible)
+    {
+        findAll();
+        return;
+    }
+
+    ui->listWidgetFindAll->clear();
+    int count = ui->tabWidget->count();
+    for (int i = 0; i < count; ++i)
+    {
+        TabPage *tabPage = qobject_cast< TabPage *>(ui->tabWidget->widget (i));
+        tabPage->textEdit()->getFindAll()->cancel();
+        tabPage->setMatchInfo (QString());
+    }
+}
+/*************************/
+// Find all matches of the search entry of the current tab in the background (if
+// they aren't found yet) and list them in the dock as they're found.
+void FPwin::findAll()
+{
+    ui->listWidgetFindAll->clear();
+
+    int index = ui->tabWidget->currentIndex();
+    if (index == -1 || !ui->dockFindAll->isVisible()) return;
+
+    TabPage *tabPage = qobject_cast< TabPage *>(ui->tabWidget->widget (index));
+    TextEdit *textEdit = tabPage->textEdit();
+    FindAll *finder = textEdit->getFindAll();
+    /* the connections aren't removed; the slots ignore the signals of other tabs */
+    connect (finder, &FindAll::started, this, &FPwin::findAllStarted, Qt::UniqueConnection);
+    connect (finder, &FindAll::matchesAdded, this, &FPwin::listMatches, Qt::UniqueConnection);
+    connect (finder, &FindAll::finished, this, &FPwin::findAllFinished, Qt::UniqueConnection);
+    connect (textEdit, &QPlainTextEdit::cursorPositionChanged, this, &FPwin::updateMatchInfo, Qt::UniqueConnection);
+
+    QString txt = tabPage->searchEntry();
+    Qt::CaseSensitivity cs = tabPage->matchCase() ? Qt::CaseSensitive : Qt::CaseInsensitive;
+    bool wholeWords = tabPage->matchWhole();
+    bool regex = tabPage->matchRegex();
+    if (txt.isEmpty())
+        finder->cancel();
+    else if (!finder->hasQuery (txt, cs, wholeWords, regex))
+        finder->start (txt, cs, wholeWords, regex);
+    else
+    {
+        listMatches (0, finder->matches().size());
+        if (!finder->isRunning())
+            findAllFinished();
+    }
+    updateMatchInfo();
+}
+/*************************/
+void FPwin::findAllStarted()
+{
+    TabPage *tabPage = qobject_cast< TabPage *>(ui->tabWidget->currentWidget());
+    if (tabPage == nullptr
+        || (qobject_cast< FindAll *>(sender()) && sender() != tabPage->textEdit()->getFindAll()))
+    {
+        return;
+    }
+    ui->listWidgetFindAll->clear();
+    updateMatchInfo();
+}
+/*************************/
+void FPwin::listMatches (int first, int count)
+{
+    TabPage *tabPage = qobject_cast< TabPage *>(ui->tabWidget->currentWidget());
+    if (tabPage == nullptr) return;
+    FindAll *finder = tabPage->textEdit()->getFindAll();
+    if (qobject_cast< FindAll *>(sender()) && sender() != finder) return;
+
+    /* only the matches with contexts are listed */
+    const QVector<FindAllMatch> &matches = finder->matches();
+    int last = qMin (first + count, qMin (matches.size(), static_cast<int>(FindAll::maxListed)));
+    if (first < last)
+    {
+        ui->listWidgetFindAll->setUpdatesEnabled (false);
+        for (int i = first; i < last; ++i)
+        {
+            const FindAllMatch &match = matches.at (i);
+            QListWidgetItem *item = new QListWidgetItem (QString ("%1: %2").arg (match.line + 1).arg (match.context));
+            item->setData (Qt::UserRole, i);
+            ui->listWidgetFindAll->addItem (item);
+        }
+        ui->listWidgetFindAll->setUpdatesEnabled (true);
+    }
+    updateMatchInfo();
+}
+/*************************/
+void FPwin::findAllFinished()
+{
+    TabPage *tabPage = qobject_cast< TabPage *>(ui->tabWidget->currentWidget());
+    if (tabPage == nullptr) return;
+    FindAll *finder = tabPage->textEdit()->getFindAll();
+    if (qobject_cast< FindAll *>(sender()) && sender() != finder) return;
+
+    if (finder->matches().size() > FindAll::maxListed)
+    {
+        QListWidgetItem *item = new QListWidgetItem (tr ("(Only the first %1 matches are listed.)")
+                                                     .arg (FindAll::maxListed));
+        item->setFlags (Qt::NoItemFlags);
+        ui->listWidgetFindAll->addItem (item);
+    }
+    if (finder->isTimedOut())
+    {
+        QListWidgetItem *item = new QListWidgetItem (tr ("(The regular expression took too long and its search was abandoned.)"));
+        item->setFlags (Qt::NoItemFlags);
+        ui->listWidgetFindAll->addItem (item);
+    }
+    updateMatchInfo();
+}
+/*************************/
+// Show "n of m" in the searchbar if the selection is a match and the number of matches otherwise.
+void FPwin::updateMatchInfo()
+{
+    TabPage *tabPage = qobject_cast< TabPage *>(ui->tabWidget->currentWidget());
+    if (tabPage == nullptr) return;
+    TextEdit *textEdit = tabPage->textEdit();
+    FindAll *finder = textEdit->getFindAll();
+    /* the signals of other tabs are ignored */
+    if ((qobject_cast< TextEdit *>(sender()) && sender() != textEdit)
+        || (qobject_cast< FindAll *>(sender()) && sender() != finder))
+    {
+        return;
+    }
+
+    if (!ui->dockFindAll->isVisible() || finder->query().isEmpty())
+    {
+        tabPage->setMatchInfo (QString());
+        return;
+    }
+
+    const int total = finder->matches().size();
+    QString totalStr = QString::number (total);
+    if (finder->isTruncated())
+        totalStr += "+";
+    if (finder->isRunning())
+        totalStr += QChar (0x2026);
+
+    QTextCursor cur = textEdit->textCursor();
+    int n = -1;
+    if (cur.hasSelection())
+    {
+        QTextBlock block = textEdit->document()->findBlock (cur.selectionStart());
+        n = finder->indexOf (textEdit->getFirstLine() + block.blockNumber(),
+                             cur.selectionStart() - block.position());
+        if (n > -1 && cur.selectionEnd() - cur.selectionStart() != finder->matches().at (n).length)
+            n = -1;
+    }
+    if (n > -1)
+        tabPage->setMatchInfo (tr ("%1 of %2").arg (n + 1).arg (totalStr));
+    else
+        tabPage->setMatchInfo (tr ("%1 matches").arg (totalStr));
+}
+/*************************/
+void FPwin::goToMatch (QListWidgetItem *item)
+{
+    TabPage *tabPage = qobject_cast< TabPage *>(ui->tabWidget->currentWidget());
+    if (tabPage == nullptr || item == nullptr) return;
+    TextEdit *textEdit = tabPage->textEdit();
+    FindAll *finder = textEdit->getFindAll();
+    bool ok;
+    int i = item->data (Qt::UserRole).toInt (&ok);
+    if (!ok || i < 0 || i >= finder->matches().size()) return;
+
+    showMatch (textEdit, finder->matches().at (i));
+}
+/*************************/
+// Select the match in the text edit (the match may not be valid if the text has been changed).
+void FPwin::showMatch (TextEdit *textEdit, const FindAllMatch &match)
+{
+    if (textEdit->getLargeFile())
+        textEdit->showLargeFileLine (match.line, match.column, match.length);
+    else
+    {
+        QTextBlock block = textEdit->document()->findBlockByNumber (static_cast<int>(match.line));
+        if (!block.isValid()) return;
+        int last = textEdit->document()->characterCount() - 1;
+        int pos = qMin (block.position() + match.column, last);
+        QTextCursor start = textEdit->textCursor();
+        start.setPosition (pos);
+        start.setPosition (qMin (pos + match.length, last), QTextCursor::KeepAnchor);
+        textEdit->setTextCursor (start);
+    }
+    textEdit->setFocus();
+}
+/*************************/
+void FPwin::findDocsDock()
+{
+    if (!isReady()) return;
+
+    if (!ui->dockFindDocs->isVisible())
+    {
+        int count = ui->tabWidget->count();
+        for (int i = 0; i < count; ++i) // the search entry is in the searchbar
+            qobject_cast< TabPage *>(ui->tabWidget->widget (i))->setSearchBarVisible (true);
+        ui->dockFindDocs->setVisible (true);
+        ui->dockFindDocs->raise();
+        // findDocsDockVisibility(true) is automatically called here
+        qobject_cast< TabPage *>(ui->tabWidget->currentWidget())->focusSearchBar();
+        return;
+    }
+
+    ui->dockFindDocs->setVisible (false);
+}
+/*************************/
+void FPwin::findDocsDockVisibility (bool visible)
+{
+    if (visible)
+        findInDocs();
+    else
+        multiFind_->cancel();
+}
+/*************************/
+// Find all matches of the search entry of the current tab in all documents of all windows.
+// The documents are searched in parallel and are listed in their order as they're searched.
+void FPwin::findInDocs()
+{
+    int index = ui->tabWidget->currentIndex();
+    if (index == -1 || !ui->dockFindDocs->isVisible()) return;
+
+    TabPage *tabPage = qobject_cast< TabPage *>(ui->tabWidget->widget (index));
+    QList<TextEdit*> textEdits;
+    QStringList names;
+    FPsingleton *singleton = static_cast<FPsingleton*>(qApp);
+    for (int i = 0; i < singleton->Wins.count(); ++i)
+    {
+        FPwin *thisWin = singleton->Wins.at (i);
+        for (int j = 0; j < thisWin->ui->tabWidget->count(); ++j)
+        {
+            TextEdit *textEdit = qobject_cast< TabPage *>(thisWin->ui->tabWidget->widget (j))->textEdit();
+            QString fname = textEdit->getFileName();
+            textEdits.append (textEdit);
+            names.append (fname.isEmpty() ? tr ("Untitled") : QFileInfo (fname).fileName());
+        }
+    }
+    multiFind_->start (textEdits, names,
+                       tabPage->searchEntry(),
+                       tabPage->matchCase() ? Qt::CaseSensitive : Qt::CaseInsensitive,
+                       tabPage->matchWhole(), tabPage->matchRegex());
+}
+/*************************/
+void FPwin::findDocsStarted()
+{
+    ui->treeWidgetFindDocs->clear();
+    if (!multiFind_->query().isEmpty())
+        ui->dockFindDocs->setWindowTitle (tr ("Searching%1").arg (QChar (0x2026)));
+    else
+        ui->dockFindDocs->setWindowTitle (tr ("Matches in All Documents"));
+}
+/*************************/
+// Add the matches of a document to the tree, keeping the order of the documents.
+void FPwin::listDocMatches (int index)
+{
+    const MultiFind::Document &doc = multiFind_->documents().at (index);
+    if (doc.textEdit.isNull()) return;
+
+    QString total = QString::number (doc.matches.size());
+    if (doc.truncated)
+        total += "+";
+    QTreeWidgetItem *docItem = new QTreeWidgetItem (QStringList (QString ("%1 (%2)").arg (doc.name).arg (total)));
+    docItem->setData (0, Qt::UserRole, index);
+    docItem->setData (0, Qt::UserRole + 1, 0);
+    docItem->setToolTip (0, doc.textEdit->getFileName());
+    QList<QTreeWidgetItem*> items;
+    for (int i = 0; i < doc.matches.size(); ++i)
+    {
+        const FindAllMatch &match = doc.matches.at (i);
+        QTreeWidgetItem *item = new QTreeWidgetItem (QStringList (QString ("%1: %2").arg (match.line + 1)
+                                                                                    .arg (match.context)));
+        item->setData (0, Qt::UserRole, index);
+        item->setData (0, Qt::UserRole + 1, i);
+        items.append (item);
+    }
+    docItem->addChildren (items);
+
+    int i = 0;
+    int count = ui->treeWidgetFindDocs->topLevelItemCount();
+    while (i < count && ui->treeWidgetFindDocs->topLevelItem (i)->data (0, Qt::UserRole).toInt() < index)
+        ++i;
+    ui->treeWidgetFindDocs->insertTopLevelItem (i, docItem);
+    docItem->setExpanded (true);
+}
+/*************************/
+void FPwin::findDocsFinished()
+{
+    if (multiFind_->query().isEmpty()) return;
+    int count = ui->treeWidgetFindDocs->topLevelItemCount();
+    QString title;
+    if (count == 0)
+        title = tr ("No Match");
+    else if (count == 1)
+        title = tr ("Matches in One Document");
+    else
+        title = tr ("Matches in %1 Documents").arg (count);
+    if (multiFind_->isTimedOut())
+        title += " " + tr ("(Search Abandoned)");
+    ui->dockFindDocs->setWindowTitle (title);
+}
+/*************************/
+// Activate the window and tab of the match and select it.
+void FPwin::goToDocMatch (QTreeWidgetItem *item)
+{
+    if (item == nullptr) return;
+    bool ok;
+    int index = item->data (0, Qt::UserRole).toInt (&ok);
+    if (!ok || index < 0 || index >= multiFind_->documents().size()) return;
+    const MultiFind::Document &doc = multiFind_->documents().at (index);
+    int i = item->data (0, Qt::UserRole + 1).toInt();
+    if (doc.textEdit.isNull() || i < 0 || i >= doc.matches.size()) return;
+
+    TextEdit *textEdit = doc.textEdit.data();
+    FPsingleton *singleton = static_cast<FPsingleton*>(qApp);
+    for (int j = 0; j < singleton->Wins.count(); ++j)
+    {
+        FPwin *thisWin = singleton->Wins.at (j);
+        for (int k = 0; k < thisWin->ui->tabWidget->count(); ++k)
+        {
+            if (qobject_cast< TabPage *>(thisWin->ui->tabWidget->widget (k))->textEdit() != textEdit)
+                continue;
+            thisWin->ui->tabWidget->setCurrentIndex (k);
+            if (thisWin != this)
+            {
+                if (singleton->isX11() && isWindowShaded (thisWin->winId()))
+                    unshadeWindow (thisWin->winId());
+                thisWin->activateWindow();
+                thisWin->raise();
+            }
+            thisWin->showMatch (textEdit, doc.matches.at (i));
+            return;
+        }
+    }
+}
 
 }
@@ -0,0 +1,409 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014 <tsujan2000@gmail.com>
+ *
+ * FeatherPad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FeatherPad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QtConcurrent>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <climits> // INT_MAX
+#include "findall.h"
+#include "textedit.h"
+#include "largefile.h"
+#include "textfinder.h"
+#include "regexfinder.h"
+
+namespace FeatherPad {
+
+static const int sliceLength = 1048576; // the worker checks whether it should stop after each slice
+static const int regexMatches = 1000; // the regex matches that are found at once
+static const int batchInterval = 100; // in ms
+static const qint64 regexExtension = 65536; // the bytes after a part of a huge file for regex matches
+static const int contextBefore = 40;
+static const int contextAfter = 80;
+
+/* The state of a search, which is shared with its worker. The worker may outlive
+   the search (and even FindAll) because it isn't waited for when it's stopped. */
+struct FindAllJob
+{
+    FindAllJob() : owner (nullptr), regex (false), regexJob (new RegexJob) {}
+
+    QMutex mutex; // for "owner"
+    FindAll *owner; // null when the matches of the worker aren't needed anymore
+    bool regex; // Is the worker in the regex pool?
+    QSharedPointer<RegexJob> regexJob; // the stop flag (and the regex pool state)
+};
+
+FindAll::FindAll (TextEdit *textEdit) :
+    QObject (textEdit),
+    textEdit_ (textEdit),
+    cs_ (Qt::CaseInsensitive),
+    wholeWords_ (false),
+    regex_ (false),
+    running_ (false),
+    truncated_ (false),
+    timedOut_ (false),
+    generation_ (0),
+    restartTimerId_ (0),
+    timeoutTimerId_ (0)
+{
+    qRegisterMetaType<QVector<FeatherPad::FindAllMatch> >("QVector<FeatherPad::FindAllMatch>");
+    connect (this, &FindAll::batchFound, this, &FindAll::addBatch, Qt::QueuedConnection);
+    connect (this, &FindAll::searchDone, this, &FindAll::onSearchDone, Qt::QueuedConnection);
+    connect (textEdit_->document(), &QTextDocument::contentsChanged, this, &FindAll::onContentsChanged);
+}
+/*************************/
+FindAll::~FindAll()
+{
+    stopWorker();
+}
+/*************************/
+// The worker isn't waited for because a regex match may not stop soon.
+void FindAll::stopWorker()
+{
+    generation_.ref(); // the batches of the old search will be ignored
+    if (timeoutTimerId_)
+    {
+        killTimer (timeoutTimerId_);
+        timeoutTimerId_ = 0;
+    }
+    if (job_)
+    {
+        {
+            QMutexLocker locker (&job_->mutex);
+            job_->owner = nullptr; // the worker won't emit any signal after this
+        }
+        if (job_->regex)
+            RegexFinder::abandon (job_->regexJob);
+        else
+            job_->regexJob->stop.store (1);
+        job_.clear();
+    }
+    running_ = false;
+}
+/*************************/
+void FindAll::cancel()
+{
+    if (restartTimerId_)
+    {
+        killTimer (restartTimerId_);
+        restartTimerId_ = 0;
+    }
+    stopWorker();
+    str_.clear();
+    matches_.clear();
+    truncated_ = false;
+}
+/*************************/
+void FindAll::start (const QString &str, Qt::CaseSensitivity cs, bool wholeWords, bool regex)
+{
+    cancel();
+    timedOut_ = false;
+    if (str.isEmpty()) return;
+    str_ = str;
+    cs_ = cs;
+    wholeWords_ = wholeWords;
+    regex_ = regex;
+    restart();
+}
+/*************************/
+void FindAll::restart()
+{
+    stopWorker();
+    matches_.clear();
+    truncated_ = false;
+    timedOut_ = false;
+    running_ = true;
+    emit started();
+
+    /* the snapshot is shared (not copied) with the worker but a huge
+       file is opened again because it may be closed meanwhile */
+    QString text, fileName, charset;
+    if (const LargeFile *largeFile = textEdit_->getLargeFile())
+    {
+        fileName = textEdit_->getFileName();
+        charset = largeFile->getCharset();
+    }
+    else
+        text = textEdit_->plainTextSnapshot();
+    const int generation = generation_.load();
+    const QString str = str_;
+    const Qt::CaseSensitivity cs = cs_;
+    const bool wholeWords = wholeWords_;
+    const bool regex = regex_;
+    QSharedPointer<FindAllJob> job (new FindAllJob);
+    job->owner = this;
+    job->regex = regex;
+    job_ = job;
+    if (regex)
+    {
+        RegexFinder::start (job->regexJob, [=] (const QAtomicInt*) {
+            search (job, generation, text, fileName, charset, str, cs, wholeWords, regex);
+            return QVector<RegexMatch>();
+        });
+        timeoutTimerId_ = startTimer (RegexFinder::timeout);
+    }
+    else
+    {
+        QtConcurrent::run ([=] {
+            search (job, generation, text, fileName, charset, str, cs, wholeWords, regex);
+        });
+    }
+}
+/*************************/
+void FindAll::onContentsChanged()
+{
+    /* the page of a huge file may change but the file is searched */
+    if (str_.isEmpty() || textEdit_->getLargeFile()) return;
+    /* the matches aren't valid anymore but the search is
+       restarted only when the user pauses typing */
+    stopWorker();
+    matches_.clear();
+    truncated_ = false;
+    running_ = true; // not finished yet
+    emit started();
+    if (restartTimerId_)
+        killTimer (restartTimerId_);
+    restartTimerId_ = startTimer (500);
+}
+/*************************/
+void FindAll::timerEvent (QTimerEvent *event)
+{
+    if (event->timerId() == timeoutTimerId_)
+    { // the found matches are kept
+        stopWorker();
+        timedOut_ = true;
+        emit finished();
+        return;
+    }
+    if (event->timerId() == restartTimerId_)
+    {
+        killTimer (restartTimerId_);
+        restartTimerId_ = 0;
+        if (!str_.isEmpty() && !textEdit_->isStreaming())
+            restart();
+        else if (!str_.isEmpty()) // wait until the whole text is loaded
+            restartTimerId_ = startTimer (500);
+        return;
+    }
+    QObject::timerEvent (event);
+}
+/*************************/
+void FindAll::addBatch (int generation, const QVector<FindAllMatch> &batch)
+{
+    if (generation != generation_.load()) return;
+    const int first = matches_.size();
+    matches_ += batch;
+    emit matchesAdded (first, batch.size());
+}
+/*************************/
+void FindAll::onSearchDone (int generation, bool truncated)
+{
+    if (generation != generation_.load()) return;
+    if (timeoutTimerId_)
+    {
+        killTimer (timeoutTimerId_);
+        timeoutTimerId_ = 0;
+    }
+    running_ = false;
+    truncated_ = truncated;
+    emit finished();
+}
+/*************************/
+int FindAll::indexOf (qint64 line, int column) const
+{
+    /* the matches are sorted */
+    int lo = 0, hi = matches_.size();
+    while (lo < hi)
+    {
+        const int mid = (lo + hi) / 2;
+        const FindAllMatch &m = matches_.at (mid);
+        if (m.line < line || (m.line == line && m.column < column))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo < matches_.size() && matches_.at (lo).line == line && matches_.at (lo).column == column)
+        return lo;
+    return -1;
+}
+/*************************/
+// The line of the match, starting from its start and without tabs.
+QString FindAll::context (const QString &text, int lineStart, int pos, int length)
+{
+    const int start = qMax (lineStart, pos - contextBefore);
+    const int end = qMin (text.length(), pos + length + contextAfter);
+    QString res = text.mid (start, end - start);
+    const int nl = res.indexOf (QLatin1Char ('\n'), pos - start);
+    if (nl > -1)
+        res.truncate (nl);
+    res.replace (QLatin1Char ('\t'), QLatin1Char (' '));
+    if (start > lineStart)
+        res.prepend (QChar (0x2026));
+    return res;
+}
+/*************************/
+// Runs in a worker thread. The signals are emitted only while the search is needed.
+void FindAll::search (const QSharedPointer<FindAllJob> &job, int generation, const QString text,
+                      const QString fileName, const QString charset,
+                      const QString str, Qt::CaseSensitivity cs, bool wholeWords, bool regex)
+{
+    const QAtomicInt *stop = &job->regexJob->stop;
+    auto batchFound = [job, generation] (const QVector<FindAllMatch> &batch) {
+        QMutexLocker locker (&job->mutex);
+        if (job->owner)
+            emit job->owner->batchFound (generation, batch, QPrivateSignal());
+    };
+    bool truncated = false;
+    if (!fileName.isEmpty())
+    {
+        const LargeFile largeFile (fileName, charset);
+        if (largeFile.isValid())
+            truncated = find (QString(), &largeFile, str, cs, wholeWords, regex, maxMatches, stop, batchFound);
+    }
+    else
+        truncated = find (text, nullptr, str, cs, wholeWords, regex, maxMatches, stop, batchFound);
+    QMutexLocker locker (&job->mutex);
+    if (job->owner)
+        emit job->owner->searchDone (generation, truncated, QPrivateSignal());
+}
+/*************************/
+// A huge file is searched in parts of at most LargeFile::maxTextBytes bytes, which may split
+// long lines. Each part is extended by a few bytes, so that the matches that start in it
+// are found completely (but a regex match that is too long may be cut).
+bool FindAll::find (const QString &text, const LargeFile *largeFile,
+                    const QString &str, Qt::CaseSensitivity cs, bool wholeWords, bool regex,
+                    int maxCount, const QAtomicInt *stop,
+                    const std::function<void (const QVector<FindAllMatch>&)> &batchFound)
+{
+    const TextFinder finder (str, cs, wholeWords);
+    const RegexFinder regexFinder (regex ? str : QString(), cs);
+    const int n = finder.length();
+    /* a character of the string can't have more than 4 bytes in the supported charsets */
+    const qint64 extension = regex ? regexExtension : 4 * static_cast<qint64>(str.length());
+    const qint64 size = largeFile ? largeFile->size() : 0;
+    QVector<FindAllMatch> batch;
+    int count = 0;
+    bool truncated = false;
+    QElapsedTimer timer;
+    timer.start();
+
+    qint64 offset = 0; // the byte of the huge file where the current part starts
+    qint64 line = 0; // the line of the current position
+    qint64 columnBase = 0; // the characters of the line before the current part
+    int skip = 0; // the characters at the start of the current part that are in the last match
+    bool done = false;
+    while (!done && !truncated && stop->load() == 0)
+    {
+        QString txt;
+        int limit; // matches should start before it
+        if (largeFile)
+        {
+            const qint64 end = largeFile->partEnd (offset);
+            txt = largeFile->decode (offset, end);
+            limit = txt.length();
+            if (end < size)
+                txt += largeFile->decode (end, largeFile->boundary (qMin (size, end + extension)));
+            offset = end;
+            done = end >= size;
+        }
+        else
+        { // a document is searched at once
+            txt = text;
+            limit = txt.length();
+            done = true;
+        }
+
+        int lineStart = 0; // zero if the part doesn't have a newline before the current position
+        int counted = 0; // the newlines before it are counted
+        int pos = skip;
+        while (pos < limit && stop->load() == 0)
+        {
+            /* find the next matches (in a slice of the text if the string isn't a regex) */
+            QVector<RegexMatch> found;
+            if (regex)
+            {
+                found = regexFinder.search (txt, pos, limit, regexMatches, QString(), stop);
+                if (found.isEmpty())
+                    pos = limit;
+            }
+            else
+            {
+                const int sliceEnd = qMin (limit, pos + sliceLength);
+                int i = pos;
+                while ((i = finder.findForward (txt, i, sliceEnd)) != -1)
+                {
+                    RegexMatch m;
+                    m.position = i;
+                    m.length = n;
+                    found.append (m);
+                    i += n;
+                }
+                pos = sliceEnd;
+            }
+
+            for (int i = 0; i < found.size(); ++i)
+            {
+                const RegexMatch &m = found.at (i);
+                for (; counted < m.position; ++counted)
+                {
+                    if (txt.at (counted) == QLatin1Char ('\n'))
+                    {
+                        ++line;
+                        lineStart = counted + 1;
+                    }
+                }
+                FindAllMatch match;
+                match.line = line;
+                match.column = static_cast<int>(qMin (m.position - lineStart + (lineStart == 0 ? columnBase : 0),
+                                                      static_cast<qint64>(INT_MAX)));
+                match.length = m.length;
+                if (count < maxListed)
+                    match.context = context (txt, lineStart, m.position, m.length);
+                batch.append (match);
+                pos = qMax (pos, m.position + m.length);
+                if (++count == maxCount)
+                {
+                    truncated = true;
+                    break;
+                }
+            }
+            if (truncated) break;
+            if (!batch.isEmpty() && timer.elapsed() >= batchInterval)
+            {
+                batchFound (batch);
+                batch.clear();
+                timer.restart();
+            }
+        }
+        if (truncated || !largeFile) break;
+
+        /* count the remaining newlines of the part for the next one */
+        const int lastNewline = limit > 0 ? txt.lastIndexOf (QLatin1Char ('\n'), limit - 1) : -1;
+        if (lastNewline >= counted)
+        {
+            line += txt.midRef (counted, lastNewline + 1 - counted).count (QLatin1Char ('\n'));
+            lineStart = lastNewline + 1;
+        }
+        columnBase = lineStart == 0 ? columnBase + limit : limit - lineStart;
+        skip = qMax (0, pos - limit);
+    }
+
+    if (!batch.isEmpty())
+        batchFound (batch);
+    return truncated;
+}
+
+}
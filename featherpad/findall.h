@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014 <tsujan2000@gmail.com>
+ *
+ * FeatherPad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FeatherPad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FINDALL_H
+#define FINDALL_H
+
+#include <QObject>
+#include <QVector>
+#include <QAtomicInt>
+#include <QSharedPointer>
+#include <functional>
+
+namespace FeatherPad {
+
+class TextEdit;
+class LargeFile;
+struct FindAllJob;
+
+struct FindAllMatch
+{
+    qint64 line; // the line of the start of the match
+    int column; // the start of the match in its line
+    int length;
+    QString context; // the text around the match (only for listed matches)
+};
+
+/* Finds all matches of a string in the document of a text edit (or in its huge
+   file) with a worker thread. The document's text is searched in its snapshot,
+   so that it can be edited meanwhile. The matches are added in batches and
+   the search is restarted with the same query after the document is changed.
+   A worker is never waited for: when it's stopped, its matches are just ignored.
+   A regular expression is searched for in the regex pool and is given up after
+   a timeout. */
+class FindAll : public QObject
+{
+    Q_OBJECT
+public:
+    FindAll (TextEdit *textEdit);
+    ~FindAll();
+
+    /* "wholeWords" is ignored if "str" is a regular expression */
+    void start (const QString &str, Qt::CaseSensitivity cs, bool wholeWords, bool regex);
+    /* stops searching and forgets the query and its matches */
+    void cancel();
+
+    QString query() const {
+        return str_;
+    }
+    /* Is this the current query? */
+    bool hasQuery (const QString &str, Qt::CaseSensitivity cs, bool wholeWords, bool regex) const {
+        return !str_.isEmpty() && str == str_ && cs == cs_ && wholeWords == wholeWords_ && regex == regex_;
+    }
+    bool isRunning() const {
+        return running_;
+    }
+    /* Was the search stopped because of too many matches? */
+    bool isTruncated() const {
+        return truncated_;
+    }
+    /* Was the search for a regular expression abandoned because it took too long? */
+    bool isTimedOut() const {
+        return timedOut_;
+    }
+    const QVector<FindAllMatch> &matches() const {
+        return matches_;
+    }
+    /* the index of the match that starts at the given point, or -1 */
+    int indexOf (qint64 line, int column) const;
+
+    /* The search of the worker, which can be used for any text or huge file. The matches
+       are given to "batchFound" in batches and the search is stopped after "maxCount"
+       matches (and true is returned) or when "*stop" isn't zero. */
+    static bool find (const QString &text, const LargeFile *largeFile,
+                      const QString &str, Qt::CaseSensitivity cs, bool wholeWords, bool regex,
+                      int maxCount, const QAtomicInt *stop,
+                      const std::function<void (const QVector<FindAllMatch>&)> &batchFound);
+
+    static const int maxMatches = 1000000; // the search is stopped after finding them
+    static const int maxListed = 10000; // only these matches have contexts
+
+signals:
+    void started(); // the old matches are removed
+    void matchesAdded (int first, int count);
+    void finished();
+    /* emitted by the worker */
+    void batchFound (int generation, const QVector<FeatherPad::FindAllMatch> &batch, QPrivateSignal);
+    void searchDone (int generation, bool truncated, QPrivateSignal);
+
+protected:
+    void timerEvent (QTimerEvent *event);
+
+private slots:
+    void addBatch (int generation, const QVector<FeatherPad::FindAllMatch> &batch);
+    void onSearchDone (int generation, bool truncated);
+    void onContentsChanged();
+
+private:
+    static void search (const QSharedPointer<FindAllJob> &job, int generation, const QString text,
+                        const QString fileName, const QString charset,
+                        const QString str, Qt::CaseSensitivity cs, bool wholeWords, bool regex);
+    static QString context (const QString &text, int lineStart, int pos, int length);
+    void stopWorker();
+    void restart();
+
+    TextEdit *textEdit_;
+    QString str_; // the query (empty if there's none)
+    Qt::CaseSensitivity cs_;
+    bool wholeWords_;
+    bool regex_;
+    QVector<FindAllMatch> matches_;
+    bool running_;
+    bool truncated_;
+    bool timedOut_;
+    QAtomicInt generation_; // incremented when the matches of the worker become invalid
+    QSharedPointer<FindAllJob> job_; // shared with the current worker
+    int restartTimerId_; // for restarting after the document is changed
+    int timeoutTimerId_; // for giving up a regex search
+};
+
+}
+
+Q_DECLARE_METATYPE(FeatherPad::FindAllMatch)
+
+#endif // FINDALL_H
@@ -24,12 +24,14 @@
 #include "session.h"
 #include "loading.h"
 #include "warningbar.h"
+#include "textwriter.h"
+#include "multifind.h"
 
 #include <QFontDialog>
 #include <QPrintDialog>
 #include <QToolTip>
 #include <QDesktopWidget>
-#include <fstream> // std::ofstream
+#include <climits> // INT_MAX
 #include <QPrinter>
 
 #include "x11.h"
@@ -53,6 +55,12 @@ FPwin::FPwin (QWidget *parent):QMainWindow (parent), dummyWidget (nullptr), ui (
 
     loadingProcesses_ = 0;
     rightClicked_ = -1;
+    pendingFind_.revision = pendingFind_.anchor = pendingFind_.position = -1;
+    pendingFind_.newSearch = pendingFind_.all = false;
+    pendingReplace_ = pendingFind_;
+    visibleRegex_.revision = pendingVisible_.revision = -1;
+    visibleRegex_.cs = pendingVisible_.cs = Qt::CaseInsensitive;
+    visibleRegex_.from = visibleRegex_.to = pendingVisible_.from = pendingVisible_.to = 0;
     busyThread_ = nullptr;
 
     /* JumpTo bar*/
@@ -90,6 +98,21 @@ FPwin::FPwin (QWidget *parent):QMainWindow (parent), dummyWidget (nullptr), ui (
     ui->toolButtonAll->setToolTip (tr ("Replace all") + " (" + tr ("F9") + ")");
     ui->dockReplace->setVisible (false);
 
+    /* find-all dock */
+    ui->dockFindAll->setVisible (false);
+
+    /* the dock of the matches in all documents */
+    ui->dockFindDocs->setVisible (false);
+    multiFind_ = new MultiFind (this);
+
+    /* the searches for regular expressions in worker threads */
+    findSearch_ = new RegexSearch (this);
+    visibleSearch_ = new RegexSearch (this);
+    replaceSearch_ = new RegexSearch (this);
+    connect (findSearch_, &RegexSearch::finished, this, &FPwin::onRegexFound);
+    connect (visibleSearch_, &RegexSearch::finished, this, &FPwin::onVisibleRegexFound);
+    connect (replaceSearch_, &RegexSearch::finished, this, &FPwin::onRegexReplaceFound);
+
     applyConfig();
 
     QWidget* spacer = new QWidget();
@@ -195,6 +218,19 @@ FPwin::FPwin (QWidget *parent):QMainWindow (parent), dummyWidget (nullptr), ui (
     connect (ui->dockReplace, &QDockWidget::visibilityChanged, this, &FPwin::closeReplaceDock);
     connect (ui->dockReplace, &QDockWidget::topLevelChanged, this, &FPwin::resizeDock);
 
+    connect (ui->actionFindAll, &QAction::triggered, this, &FPwin::findAllDock);
+    connect (ui->dockFindAll, &QDockWidget::visibilityChanged, this, &FPwin::findAllDockVisibility);
+    connect (ui->listWidgetFindAll, &QListWidget::itemClicked, this, &FPwin::goToMatch);
+    connect (ui->listWidgetFindAll, &QListWidget::itemActivated, this, &FPwin::goToMatch);
+
+    connect (ui->actionFindDocs, &QAction::triggered, this, &FPwin::findDocsDock);
+    connect (ui->dockFindDocs, &QDockWidget::visibilityChanged, this, &FPwin::findDocsDockVisibility);
+    connect (ui->treeWidgetFindDocs, &QTreeWidget::itemClicked, this, &FPwin::goToDocMatch);
+    connect (ui->treeWidgetFindDocs, &QTreeWidget::itemActivated, this, &FPwin::goToDocMatch);
+    connect (multiFind_, &MultiFind::started, this, &FPwin::findDocsStarted);
+    connect (multiFind_, &MultiFind::documentSearched, this, &FPwin::listDocMatches);
+    connect (multiFind_, &MultiFind::finished, this, &FPwin::findDocsFinished);
+
     connect (ui->actionDoc, &QAction::triggered, this, &FPwin::docProp);
     connect (ui->actionPrint, &QAction::triggered, this, &FPwin::filePrint);
 
@@ -787,6 +823,10 @@ void FPwin::enableWidgets (bool enable) const
 {
     if (!enable && ui->dockReplace->isVisible())
         ui->dockReplace->setVisible (false);
+    if (!enable && ui->dockFindAll->isVisible())
+        ui->dockFindAll->setVisible (false);
+    if (!enable && ui->dockFindDocs->isVisible())
+        ui->dockFindDocs->setVisible (false);
     if (!enable && ui->spinBox->isVisible())
     {
         ui->spinBox->setVisible (false);
@@ -803,6 +843,8 @@ void FPwin::enableWidgets (bool enable) const
 
     ui->actionSelectAll->setEnabled (enable);
     ui->actionFind->setEnabled (enable);
+    ui->actionFindAll->setEnabled (enable);
+    ui->actionFindDocs->setEnabled (enable);
     ui->actionJump->setEnabled (enable);
     ui->actionReplace->setEnabled (enable);
     ui->actionClose->setEnabled (enable);
@@ -845,6 +887,8 @@ void FPwin::disableShortcuts (bool disable, bool page)
         ui->actionOpen->setShortcut (QKeySequence());
         ui->actionSave->setShortcut (QKeySequence());
         ui->actionFind->setShortcut (QKeySequence());
+        ui->actionFindAll->setShortcut (QKeySequence());
+        ui->actionFindDocs->setShortcut (QKeySequence());
         ui->actionReplace->setShortcut (QKeySequence());
         ui->actionSaveAs->setShortcut (QKeySequence());
         ui->actionPrint->setShortcut (QKeySequence());
@@ -884,6 +928,8 @@ void FPwin::disableShortcuts (bool disable, bool page)
         ui->actionOpen->setShortcut (QKeySequence (tr ("Ctrl+O")));
         ui->actionSave->setShortcut (QKeySequence (tr ("Ctrl+S")));
         ui->actionFind->setShortcut (QKeySequence (tr ("Ctrl+F")));
+        ui->actionFindAll->setShortcut (QKeySequence (tr ("Ctrl+Shift+F")));
+        ui->actionFindDocs->setShortcut (QKeySequence (tr ("Ctrl+Alt+F")));
         ui->actionReplace->setShortcut (QKeySequence (tr ("Ctrl+R")));
         ui->actionSaveAs->setShortcut (QKeySequence (tr ("Ctrl+Shift+S")));
         ui->actionPrint->setShortcut (QKeySequence (tr ("Ctrl+P")));
@@ -1437,8 +1483,12 @@ void FPwin::loadText (const QString fileName, bool enforceEncod, bool reload, bo
     QString charset;
     if (enforceEncod)
         charset = checkToEncoding();
-    Loading *thread = new Loading (fileName, charset, reload, multiple);
+    Config& config = static_cast<FPsingleton*>(qApp)->getConfig();
+    Loading *thread = new Loading (fileName, charset, reload, multiple,
+                                   config.getCharsetSampleSize() * 1024);
     connect (thread, &Loading::completed, this, &FPwin::addText);
+    connect (thread, &Loading::chunkLoaded, this, &FPwin::addChunk);
+    connect (thread, &Loading::charsetChanged, this, &FPwin::restartChunks);
     connect (thread, &Loading::finished, thread, &QObject::deleteLater);
     thread->start();
 
@@ -1525,6 +1575,10 @@ void FPwin::addText (const QString text, const QString fileName, const QString c
         anchor = textEdit->textCursor().anchor();
     }
 
+    /* a huge file is shown page by page (the text is its first page) */
+    Loading *thread = qobject_cast< Loading *>(QObject::sender());
+    textEdit->setLargeFile (thread ? thread->takeLargeFile() : nullptr);
+
     /* set the text */
     disconnect (textEdit->document(), &QTextDocument::modificationChanged, ui->actionSave, &QAction::setEnabled);
     disconnect (textEdit->document(), &QTextDocument::modificationChanged, this, &FPwin::asterisk);
@@ -1532,6 +1586,10 @@ void FPwin::addText (const QString text, const QString fileName, const QString c
     connect (textEdit->document(), &QTextDocument::modificationChanged, ui->actionSave, &QAction::setEnabled);
     connect (textEdit->document(), &QTextDocument::modificationChanged, this, &FPwin::asterisk);
 
+    /* the rest of a huge file will come in chunks (see addChunk) */
+    if (thread && thread->isProgressive())
+        streamingTabs_.insert (thread, tabPage);
+
     /* now, restore the cursor */
     if (reload)
     {
@@ -1596,7 +1654,19 @@ void FPwin::addText (const QString text, const QString fileName, const QString c
     QString elidedTip = metrics.elidedText (tip, Qt::ElideMiddle, w);
     ui->tabWidget->setTabToolTip (ui->tabWidget->indexOf (tabPage), elidedTip);
 
-    if (alreadyOpen (tabPage))
+    if (textEdit->getLargeFile())
+    { // the paged viewer is read-only
+        textEdit->setReadOnly (true);
+        if (!multiple || openInCurrentTab)
+        {
+            ui->actionCut->setDisabled (true);
+            ui->actionPaste->setDisabled (true);
+            ui->actionDelete->setDisabled (true);
+        }
+        disconnect (textEdit, &QPlainTextEdit::copyAvailable, ui->actionCut, &QAction::setEnabled);
+        disconnect (textEdit, &QPlainTextEdit::copyAvailable, ui->actionDelete, &QAction::setEnabled);
+    }
+    else if (alreadyOpen (tabPage))
     {
         textEdit->setReadOnly (true);
         if (!textEdit->hasDarkScheme())
@@ -1652,11 +1722,80 @@ void FPwin::addText (const QString text, const QString fileName, const QString c
     }
 }
 /*************************/
+// The chunks of a huge file are appended to its text-edit in time slices.
+void FPwin::addChunk (const QString chunk, int progress)
+{
+    Loading *thread = qobject_cast< Loading *>(QObject::sender());
+    if (!thread) return;
+    QPointer<TabPage> tabPage = streamingTabs_.value (thread);
+    if (tabPage.isNull())
+    { // the tab is closed; stop loading
+        streamingTabs_.remove (thread);
+        thread->stop();
+        return;
+    }
+    if (progress >= 100)
+        streamingTabs_.remove (thread);
+
+    TextEdit *textEdit = tabPage->textEdit();
+    startStreaming (textEdit);
+    textEdit->appendChunk (chunk, progress);
+}
+/*************************/
+void FPwin::startStreaming (TextEdit *textEdit)
+{
+    if (!textEdit->isStreaming())
+    { // appending text shouldn't change the modification state
+        disconnect (textEdit->document(), &QTextDocument::modificationChanged, ui->actionSave, &QAction::setEnabled);
+        disconnect (textEdit->document(), &QTextDocument::modificationChanged, this, &FPwin::asterisk);
+        connect (textEdit, &TextEdit::streamingFinished, this, &FPwin::onStreamingFinished, Qt::UniqueConnection);
+    }
+}
+/*************************/
+// The charset of a huge file was guessed from a sample but decoding found invalid
+// sequences later. The received text is removed because it will be sent again.
+void FPwin::restartChunks (const QString charset)
+{
+    Loading *thread = qobject_cast< Loading *>(QObject::sender());
+    if (!thread) return;
+    QPointer<TabPage> tabPage = streamingTabs_.value (thread);
+    if (tabPage.isNull())
+    {
+        streamingTabs_.remove (thread);
+        thread->stop();
+        return;
+    }
+
+    TextEdit *textEdit = tabPage->textEdit();
+    startStreaming (textEdit);
+    textEdit->discardChunks();
+    textEdit->setEncoding (charset);
+    if (ui->tabWidget->currentWidget() == tabPage)
+        encodingToCheck (charset);
+}
+/*************************/
+void FPwin::onStreamingFinished()
+{
+    TextEdit *textEdit = qobject_cast< TextEdit *>(QObject::sender());
+    if (!textEdit) return;
+    disconnect (textEdit, &TextEdit::streamingFinished, this, &FPwin::onStreamingFinished);
+    connect (textEdit->document(), &QTextDocument::modificationChanged, ui->actionSave, &QAction::setEnabled);
+    connect (textEdit->document(), &QTextDocument::modificationChanged, this, &FPwin::asterisk);
+    textEdit->setWordNumber (-1);
+    if (ui->tabWidget->currentWidget() == textEdit->parentWidget())
+    {
+        bool readOnly = textEdit->isReadOnly();
+        ui->actionPaste->setEnabled (!readOnly);
+        if (ui->statusBar->isVisible())
+            statusMsgWithLineCount (textEdit->document()->blockCount());
+    }
+}
+/*************************/
 void FPwin::onOpeningHugeFiles()
 {
     disconnect (this, &FPwin::finishedLoading, this, &FPwin::onOpeningHugeFiles);
     showWarningBar ("<center><b><big>" + tr ("Huge file(s) not opened!") + "</big></b></center>\n"
-                    + "<center>" + tr ("FeatherPad does not open files larger than 500 MiB.") + "</center>");
+                    + "<center>" + tr ("Files larger than 500 MiB cannot be opened if they are UTF-16 or UTF-32 encoded.") + "</center>");
 }
 /*************************/
 void FPwin::showWarningBar (const QString& message)
@@ -1809,6 +1948,11 @@ void FPwin::enforceEncoding (QAction*)
     if (index == -1) return;
 
     TextEdit *textEdit = qobject_cast< TabPage *>(ui->tabWidget->widget (index))->textEdit();
+    if (textEdit->isStreaming())
+    { // wait until the text is loaded completely
+        encodingToCheck (textEdit->getEncoding());
+        return;
+    }
     QString fname = textEdit->getFileName();
     if (!fname.isEmpty())
     {
@@ -1846,6 +1990,8 @@ void FPwin::reload()
 
     int index = ui->tabWidget->currentIndex();
     if (index == -1) return;
+    if (qobject_cast< TabPage *>(ui->tabWidget->widget (index))->textEdit()->isStreaming())
+        return;
 
     if (unSaved (index, false)) return;
 
@@ -1863,6 +2009,13 @@ bool FPwin::saveFile (bool keepSyntax)
     if (index == -1) return false;
 
     TextEdit *textEdit = qobject_cast< TabPage *>(ui->tabWidget->widget (index))->textEdit();
+    if (textEdit->isStreaming()) return false; // the text isn't loaded completely
+    if (textEdit->getLargeFile())
+    {
+        showWarningBar ("<center><b><big>" + tr ("Huge files are read-only!") + "</big></b></center>\n"
+                        + "<center>" + tr ("Files larger than 500 MiB are shown page by page and cannot be saved.") + "</center>");
+        return false;
+    }
     QString fname = textEdit->getFileName();
     if (fname.isEmpty()) fname = lastFile_;
     QString filter = tr ("All Files (*)");
@@ -2011,8 +2164,8 @@ bool FPwin::saveFile (bool keepSyntax)
     }
 
     /* now, try to write */
-    QTextDocumentWriter writer (fname, "plaintext");
-    bool success = false;
+    QTextCodec *codec = QTextCodec::codecForName ("UTF-8"); // the default encoding
+    bool windowsEol = false;
     if (QObject::sender() == ui->actionSaveCodec)
     {
         QString encoding  = checkToEncoding();
@@ -2030,45 +2183,13 @@ bool FPwin::saveFile (bool keepSyntax)
         msgBox.setText ("<center>" + tr ("Do you want to use <b>MS Windows</b> end-of-lines?") + "</center>");
         msgBox.setInformativeText ("<center><i>" + tr ("This may be good for readability under MS Windows.") + "</i></center>");
         msgBox.setWindowModality (Qt::WindowModal);
-        QString contents;
-        int ln;
-        QTextCodec *codec;
-        QByteArray encodedString;
-        const char *txt;
         switch (msgBox.exec()) {
         case QMessageBox::Yes:
-            contents = textEdit->document()->toPlainText();
-            contents.replace ("\n", "\r\n");
-            ln = contents.length(); // for fwrite();
-            codec = QTextCodec::codecForName (checkToEncoding().toUtf8());
-            encodedString = codec->fromUnicode (contents);
-            txt = encodedString.constData();
-            if (encoding != "UTF-16")
-            {
-                std::ofstream file;
-                file.open (fname.toUtf8().constData());
-                if (file.is_open())
-                {
-                    file << txt;
-                    file.close();
-                    success = true;
-                }
-            }
-            else
-            {
-                FILE * file;
-                file = fopen (fname.toUtf8().constData(), "wb");
-                if (file != nullptr)
-                {
-                    /* this worked correctly as I far as I tested */
-                    fwrite (txt , 2 , ln + 1 , file);
-                    fclose (file);
-                    success = true;
-                }
-            }
+            windowsEol = true;
+            codec = QTextCodec::codecForName (encoding.toUtf8());
             break;
         case QMessageBox::No:
-            writer.setCodec (QTextCodec::codecForName (encoding.toUtf8()));
+            codec = QTextCodec::codecForName (encoding.toUtf8());
             break;
         default:
             disableShortcuts (false);
@@ -2077,8 +2198,9 @@ bool FPwin::saveFile (bool keepSyntax)
         }
         disableShortcuts (false);
     }
-    if (!success)
-        success = writer.write (textEdit->document());
+    if (!codec) // prevent any chance of crash if there's a bug
+        codec = QTextCodec::codecForName ("UTF-8");
+    bool success = writeDocument (textEdit->document(), fname, codec, windowsEol);
 
     if (success)
     {
@@ -2236,9 +2358,13 @@ void FPwin::makeEditable()
     if (index == -1) return;
 
     TextEdit *textEdit = qobject_cast< TabPage *>(ui->tabWidget->widget (index))->textEdit();
+    if (textEdit->getLargeFile()) return; // the paged viewer is always read-only
     bool textIsSelected = textEdit->textCursor().hasSelection();
 
-    textEdit->setReadOnly (false);
+    if (textEdit->isStreaming()) // it'll be editable after the text is loaded
+        textEdit->setReadOnlyAfterLoading (false);
+    else
+        textEdit->setReadOnly (false);
     Config config = static_cast<FPsingleton*>(qApp)->getConfig();
     if (!textEdit->hasDarkScheme())
     {
@@ -2339,6 +2465,10 @@ void FPwin::tabSwitch (int index)
        the replace dock may have been closed, hlight() will be called automatically */
     //if (!textEdit->getSearchedText().isEmpty()) hlight();
 
+    /* list the matches of the new tab (they may be found already) */
+    if (ui->dockFindAll->isVisible())
+        findAll();
+
     /* correct the encoding menu */
     encodingToCheck (textEdit->getEncoding());
 
@@ -2377,7 +2507,7 @@ void FPwin::tabSwitch (int index)
 
     /* handle the spinbox */
     if (ui->spinBox->isVisible())
-        ui->spinBox->setMaximum (textEdit->document()->blockCount());
+        ui->spinBox->setMaximum (static_cast<int>(qMin (textEdit->totalLineCount(), static_cast<qint64>(INT_MAX))));
 
     /* handle the statusbar */
     if (ui->statusBar->isVisible())
@@ -2560,9 +2690,8 @@ void FPwin::jumpTo()
     if (tabPage)
     {
         if (!visibility && ui->tabWidget->count() > 0)
-            ui->spinBox->setMaximum (tabPage->textEdit()
-                                     ->document()
-                                     ->blockCount());
+            ui->spinBox->setMaximum (static_cast<int>(qMin (tabPage->textEdit()->totalLineCount(),
+                                                            static_cast<qint64>(INT_MAX))));
     }
     ui->spinBox->setVisible (!visibility);
     ui->label->setVisible (!visibility);
@@ -2578,7 +2707,14 @@ void FPwin::jumpTo()
 /*************************/
 void FPwin::setMax (const int max)
 {
-    ui->spinBox->setMaximum (max);
+    TabPage *tabPage = qobject_cast< TabPage *>(ui->tabWidget->currentWidget());
+    if (tabPage && tabPage->textEdit()->getLargeFile())
+    { // the document has only one page of the huge file
+        ui->spinBox->setMaximum (static_cast<int>(qMin (tabPage->textEdit()->totalLineCount(),
+                                                        static_cast<qint64>(INT_MAX))));
+    }
+    else
+        ui->spinBox->setMaximum (max);
 }
 /*************************/
 void FPwin::goTo()
@@ -2590,6 +2726,11 @@ void FPwin::goTo()
     if (TabPage *tabPage = qobject_cast< TabPage *>(ui->tabWidget->currentWidget()))
     {
         TextEdit *textEdit = tabPage->textEdit();
+        if (textEdit->getLargeFile())
+        {
+            textEdit->showLargeFileLine (ui->spinBox->value() - 1);
+            return;
+        }
         QTextBlock block = textEdit->document()->findBlockByNumber (ui->spinBox->value() - 1);
         int pos = block.position();
         QTextCursor start = textEdit->textCursor();
@@ -2797,7 +2938,8 @@ void FPwin::statusMsgWithLineCount (const int lines)
     QString syntaxStr;
     if (!textEdit->getProg().isEmpty())
         syntaxStr = "&nbsp;&nbsp;&nbsp;&nbsp;<b>" + tr ("Syntax") + QString (":</b> <i>%1</i>").arg (textEdit->getProg());
-    QString lineStr = "&nbsp;&nbsp;&nbsp;&nbsp;<b>" + tr ("Lines") + QString (":</b> <i>%1</i>").arg (lines);
+    qint64 allLines = textEdit->getLargeFile() ? textEdit->totalLineCount() : lines;
+    QString lineStr = "&nbsp;&nbsp;&nbsp;&nbsp;<b>" + tr ("Lines") + QString (":</b> <i>%1</i>").arg (allLines);
     QString selStr = "&nbsp;&nbsp;&nbsp;&nbsp;<b>" + tr ("Sel. Chars")
                      + QString (":</b> <i>%1</i>").arg (textEdit->textCursor().selectedText().size());
     QString wordStr = "&nbsp;&nbsp;&nbsp;&nbsp;<b>" + tr ("Words") + ":</b>";
@@ -2953,7 +3095,8 @@ void FPwin::detachTab()
     if (!isReady()) return;
 
     int index = ui->tabWidget->currentIndex();
-    if (index == -1 || ui->tabWidget->count() == 1)
+    if (index == -1 || ui->tabWidget->count() == 1
+        || qobject_cast< TabPage *>(ui->tabWidget->widget (index))->textEdit()->isStreaming())
     {
         ui->tabWidget->tabBar()->finishMouseMoveEvent();
         return;
@@ -3056,7 +3199,7 @@ void FPwin::detachTab()
     {
         dropTarget->ui->spinBox->setVisible (true);
         dropTarget->ui->label->setVisible (true);
-        dropTarget->ui->spinBox->setMaximum (textEdit->document()->blockCount());
+        dropTarget->ui->spinBox->setMaximum (static_cast<int>(qMin (textEdit->totalLineCount(), static_cast<qint64>(INT_MAX))));
         connect (textEdit->document(), &QTextDocument::blockCountChanged, dropTarget, &FPwin::setMax);
     }
     if (ln)
@@ -3158,7 +3301,8 @@ void FPwin::dropTab (QString str)
         }
     }
     if (dragSource == this
-        || dragSource == nullptr) // impossible
+        || dragSource == nullptr // impossible
+        || qobject_cast< TabPage *>(dragSource->ui->tabWidget->widget (index))->textEdit()->isStreaming())
     {
         ui->tabWidget->tabBar()->finishMouseMoveEvent();
         return;
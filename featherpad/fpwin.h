@@ -20,10 +20,13 @@
 
 #include <QMainWindow>
 #include <QActionGroup>
+#include <QListWidgetItem>
+#include <QTreeWidgetItem>
 #include "highlighter.h"
 #include "textedit.h"
 #include "tabpage.h"
 #include "config.h"
+#include "regexfinder.h"
 
 namespace FeatherPad {
 
@@ -31,6 +34,10 @@ namespace Ui {
 class FPwin;
 }
 
+class Loading;
+class MultiFind;
+struct FindAllMatch;
+
 class BusyMaker : public QObject {
     Q_OBJECT
 
@@ -114,6 +121,9 @@ private slots:
     void find (bool forward);
     void hlight() const;
     void hlighting (const QRect&, int dy) const;
+    void onRegexFound (const QVector<FeatherPad::RegexMatch> &matches, bool timedOut);
+    void onVisibleRegexFound (const QVector<FeatherPad::RegexMatch> &matches, bool timedOut);
+    void onRegexReplaceFound (const QVector<FeatherPad::RegexMatch> &matches, bool timedOut);
     void searchFlagChanged();
     void showHideSearch();
     void showLN (bool checked);
@@ -128,6 +138,21 @@ private slots:
     void closeReplaceDock (bool visible);
     void replaceDock();
     void resizeDock (bool topLevel);
+    void findAllDock();
+    void findAllDockVisibility (bool visible);
+    void findAll();
+    void findAllStarted();
+    void listMatches (int first, int count);
+    void findAllFinished();
+    void updateMatchInfo();
+    void goToMatch (QListWidgetItem *item);
+    void findDocsDock();
+    void findDocsDockVisibility (bool visible);
+    void findInDocs();
+    void findDocsStarted();
+    void listDocMatches (int index);
+    void findDocsFinished();
+    void goToDocMatch (QTreeWidgetItem *item);
     void jumpTo();
     void setMax (const int max);
     void goTo();
@@ -160,6 +185,9 @@ private slots:
                   bool enforceEncod, bool reload,
                   bool multiple); // Multiple files are being loaded?
     void onOpeningHugeFiles();
+    void addChunk (const QString chunk, int progress);
+    void restartChunks (const QString charset);
+    void onStreamingFinished();
 
 public:
     QWidget *dummyWidget; // Bypasses KDE's demand for a new window.
@@ -184,16 +212,14 @@ private:
     void enableWidgets (bool enable) const;
     void disableShortcuts (bool disable, bool page = true);
     QTextCursor finding (const QString str, const QTextCursor& start, QTextDocument::FindFlags flags = 0,
-                         const int end = 0) const;
+                         const int end = 0);
     void setProgLang (TextEdit *textEdit);
     void syntaxHighlighting (TextEdit *textEdit);
     void encodingToCheck (const QString& encoding);
     const QString checkToEncoding() const;
     void applyConfig();
-    bool matchLeftParenthesis (QTextBlock currentBlock, int index, int numRightParentheses);
-    bool matchRightParenthesis (QTextBlock currentBlock, int index, int numLeftParentheses);
-    bool matchLeftBrace (QTextBlock currentBlock, int index, int numRightBraces);
-    bool matchRightBrace (QTextBlock currentBlock, int index, int numLeftBraces);
+    bool matchLeftBracket (Highlighter *highlighter, QTextBlock block, int index);
+    bool matchRightBracket (Highlighter *highlighter, QTextBlock block, int index);
     void createSelection (int pos);
     void formatTextRect (QRect rect) const;
     void removeGreenSel();
@@ -202,13 +228,43 @@ private:
     void displayMessage (bool error);
     void showWarningBar (const QString& message);
     void closeWarningBar();
+    void startStreaming (TextEdit *textEdit);
+    void showMatch (TextEdit *textEdit, const FindAllMatch &match);
+    void replaceFound (TextEdit *textEdit, const QTextCursor &found, const QString &replacement);
+    void replaceAllFound (TextEdit *textEdit, const QString &text, const QVector<RegexMatch> &matches);
 
     QActionGroup *aGroup_;
     QString lastFile_; // The last opened or saved file (for file dialogs).
     QString txtReplace_; // The replacing text.
     int rightClicked_; // The index of the right-clicked tab.
+    RegexSearch *findSearch_; // Finds the next match of a regular expression without blocking the GUI.
+    RegexSearch *visibleSearch_; // Finds the visible matches of a regular expression without blocking the GUI.
+    RegexSearch *replaceSearch_; // Finds the next match of a regular expression for replace().
+    struct PendingRegexFind {
+        QPointer<TextEdit> textEdit;
+        int revision;
+        int anchor;
+        int position;
+        bool newSearch;
+        bool all; // for replaceAll()
+    };
+    PendingRegexFind pendingFind_; // The state of the text when findSearch_ was started.
+    PendingRegexFind pendingReplace_; // The state of the text when replaceSearch_ was started.
+    struct VisibleRegexMatches {
+        QPointer<TextEdit> textEdit;
+        int revision;
+        QString pattern;
+        Qt::CaseSensitivity cs;
+        int from; // The searched range of the document,
+        int to; // where the matches can start.
+        QVector<RegexMatch> matches;
+    };
+    mutable VisibleRegexMatches visibleRegex_; // The last found visible matches.
+    mutable VisibleRegexMatches pendingVisible_; // The query of visibleSearch_.
+    MultiFind *multiFind_; // Finds the matches in all open documents.
     int loadingProcesses_; // The number of loading processes (used to prevent early closing).
     QPointer<QThread> busyThread_; // Used to wait one second for making the cursor busy.
+    QHash<Loading*, QPointer<TabPage> > streamingTabs_; // Tabs, to which huge files are being loaded progressively.
     ICONMODE iconMode_; // Used only internally.
 };
 
@@ -39,7 +39,7 @@ void Highlighter::htmlBrackets (const QString &text)
         && previousBlockState() != doubleQuoteState)
     {
         braIndex = braStartExp.indexIn (text);
-        while (format (braIndex) == commentFormat)
+        while (classAt (braIndex) == commentClass)
             braIndex = braStartExp.indexIn (text, braIndex + 1);
 
     }
@@ -194,8 +194,8 @@ void Highlighter::htmlBrackets (const QString &text)
         htmlAttributeFormat.setForeground (Brown);
         QRegExp attExp = QRegExp ("[A-Za-z0-9_\\-]+(?=\\s*\\=)");
         int attIndex = attExp.indexIn (text, braIndex);
-        while (format (attIndex) == quoteFormat
-               || format (attIndex) == altQuoteFormat)
+        while (classAt (attIndex) == quoteClass
+               || classAt (attIndex) == altQuoteClass)
         {
             attIndex = attExp.indexIn (text, attIndex + 1);
         }
@@ -207,7 +207,7 @@ void Highlighter::htmlBrackets (const QString &text)
         }
 
         braIndex = braStartExp.indexIn (text, braIndex + len);
-        while (format (braIndex) == commentFormat)
+        while (classAt (braIndex) == commentClass)
             braIndex = braStartExp.indexIn (text, braIndex + 1);
     }
 }
@@ -230,7 +230,7 @@ void Highlighter::htmlStyleHighlighter (const QString &text)
         && previousBlockState() != htmlStyleDoubleQuoteState)
     {
         styleIndex = styleStartExp.indexIn (text);
-        while (format (styleIndex) == commentFormat)
+        while (classAt (styleIndex) == commentClass)
             styleIndex = styleStartExp.indexIn (text, styleIndex + 1);
     }
 
@@ -448,8 +448,8 @@ void Highlighter::htmlStyleHighlighter (const QString &text)
             htmlAttributeFormat.setForeground (Brown);
             QRegExp attExp = QRegExp ("[A-Za-z0-9_\\-]+(?=\\s*\\=)");
             int attIndex = attExp.indexIn (text, braIndex);
-            while (format (attIndex) == quoteFormat
-                   || format (attIndex) == altQuoteFormat)
+            while (classAt (attIndex) == quoteClass
+                   || classAt (attIndex) == altQuoteClass)
             {
                 attIndex = attExp.indexIn (text, attIndex + 1);
             }
@@ -629,7 +629,7 @@ void Highlighter::htmlStyleHighlighter (const QString &text)
         }
 
         styleIndex = styleStartExp.indexIn (text, styleIndex + len);
-        while (format (styleIndex) == commentFormat)
+        while (classAt (styleIndex) == commentClass)
             styleIndex = styleStartExp.indexIn (text, styleIndex + 1);
     }
 }
@@ -648,7 +648,7 @@ void Highlighter::htmlJavascript (const QString &text)
         && previousBlockState() != htmlJavaCommentState)
     {
         javaIndex = javaStartExp.indexIn (text);
-        while (format (javaIndex) == commentFormat)
+        while (classAt (javaIndex) == commentClass)
             javaIndex = javaStartExp.indexIn (text, javaIndex + 1);
     }
     while (javaIndex >= 0)
@@ -689,37 +689,45 @@ void Highlighter::htmlJavascript (const QString &text)
             setCurrentBlockState (0);
 
         int index;
+        QVector<WordPos> words;
+        bool wordsFound = false;
         foreach (const HighlightingRule &rule, highlightingRules)
         {
             /* single-line comments are already formatted */
             if (rule.format == commentFormat)
                 continue;
 
-            QRegExp expression (rule.pattern);
-            index = expression.indexIn (text, javaIndex + matched);
-            /* skip quotes and all comments */
-            while (format (index) == quoteFormat
-                   || format (index) == altQuoteFormat
-                   || format (index) == commentFormat
-                   || format (index) == urlFormat)
+            if (!rule.keywords.isEmpty())
             {
-                index = expression.indexIn (text, index + 1);
+                if (!wordsFound)
+                {
+                    findWords (text, words);
+                    wordsFound = true;
+                }
+                formatKeywords (text, rule, words, javaIndex + matched, javaIndex + len);
+                continue;
             }
 
-            while (index >= 0 && index < javaIndex + len)
+            bool skipUrls = true;
+            QRegularExpressionMatchIterator it = rule.pattern.globalMatch (text, javaIndex + matched);
+            while (it.hasNext())
             {
-                int length = expression.matchedLength();
+                const QRegularExpressionMatch match = it.next();
+                index = match.capturedStart();
+                if (index >= javaIndex + len) break;
+                /* skip quotes and all comments */
+                const char cl = classAt (index);
+                if (cl == quoteClass || cl == altQuoteClass || cl == commentClass
+                    || (skipUrls && cl == urlClass))
+                {
+                    it = rule.pattern.globalMatch (text, index + 1);
+                    continue;
+                }
+                skipUrls = false;
+                int length = match.capturedLength();
                 if (index + length > javaIndex + len)
                     length = javaIndex + len - index;
                 setFormat (index, length, rule.format);
-                index = expression.indexIn (text, index + length);
-
-                while (format (index) == quoteFormat
-                       || format (index) == altQuoteFormat
-                       || format (index) == commentFormat)
-                {
-                    index = expression.indexIn (text, index + 1);
-                }
             }
         }
 
@@ -130,9 +130,9 @@ bool Highlighter::SH_SkipQuote (const QString &text, const int pos, bool isStart
 {
     return (isEscapedQuote (text, pos, isStartQuote)
             || format (pos) == neutralFormat // not needed
-            || format (pos) == commentFormat
-            || format (pos) == quoteFormat
-            || format (pos) == altQuoteFormat);
+            || classAt (pos) == commentClass
+            || classAt (pos) == quoteClass
+            || classAt (pos) == altQuoteClass);
 }
 /*************************/
 // Should be used only with characters that can be escaped.
@@ -157,8 +157,8 @@ void Highlighter::SH_CommentsInsideCmnd (const QString &text, int start, int end
     int comment = exp.indexIn (text, start);
     while (comment != -1
            /* skip quoted comments */
-           && (format (comment) == quoteFormat
-               || format (comment) == altQuoteFormat))
+           && (classAt (comment) == quoteClass
+               || classAt (comment) == altQuoteClass))
     {
         comment = exp.indexIn (text, comment + 1);
     }
@@ -173,8 +173,8 @@ void Highlighter::SH_CommentsInsideCmnd (const QString &text, int start, int end
         }
         singleLineComment (text, comment, commentEnd, true);
         comment = commentEnd + 1;
-        while (comment != -1 && (format (comment) == quoteFormat
-                                 || format (comment) == altQuoteFormat))
+        while (comment != -1 && (classAt (comment) == quoteClass
+                                 || classAt (comment) == altQuoteClass))
         {
             comment = exp.indexIn (text, comment + 1);
         }
@@ -243,7 +243,7 @@ bool Highlighter::SH_CmndSubstVar (const QString &text,
     else if (N == 0) // a new search for code blocks
     {
         start = QRegExp ("\\$\\(").indexIn (text);
-        if (start == -1 || format (start) == commentFormat)
+        if (start == -1 || classAt (start) == commentClass)
             return (prevOpenNests != 0);
         N = 1;
         indx = start + 2;
@@ -253,7 +253,7 @@ bool Highlighter::SH_CmndSubstVar (const QString &text,
     {
         while (N > 0 && (indx = exp.indexIn (text, indx)) != -1)
         {
-            while (format (indx) == commentFormat)
+            while (classAt (indx) == commentClass)
                 ++ indx;
             if (indx == text.length())
                 break;
@@ -308,7 +308,7 @@ bool Highlighter::SH_CmndSubstVar (const QString &text,
                 return (N != prevOpenNests);
             }
             start = QRegExp ("\\$\\(").indexIn (text, indx + 1);
-            if (start == -1 || format (start) == commentFormat)
+            if (start == -1 || classAt (start) == commentClass)
                 return (prevOpenNests != 0);
             indx = start + 2;
             N = 1;
@@ -322,8 +322,8 @@ bool Highlighter::SH_CmndSubstVar (const QString &text,
            (unfortunately, a backward search should be done) */
         int lastComment = commetExp.lastIndexIn (text, indx + 1 - text.length());
         if (lastComment > 0
-            && format (lastComment) != quoteFormat
-            && format (lastComment) != altQuoteFormat
+            && classAt (lastComment) != quoteClass
+            && classAt (lastComment) != altQuoteClass
             && lastComment + commetExp.matchedLength() > indx)
         {
             indx = indx + 1;
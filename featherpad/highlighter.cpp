@@ -16,94 +16,362 @@
  */
 
 #include "highlighter.h"
+#include <QElapsedTimer>
+#include <QTimerEvent>
+#include <QtConcurrent>
+#include <cstring> // memset
+#include <algorithm> // std::sort
+#include <climits> // INT_MAX
 
 Q_DECLARE_METATYPE(QTextBlock)
 
 namespace FeatherPad {
 
-TextBlockData::~TextBlockData()
+/* The objects of TextBlockData are allocated in chunks, so that there's no allocation
+   per block. The freed slots are linked in a list and the chunks are released when all
+   objects are deleted. The first slot of a chunk links it to the previous chunk (plain
+   pointers are used because objects may be deleted after static destructors are called).
+   Block data are made and deleted only in the GUI thread. */
+static const int blockDataChunk = 1024; // the number of slots in a chunk
+static void *blockDataChunks = nullptr; // the last chunk
+static void *freeBlockData = nullptr;
+static int liveBlockData = 0;
+
+void *TextBlockData::operator new (size_t size)
 {
-    while (!allParentheses.isEmpty())
+    if (size != sizeof (TextBlockData)) // not possible but harmless
+        return ::operator new (size);
+    if (freeBlockData == nullptr)
     {
-        ParenthesisInfo *info = allParentheses.at (0);
-        allParentheses.remove (0);
-        delete info;
-    }
-    while (!allBraces.isEmpty())
-    {
-        BraceInfo *info = allBraces.at (0);
-        allBraces.remove(0);
-        delete info;
+        char *chunk = static_cast<char*>(::operator new (blockDataChunk * sizeof (TextBlockData)));
+        *reinterpret_cast<void**>(chunk) = blockDataChunks;
+        blockDataChunks = chunk;
+        for (int i = blockDataChunk - 1; i > 0; --i)
+        {
+            void *slot = chunk + i * sizeof (TextBlockData);
+            *static_cast<void**>(slot) = freeBlockData;
+            freeBlockData = slot;
+        }
     }
+    void *p = freeBlockData;
+    freeBlockData = *static_cast<void**>(p);
+    ++ liveBlockData;
+    return p;
 }
 /*************************/
-QVector<ParenthesisInfo *> TextBlockData::parentheses()
+void TextBlockData::operator delete (void *p, size_t size)
 {
-    return allParentheses;
+    if (p == nullptr) return;
+    if (size != sizeof (TextBlockData))
+    {
+        ::operator delete (p);
+        return;
+    }
+    *static_cast<void**>(p) = freeBlockData;
+    freeBlockData = p;
+    if (-- liveBlockData == 0)
+    {
+        while (blockDataChunks != nullptr)
+        {
+            void *chunk = blockDataChunks;
+            blockDataChunks = *static_cast<void**>(chunk);
+            ::operator delete (chunk);
+        }
+        freeBlockData = nullptr;
+    }
 }
 /*************************/
-QVector<BraceInfo *> TextBlockData::braces()
+QHash<QString, Highlighter::RuleSet>& Highlighter::ruleCache()
 {
-    return allBraces;
+    static QHash<QString, RuleSet> cache;
+    return cache;
 }
 /*************************/
-QString TextBlockData::delimiter()
+bool Highlighter::restoreRules (const QString &key)
 {
-    return Delimiter;
+    QHash<QString, RuleSet>::const_iterator it = ruleCache().constFind (key);
+    if (it == ruleCache().constEnd())
+        return false;
+    const RuleSet &rules = it.value();
+    highlightingRules = rules.highlightingRules;
+    /* the comment expressions are copied because pythonMLComment() may change them */
+    commentStartExpression = rules.commentStartExpression;
+    commentEndExpression = rules.commentEndExpression;
+    quoteMark = rules.quoteMark;
+    commentFormat = rules.commentFormat;
+    quoteFormat = rules.quoteFormat;
+    altQuoteFormat = rules.altQuoteFormat;
+    urlFormat = rules.urlFormat;
+    blockQuoteFormat = rules.blockQuoteFormat;
+    codeBlockFormat = rules.codeBlockFormat;
+    neutralFormat = rules.neutralFormat;
+    Blue = rules.Blue;
+    DarkBlue = rules.DarkBlue;
+    Red = rules.Red;
+    DarkRed = rules.DarkRed;
+    DarkGreen = rules.DarkGreen;
+    DarkGreenAlt = rules.DarkGreenAlt;
+    DarkMagenta = rules.DarkMagenta;
+    Violet = rules.Violet;
+    Brown = rules.Brown;
+    DarkYellow = rules.DarkYellow;
+    return true;
 }
 /*************************/
-bool TextBlockData::isHighlighted()
+void Highlighter::cacheRules (const QString &key)
 {
-    return Highlighted;
+    RuleSet rules;
+    rules.highlightingRules = highlightingRules;
+    rules.commentStartExpression = commentStartExpression;
+    rules.commentEndExpression = commentEndExpression;
+    rules.quoteMark = quoteMark;
+    rules.commentFormat = commentFormat;
+    rules.quoteFormat = quoteFormat;
+    rules.altQuoteFormat = altQuoteFormat;
+    rules.urlFormat = urlFormat;
+    rules.blockQuoteFormat = blockQuoteFormat;
+    rules.codeBlockFormat = codeBlockFormat;
+    rules.neutralFormat = neutralFormat;
+    rules.Blue = Blue;
+    rules.DarkBlue = DarkBlue;
+    rules.Red = Red;
+    rules.DarkRed = DarkRed;
+    rules.DarkGreen = DarkGreen;
+    rules.DarkGreenAlt = DarkGreenAlt;
+    rules.DarkMagenta = DarkMagenta;
+    rules.Violet = Violet;
+    rules.Brown = Brown;
+    rules.DarkYellow = DarkYellow;
+    ruleCache().insert (key, rules);
 }
 /*************************/
-int TextBlockData::openNests()
+static inline bool isWordChar (const QChar &c)
 {
-    return OpenNests;
+    return c.isLetterOrNumber() || c.isMark() || c == QLatin1Char ('_'); // as with "\\b" of QRegExp
 }
 /*************************/
-void TextBlockData::insertInfo (ParenthesisInfo *info)
+/* Splits a pattern like "\\b(word1|word2|...)(?!(x|y|...))\\b" into its plain words and
+   a pattern for its other alternatives. Returns false if the pattern doesn't have this form.
+   The command patterns of sh aren't split because they format the separators and keywords
+   before a command too. */
+static bool splitKeywordPattern (const QString &pattern, QStringList &words, QString &rest,
+                                 QString &notFollowedBy)
 {
-    int i = 0;
-    while (i < allParentheses.size()
-           && info->position > allParentheses.at (i)->position)
+    static const QString prefix ("\\b(");
+    if (!pattern.startsWith (prefix)) return false;
+
+    /* find the top-level alternatives */
+    QStringList alternatives;
+    const int n = pattern.length();
+    int depth = 0;
+    int altStart = prefix.length();
+    int i = altStart;
+    for (; i < n; ++i)
+    {
+        const QChar c = pattern.at (i);
+        if (c == QLatin1Char ('\\'))
+            ++i;
+        else if (c == QLatin1Char ('['))
+        {
+            i = pattern.indexOf (QLatin1Char (']'), i + 1);
+            if (i == -1) return false;
+        }
+        else if (c == QLatin1Char ('('))
+            ++depth;
+        else if (c == QLatin1Char (')'))
+        {
+            if (depth == 0) break;
+            --depth;
+        }
+        else if (c == QLatin1Char ('|') && depth == 0)
+        {
+            alternatives << pattern.mid (altStart, i - altStart);
+            altStart = i + 1;
+        }
+    }
+    if (i >= n) return false;
+    alternatives << pattern.mid (altStart, i - altStart);
+
+    /* the suffix should be a word boundary, maybe after negative lookaheads for single characters */
+    const QString suffix = pattern.mid (i + 1);
+    if (!suffix.endsWith ("\\b")) return false;
+    const QString la = suffix.left (suffix.length() - 2);
+    const QString metaChars (".()[]{}*+?^$|");
+    notFollowedBy.clear();
+    i = 0;
+    while (i < la.length())
     {
+        if (!la.midRef (i).startsWith ("(?!")) return false;
+        i += 3;
+        const bool grouped = i < la.length() && la.at (i) == QLatin1Char ('(');
+        if (grouped) ++i;
+        forever
+        {
+            bool escaped = false;
+            if (i < la.length() && la.at (i) == QLatin1Char ('\\'))
+            {
+                escaped = true;
+                ++i;
+            }
+            if (i >= la.length()) return false;
+            const QChar c = la.at (i++);
+            if (escaped ? c.isLetterOrNumber() : metaChars.contains (c))
+                return false; // not a single character
+            notFollowedBy += c;
+            if (grouped && i < la.length() && la.at (i) == QLatin1Char ('|'))
+            {
+                ++i;
+                continue;
+            }
+            break;
+        }
+        if (grouped)
+        {
+            if (i >= la.length() || la.at (i) != QLatin1Char (')')) return false;
+            ++i;
+        }
+        if (i >= la.length() || la.at (i) != QLatin1Char (')')) return false;
         ++i;
     }
 
-    allParentheses.insert (i, info);
+    words.clear();
+    QStringList others;
+    foreach (const QString &alt, alternatives)
+    {
+        bool plain = !alt.isEmpty();
+        for (int j = 0; plain && j < alt.length(); ++j)
+        {
+            const QChar c = alt.at (j);
+            plain = c.unicode() < 128 && (c.isLetterOrNumber() || c == QLatin1Char ('_'));
+        }
+        if (plain)
+            words << alt;
+        else
+            others << alt;
+    }
+    if (words.isEmpty()) return false;
+    rest = others.isEmpty() ? QString() : prefix + others.join (QLatin1Char ('|')) + ")" + suffix;
+    return true;
 }
 /*************************/
-void TextBlockData::insertInfo (BraceInfo *info)
+// Replaces simple keyword patterns with keyword hashes, merging successive ones.
+void Highlighter::makeKeywordRules()
 {
-    int i = 0;
-    while (i < allBraces.size()
-           && info->position > allBraces.at (i)->position)
+    QVector<HighlightingRule> rules;
+    foreach (const HighlightingRule &rule, highlightingRules)
     {
-        ++i;
+        QStringList words;
+        QString rest;
+        HighlightingRule kRule;
+        if (rule.format == commentFormat
+            || !splitKeywordPattern (rule.pattern.pattern(), words, rest,
+                                     kRule.notFollowedBy))
+        {
+            rules.append (rule);
+            continue;
+        }
+        kRule.format = rule.format;
+        kRule.keywords = words.toSet();
+        if (!rules.isEmpty())
+        {
+            HighlightingRule &last = rules.last();
+            if (!last.keywords.isEmpty() && last.format == kRule.format
+                && last.notFollowedBy == kRule.notFollowedBy)
+            {
+                last.keywords.unite (kRule.keywords);
+            }
+            else
+                rules.append (kRule);
+        }
+        else
+            rules.append (kRule);
+        if (!rest.isEmpty())
+        {
+            HighlightingRule rRule;
+            rRule.pattern = QRegularExpression (rest);
+            rRule.format = rule.format;
+            rules.append (rRule);
+        }
     }
-
-    allBraces.insert (i, info);
+    highlightingRules = rules;
 }
 /*************************/
-void TextBlockData::insertInfo (QString str)
+// Compiles the patterns of the rules once (with JIT if available). Like QRegExp, "\b",
+// "\w" and "\s" should cover non-ASCII characters too. The compiled patterns are
+// shared with the copies of the rules and so, with the next highlighters.
+void Highlighter::compileRules()
 {
-    Delimiter = str;
+    for (int i = 0; i < highlightingRules.size(); ++i)
+    {
+        HighlightingRule &rule = highlightingRules[i];
+        if (!rule.keywords.isEmpty()) continue;
+        rule.pattern.setPatternOptions (QRegularExpression::UseUnicodePropertiesOption);
+        rule.pattern.optimize();
+    }
 }
 /*************************/
-void TextBlockData::insertHighlightInfo (bool highlighted)
+void Highlighter::findWords (const QString &text, QVector<WordPos> &words)
 {
-    Highlighted = highlighted;
+    words.clear();
+    const int n = text.length();
+    int i = 0;
+    while (i < n)
+    {
+        while (i < n && !isWordChar (text.at (i)))
+            ++i;
+        if (i == n) break;
+        WordPos w;
+        w.start = i;
+        while (i < n && isWordChar (text.at (i)))
+            ++i;
+        w.length = i - w.start;
+        words.append (w);
+    }
 }
 /*************************/
-void TextBlockData::insertNestInfo (int nests)
+void Highlighter::formatKeywords (const QString &text, const HighlightingRule &rule,
+                                  const QVector<WordPos> &words, int start, int end)
 {
-    OpenNests = nests;
+    foreach (const WordPos &w, words)
+    {
+        if (w.start < start) continue;
+        if (w.start >= end) break;
+        /* no allocation for the lookup */
+        if (!rule.keywords.contains (QString::fromRawData (text.constData() + w.start, w.length)))
+            continue;
+        const int after = w.start + w.length;
+        if (after < text.length() && rule.notFollowedBy.contains (text.at (after)))
+            continue;
+        /* skip quotes and all comments */
+        if (classAt (w.start) == quoteClass
+            || classAt (w.start) == altQuoteClass
+            || classAt (w.start) == commentClass
+            || classAt (w.start) == urlClass)
+        {
+            continue;
+        }
+        setFormat (w.start, qMin (w.length, end - w.start), rule.format);
+    }
 }
 /*************************/
 // Here, the order of formatting is important because of overrides.
-Highlighter::Highlighter (QTextDocument *parent, QString lang, QTextCursor start, QTextCursor end, bool darkColorScheme) : QSyntaxHighlighter (parent)
+Highlighter::Highlighter (QTextDocument *parent, QString lang, QTextCursor start, QTextCursor end, bool darkColorScheme,
+                          bool lazy) :
+    QSyntaxHighlighter (parent),
+    bracketIndex_ (parent),
+    catchUpTimerId_ (0),
+    catchingUp_ (false),
+    catchUpBlock_ (-1),
+    lazy_ (lazy),
+    waitingForLexer_ (false),
+    profile_ (qEnvironmentVariableIsSet ("FEATHERPAD_PROFILE_HIGHLIGHTER")
+              ? new QHash<QString, ProfileEntry> : nullptr)
 {
+    /* the data of an old highlighter (maybe of another language) shouldn't be reused,
+       neither by highlightBlock() nor by the bracket index, which is built from it */
+    for (QTextBlock block = parent->begin(); block.isValid(); block = block.next())
+        block.setUserData (nullptr);
+
     if (lang.isEmpty()) return;
 
     /* for highlighting next block inside highlightBlock() when needed */
@@ -113,6 +381,17 @@ Highlighter::Highlighter (QTextDocument *parent, QString lang, QTextCursor start
     endCursor = end;
     progLan = lang;
 
+    /* blocks may be inserted or removed by any change */
+    connect (parent, &QTextDocument::contentsChange, this, [this] (int pos, int removed, int added) {
+        bracketIndex_.contentsChange (pos, removed, added);
+    });
+    connect (&lexWatcher_, &QFutureWatcherBase::finished, this, &Highlighter::onLexed);
+
+    /* the rules are made once for each language and color scheme */
+    const QString cacheKey = darkColorScheme ? lang + "/dark" : lang;
+    if (restoreRules (cacheKey))
+        return;
+
     quoteMark = QRegExp ("\""); // the standard quote mark
 
     HighlightingRule rule;
@@ -167,14 +446,14 @@ Highlighter::Highlighter (QTextDocument *parent, QString lang, QTextCursor start
         functionFormat.setFontItalic (true);
         functionFormat.setForeground (Blue);
         /* before parentheses... */
-        rule.pattern = QRegExp ("\\b[A-Za-z0-9_]+(?=\\s*\\()");
+        rule.pattern = QRegularExpression ("\\b[A-Za-z0-9_]+(?=\\s*\\()");
         rule.format = functionFormat;
         highlightingRules.append (rule);
         /* ... but make exception for what comes after "#define" */
         if (progLan == "c" || progLan == "cpp")
         {
-            rule.pattern = QRegExp ("^\\s*#\\s*define\\s+[^\"\']" // may contain slash but no quote
-                                    "+(?=\\s*\\()");
+            rule.pattern = QRegularExpression ("^\\s*#\\s*define\\s+[^\"\']" // may contain slash but no quote
+                                               "+(?=\\s*\\()");
             rule.format = neutralFormat;
             highlightingRules.append (rule);
         }
@@ -182,7 +461,7 @@ Highlighter::Highlighter (QTextDocument *parent, QString lang, QTextCursor start
         { // built-in functions
             functionFormat.setFontWeight (QFont::Bold);
             functionFormat.setForeground (Qt::magenta);
-            rule.pattern = QRegExp ("\\b(abs|add|all|append|any|as_integer_ratio|ascii|basestring|bin|bit_length|bool|bytearray|bytes|callable|c\\.conjugate|capitalize|center|chr|classmethod|clear|cmp|compile|complex|count|critical|debug|decode|delattr|dict|difference_update|dir|discard|divmod|encode|endswith|enumerate|error|eval|expandtabs|exception|exec|execfile|extend|file|filter|find|float|format|fromhex|fromkeys|frozenset|get|getattr|globals|hasattr|hash|has_key|help|hex|id|index|info|input|insert|int|intersection_update|isalnum|isalpha|isdecimal|isdigit|isinstance|islower|isnumeric|isspace|issubclass|istitle|items|iter|iteritems|iterkeys|itervalues|isupper|is_integer|join|keys|len|list|ljust|locals|log|long|lower|lstrip|map|max|memoryview|min|next|object|oct|open|ord|partition|pop|popitem|pow|print|property|range|raw_input|read|reduce|reload|remove|replace|repr|reverse|reversed|rfind|rindex|rjust|rpartition|round|rsplit|rstrip|run|seek|set|setattr|slice|sort|sorted|split|splitlines|staticmethod|startswith|str|strip|sum|super|symmetric_difference_update|swapcase|title|translate|tuple|type|unichr|unicode|update|upper|values|vars|viewitems|viewkeys|viewvalues|warning|write|xrange|zip|zfill|(__(abs|add|and|cmp|coerce|complex|contains|delattr|delete|delitem|delslice|div|divmod|enter|eq|exit|float|floordiv|ge|get|getattr|getattribute|getitem|getslice|gt|hex|iadd|iand|idiv|ifloordiv|ilshift|invert|imod|import|imul|init|instancecheck|index|int|ior|ipow|irshift|isub|iter|itruediv|ixor|le|len|long|lshift|lt|missing|mod|mul|neg|nonzero|oct|or|pos|pow|radd|rand|rdiv|rdivmod|reversed|rfloordiv|rlshift|rmod|rmul|ror|rpow|rshift|rsub|rrshift|rtruediv|rxor|set|setattr|setitem|setslice|sub|subclasses|subclasscheck|truediv|unicode|xor)__))(?=\\s*\\()");
+            rule.pattern = QRegularExpression ("\\b(abs|add|all|append|any|as_integer_ratio|ascii|basestring|bin|bit_length|bool|bytearray|bytes|callable|c\\.conjugate|capitalize|center|chr|classmethod|clear|cmp|compile|complex|count|critical|debug|decode|delattr|dict|difference_update|dir|discard|divmod|encode|endswith|enumerate|error|eval|expandtabs|exception|exec|execfile|extend|file|filter|find|float|format|fromhex|fromkeys|frozenset|get|getattr|globals|hasattr|hash|has_key|help|hex|id|index|info|input|insert|int|intersection_update|isalnum|isalpha|isdecimal|isdigit|isinstance|islower|isnumeric|isspace|issubclass|istitle|items|iter|iteritems|iterkeys|itervalues|isupper|is_integer|join|keys|len|list|ljust|locals|log|long|lower|lstrip|map|max|memoryview|min|next|object|oct|open|ord|partition|pop|popitem|pow|print|property|range|raw_input|read|reduce|reload|remove|replace|repr|reverse|reversed|rfind|rindex|rjust|rpartition|round|rsplit|rstrip|run|seek|set|setattr|slice|sort|sorted|split|splitlines|staticmethod|startswith|str|strip|sum|super|symmetric_difference_update|swapcase|title|translate|tuple|type|unichr|unicode|update|upper|values|vars|viewitems|viewkeys|viewvalues|warning|write|xrange|zip|zfill|(__(abs|add|and|cmp|coerce|complex|contains|delattr|delete|delitem|delslice|div|divmod|enter|eq|exit|float|floordiv|ge|get|getattr|getattribute|getitem|getslice|gt|hex|iadd|iand|idiv|ifloordiv|ilshift|invert|imod|import|imul|init|instancecheck|index|int|ior|ipow|irshift|isub|iter|itruediv|ixor|le|len|long|lshift|lt|missing|mod|mul|neg|nonzero|oct|or|pos|pow|radd|rand|rdiv|rdivmod|reversed|rfloordiv|rlshift|rmod|rmul|ror|rpow|rshift|rsub|rrshift|rtruediv|rxor|set|setattr|setitem|setslice|sub|subclasses|subclasscheck|truediv|unicode|xor)__))(?=\\s*\\()");
             rule.format = functionFormat;
             highlightingRules.append (rule);
         }
@@ -200,30 +479,30 @@ Highlighter::Highlighter (QTextDocument *parent, QString lang, QTextCursor start
         if (progLan == "cmake")
         {
             keywordFormat.setForeground (Brown);
-            rule.pattern = QRegExp ("\\$\\{\\s*[A-Za-z0-9_.+/\\?#\\-:]*\\s*\\}");
+            rule.pattern = QRegularExpression ("\\$\\{\\s*[A-Za-z0-9_.+/\\?#\\-:]*\\s*\\}");
             rule.format = keywordFormat;
             highlightingRules.append (rule);
 
             keywordFormat.setForeground (DarkBlue);
-            rule.pattern = QRegExp ("((^\\s*|[\\(\\);&`\\|]+\\s*)((if|then|elif|else|fi|while|do|done|esac)\\s+)*)(CMAKE_ARGC|CMAKE_ARGV0|CMAKE_AR|CMAKE_BINARY_DIR|CMAKE_BUILD_TOOL|CMAKE_CACHEFILE_DIR|CMAKE_CACHE_MAJOR_VERSION|CMAKE_CACHE_MINOR_VERSION|CMAKE_CACHE_PATCH_VERSION|CMAKE_CFG_INTDIR|CMAKE_COMMAND|CMAKE_CROSSCOMPILING|CMAKE_CTEST_COMMAND|CMAKE_CURRENT_BINARY_DIR|CMAKE_CURRENT_LIST_DIR|CMAKE_CURRENT_LIST_FILE|CMAKE_CURRENT_LIST_LINE|CMAKE_CURRENT_SOURCE_DIR|CMAKE_DL_LIBS|CMAKE_EDIT_COMMAND|CMAKE_EXECUTABLE_SUFFIX|CMAKE_EXTRA_GENERATOR|CMAKE_EXTRA_SHARED_LIBRARY_SUFFIXES|CMAKE_GENERATOR|CMAKE_GENERATOR_TOOLSET|CMAKE_HOME_DIRECTORY|CMAKE_IMPORT_LIBRARY_PREFIX|CMAKE_IMPORT_LIBRARY_SUFFIX|CMAKE_JOB_POOL_COMPILE|CMAKE_JOB_POOL_LINK|CMAKE_LINK_LIBRARY_SUFFIX|CMAKE_MAJOR_VERSION|CMAKE_MAKE_PROGRAM|CMAKE_MINIMUM_REQUIRED_VERSION|CMAKE_MINOR_VERSION|CMAKE_PARENT_LIST_FILE|CMAKE_PATCH_VERSION|CMAKE_PROJECT_NAME|CMAKE_RANLIB|CMAKE_ROOT|CMAKE_SCRIPT_MODE_FILE|CMAKE_SHARED_LIBRARY_PREFIX|CMAKE_SHARED_LIBRARY_SUFFIX|CMAKE_SHARED_MODULE_PREFIX|CMAKE_SHARED_MODULE_SUFFIX|CMAKE_SIZEOF_VOID_P|CMAKE_SKIP_INSTALL_RULES|CMAKE_SKIP_RPATH|CMAKE_SOURCE_DIR|CMAKE_STANDARD_LIBRARIES|CMAKE_STATIC_LIBRARY_PREFIX|CMAKE_STATIC_LIBRARY_SUFFIX|CMAKE_TOOLCHAIN_FILE|CMAKE_TWEAK_VERSION|CMAKE_VERBOSE_MAKEFILE|CMAKE_VERSION|CMAKE_VS_DEVENV_COMMAND|CMAKE_VS_INTEL_Fortran_PROJECT_VERSION|CMAKE_VS_MSBUILD_COMMAND|CMAKE_VS_MSDEV_COMMAND|CMAKE_VS_PLATFORM_TOOLSETCMAKE_XCODE_PLATFORM_TOOLSET|PROJECT_BINARY_DIR|PROJECT_NAME|PROJECT_SOURCE_DIR|PROJECT_VERSION|PROJECT_VERSION_MAJOR|PROJECT_VERSION_MINOR|PROJECT_VERSION_PATCH|PROJECT_VERSION_TWEAK|BUILD_SHARED_LIBS|CMAKE_ABSOLUTE_DESTINATION_FILES|CMAKE_APPBUNDLE_PATH|CMAKE_AUTOMOC_RELAXED_MODE|CMAKE_BACKWARDS_COMPATIBILITY|CMAKE_BUILD_TYPE|CMAKE_COLOR_MAKEFILE|CMAKE_CONFIGURATION_TYPES|CMAKE_DEBUG_TARGET_PROPERTIES|CMAKE_ERROR_DEPRECATED|CMAKE_ERROR_ON_ABSOLUTE_INSTALL_DESTINATION|CMAKE_SYSROOT|CMAKE_FIND_LIBRARY_PREFIXES|CMAKE_FIND_LIBRARY_SUFFIXES|CMAKE_FIND_NO_INSTALL_PREFIX|CMAKE_FIND_PACKAGE_WARN_NO_MODULE|CMAKE_FIND_ROOT_PATH|CMAKE_FIND_ROOT_PATH_MODE_INCLUDE|CMAKE_FIND_ROOT_PATH_MODE_LIBRARY|CMAKE_FIND_ROOT_PATH_MODE_PACKAGE|CMAKE_FIND_ROOT_PATH_MODE_PROGRAM|CMAKE_FRAMEWORK_PATH|CMAKE_IGNORE_PATH|CMAKE_INCLUDE_PATH|CMAKE_INCLUDE_DIRECTORIES_BEFORE|CMAKE_INCLUDE_DIRECTORIES_PROJECT_BEFORE|CMAKE_INSTALL_DEFAULT_COMPONENT_NAME|CMAKE_INSTALL_PREFIX|CMAKE_LIBRARY_PATH|CMAKE_MFC_FLAG|CMAKE_MODULE_PATH|CMAKE_NOT_USING_CONFIG_FLAGS|CMAKE_PREFIX_PATH|CMAKE_PROGRAM_PATH|CMAKE_SKIP_INSTALL_ALL_DEPENDENCY|CMAKE_STAGING_PREFIX|CMAKE_SYSTEM_IGNORE_PATH|CMAKE_SYSTEM_INCLUDE_PATH|CMAKE_SYSTEM_LIBRARY_PATH|CMAKE_SYSTEM_PREFIX_PATH|CMAKE_SYSTEM_PROGRAM_PATH|CMAKE_USER_MAKE_RULES_OVERRIDE|CMAKE_WARN_DEPRECATED|CMAKE_WARN_ON_ABSOLUTE_INSTALL_DESTINATION|APPLE|BORLAND|CMAKE_CL_64|CMAKE_COMPILER_2005|CMAKE_HOST_APPLE|CMAKE_HOST_SYSTEM_NAME|CMAKE_HOST_SYSTEM_PROCESSOR|CMAKE_HOST_SYSTEM|CMAKE_HOST_SYSTEM_VERSION|CMAKE_HOST_UNIX|CMAKE_HOST_WIN32|CMAKE_LIBRARY_ARCHITECTURE_REGEX|CMAKE_LIBRARY_ARCHITECTURE|CMAKE_OBJECT_PATH_MAX|CMAKE_SYSTEM_NAME|CMAKE_SYSTEM_PROCESSOR|CMAKE_SYSTEM|CMAKE_SYSTEM_VERSION|CYGWIN|ENV|MSVC10|MSVC11|MSVC12|MSVC60|MSVC70|MSVC71|MSVC80|MSVC90|MSVC_IDE|MSVC|MSVC_VERSION|UNIX|WIN32|XCODE_VERSION|CMAKE_ARCHIVE_OUTPUT_DIRECTORY|CMAKE_AUTOMOC_MOC_OPTIONS|CMAKE_AUTOMOC|CMAKE_AUTORCC|CMAKE_AUTORCC_OPTIONS|CMAKE_AUTOUIC|CMAKE_AUTOUIC_OPTIONS|CMAKE_BUILD_WITH_INSTALL_RPATH|CMAKE_DEBUG_POSTFIX|CMAKE_EXE_LINKER_FLAGS|CMAKE_Fortran_FORMAT|CMAKE_Fortran_MODULE_DIRECTORY|CMAKE_GNUtoMS|CMAKE_INCLUDE_CURRENT_DIR_IN_INTERFACE|CMAKE_INCLUDE_CURRENT_DIR|CMAKE_INSTALL_NAME_DIR|CMAKE_INSTALL_RPATH|CMAKE_INSTALL_RPATH_USE_LINK_PATH|CMAKE_LIBRARY_OUTPUT_DIRECTORY|CMAKE_LIBRARY_PATH_FLAG|CMAKE_LINK_DEF_FILE_FLAG|CMAKE_LINK_DEPENDS_NO_SHARED|CMAKE_LINK_INTERFACE_LIBRARIES|CMAKE_LINK_LIBRARY_FILE_FLAG|CMAKE_LINK_LIBRARY_FLAG|CMAKE_MACOSX_BUNDLE|CMAKE_MACOSX_RPATH|CMAKE_MODULE_LINKER_FLAGS|CMAKE_NO_BUILTIN_CHRPATH|CMAKE_NO_SYSTEM_FROM_IMPORTED|CMAKE_OSX_ARCHITECTURES|CMAKE_OSX_DEPLOYMENT_TARGET|CMAKE_OSX_SYSROOT|CMAKE_PDB_OUTPUT_DIRECTORY|CMAKE_POSITION_INDEPENDENT_CODE|CMAKE_RUNTIME_OUTPUT_DIRECTORY|CMAKE_SHARED_LINKER_FLAGS|CMAKE_SKIP_BUILD_RPATH|CMAKE_SKIP_INSTALL_RPATH|CMAKE_STATIC_LINKER_FLAGS|CMAKE_TRY_COMPILE_CONFIGURATION|CMAKE_USE_RELATIVE_PATHS|CMAKE_VISIBILITY_INLINES_HIDDEN|CMAKE_WIN32_EXECUTABLE|EXECUTABLE_OUTPUT_PATH|LIBRARY_OUTPUT_PATH|CMAKE_Fortran_MODDIR_DEFAULT|CMAKE_Fortran_MODDIR_FLAG|CMAKE_Fortran_MODOUT_FLAG|CMAKE_INTERNAL_PLATFORM_ABI)(?!(\\.|-|@|#|\\$))\\b");
+            rule.pattern = QRegularExpression ("((^\\s*|[\\(\\);&`\\|]+\\s*)((if|then|elif|else|fi|while|do|done|esac)\\s+)*)(CMAKE_ARGC|CMAKE_ARGV0|CMAKE_AR|CMAKE_BINARY_DIR|CMAKE_BUILD_TOOL|CMAKE_CACHEFILE_DIR|CMAKE_CACHE_MAJOR_VERSION|CMAKE_CACHE_MINOR_VERSION|CMAKE_CACHE_PATCH_VERSION|CMAKE_CFG_INTDIR|CMAKE_COMMAND|CMAKE_CROSSCOMPILING|CMAKE_CTEST_COMMAND|CMAKE_CURRENT_BINARY_DIR|CMAKE_CURRENT_LIST_DIR|CMAKE_CURRENT_LIST_FILE|CMAKE_CURRENT_LIST_LINE|CMAKE_CURRENT_SOURCE_DIR|CMAKE_DL_LIBS|CMAKE_EDIT_COMMAND|CMAKE_EXECUTABLE_SUFFIX|CMAKE_EXTRA_GENERATOR|CMAKE_EXTRA_SHARED_LIBRARY_SUFFIXES|CMAKE_GENERATOR|CMAKE_GENERATOR_TOOLSET|CMAKE_HOME_DIRECTORY|CMAKE_IMPORT_LIBRARY_PREFIX|CMAKE_IMPORT_LIBRARY_SUFFIX|CMAKE_JOB_POOL_COMPILE|CMAKE_JOB_POOL_LINK|CMAKE_LINK_LIBRARY_SUFFIX|CMAKE_MAJOR_VERSION|CMAKE_MAKE_PROGRAM|CMAKE_MINIMUM_REQUIRED_VERSION|CMAKE_MINOR_VERSION|CMAKE_PARENT_LIST_FILE|CMAKE_PATCH_VERSION|CMAKE_PROJECT_NAME|CMAKE_RANLIB|CMAKE_ROOT|CMAKE_SCRIPT_MODE_FILE|CMAKE_SHARED_LIBRARY_PREFIX|CMAKE_SHARED_LIBRARY_SUFFIX|CMAKE_SHARED_MODULE_PREFIX|CMAKE_SHARED_MODULE_SUFFIX|CMAKE_SIZEOF_VOID_P|CMAKE_SKIP_INSTALL_RULES|CMAKE_SKIP_RPATH|CMAKE_SOURCE_DIR|CMAKE_STANDARD_LIBRARIES|CMAKE_STATIC_LIBRARY_PREFIX|CMAKE_STATIC_LIBRARY_SUFFIX|CMAKE_TOOLCHAIN_FILE|CMAKE_TWEAK_VERSION|CMAKE_VERBOSE_MAKEFILE|CMAKE_VERSION|CMAKE_VS_DEVENV_COMMAND|CMAKE_VS_INTEL_Fortran_PROJECT_VERSION|CMAKE_VS_MSBUILD_COMMAND|CMAKE_VS_MSDEV_COMMAND|CMAKE_VS_PLATFORM_TOOLSETCMAKE_XCODE_PLATFORM_TOOLSET|PROJECT_BINARY_DIR|PROJECT_NAME|PROJECT_SOURCE_DIR|PROJECT_VERSION|PROJECT_VERSION_MAJOR|PROJECT_VERSION_MINOR|PROJECT_VERSION_PATCH|PROJECT_VERSION_TWEAK|BUILD_SHARED_LIBS|CMAKE_ABSOLUTE_DESTINATION_FILES|CMAKE_APPBUNDLE_PATH|CMAKE_AUTOMOC_RELAXED_MODE|CMAKE_BACKWARDS_COMPATIBILITY|CMAKE_BUILD_TYPE|CMAKE_COLOR_MAKEFILE|CMAKE_CONFIGURATION_TYPES|CMAKE_DEBUG_TARGET_PROPERTIES|CMAKE_ERROR_DEPRECATED|CMAKE_ERROR_ON_ABSOLUTE_INSTALL_DESTINATION|CMAKE_SYSROOT|CMAKE_FIND_LIBRARY_PREFIXES|CMAKE_FIND_LIBRARY_SUFFIXES|CMAKE_FIND_NO_INSTALL_PREFIX|CMAKE_FIND_PACKAGE_WARN_NO_MODULE|CMAKE_FIND_ROOT_PATH|CMAKE_FIND_ROOT_PATH_MODE_INCLUDE|CMAKE_FIND_ROOT_PATH_MODE_LIBRARY|CMAKE_FIND_ROOT_PATH_MODE_PACKAGE|CMAKE_FIND_ROOT_PATH_MODE_PROGRAM|CMAKE_FRAMEWORK_PATH|CMAKE_IGNORE_PATH|CMAKE_INCLUDE_PATH|CMAKE_INCLUDE_DIRECTORIES_BEFORE|CMAKE_INCLUDE_DIRECTORIES_PROJECT_BEFORE|CMAKE_INSTALL_DEFAULT_COMPONENT_NAME|CMAKE_INSTALL_PREFIX|CMAKE_LIBRARY_PATH|CMAKE_MFC_FLAG|CMAKE_MODULE_PATH|CMAKE_NOT_USING_CONFIG_FLAGS|CMAKE_PREFIX_PATH|CMAKE_PROGRAM_PATH|CMAKE_SKIP_INSTALL_ALL_DEPENDENCY|CMAKE_STAGING_PREFIX|CMAKE_SYSTEM_IGNORE_PATH|CMAKE_SYSTEM_INCLUDE_PATH|CMAKE_SYSTEM_LIBRARY_PATH|CMAKE_SYSTEM_PREFIX_PATH|CMAKE_SYSTEM_PROGRAM_PATH|CMAKE_USER_MAKE_RULES_OVERRIDE|CMAKE_WARN_DEPRECATED|CMAKE_WARN_ON_ABSOLUTE_INSTALL_DESTINATION|APPLE|BORLAND|CMAKE_CL_64|CMAKE_COMPILER_2005|CMAKE_HOST_APPLE|CMAKE_HOST_SYSTEM_NAME|CMAKE_HOST_SYSTEM_PROCESSOR|CMAKE_HOST_SYSTEM|CMAKE_HOST_SYSTEM_VERSION|CMAKE_HOST_UNIX|CMAKE_HOST_WIN32|CMAKE_LIBRARY_ARCHITECTURE_REGEX|CMAKE_LIBRARY_ARCHITECTURE|CMAKE_OBJECT_PATH_MAX|CMAKE_SYSTEM_NAME|CMAKE_SYSTEM_PROCESSOR|CMAKE_SYSTEM|CMAKE_SYSTEM_VERSION|CYGWIN|ENV|MSVC10|MSVC11|MSVC12|MSVC60|MSVC70|MSVC71|MSVC80|MSVC90|MSVC_IDE|MSVC|MSVC_VERSION|UNIX|WIN32|XCODE_VERSION|CMAKE_ARCHIVE_OUTPUT_DIRECTORY|CMAKE_AUTOMOC_MOC_OPTIONS|CMAKE_AUTOMOC|CMAKE_AUTORCC|CMAKE_AUTORCC_OPTIONS|CMAKE_AUTOUIC|CMAKE_AUTOUIC_OPTIONS|CMAKE_BUILD_WITH_INSTALL_RPATH|CMAKE_DEBUG_POSTFIX|CMAKE_EXE_LINKER_FLAGS|CMAKE_Fortran_FORMAT|CMAKE_Fortran_MODULE_DIRECTORY|CMAKE_GNUtoMS|CMAKE_INCLUDE_CURRENT_DIR_IN_INTERFACE|CMAKE_INCLUDE_CURRENT_DIR|CMAKE_INSTALL_NAME_DIR|CMAKE_INSTALL_RPATH|CMAKE_INSTALL_RPATH_USE_LINK_PATH|CMAKE_LIBRARY_OUTPUT_DIRECTORY|CMAKE_LIBRARY_PATH_FLAG|CMAKE_LINK_DEF_FILE_FLAG|CMAKE_LINK_DEPENDS_NO_SHARED|CMAKE_LINK_INTERFACE_LIBRARIES|CMAKE_LINK_LIBRARY_FILE_FLAG|CMAKE_LINK_LIBRARY_FLAG|CMAKE_MACOSX_BUNDLE|CMAKE_MACOSX_RPATH|CMAKE_MODULE_LINKER_FLAGS|CMAKE_NO_BUILTIN_CHRPATH|CMAKE_NO_SYSTEM_FROM_IMPORTED|CMAKE_OSX_ARCHITECTURES|CMAKE_OSX_DEPLOYMENT_TARGET|CMAKE_OSX_SYSROOT|CMAKE_PDB_OUTPUT_DIRECTORY|CMAKE_POSITION_INDEPENDENT_CODE|CMAKE_RUNTIME_OUTPUT_DIRECTORY|CMAKE_SHARED_LINKER_FLAGS|CMAKE_SKIP_BUILD_RPATH|CMAKE_SKIP_INSTALL_RPATH|CMAKE_STATIC_LINKER_FLAGS|CMAKE_TRY_COMPILE_CONFIGURATION|CMAKE_USE_RELATIVE_PATHS|CMAKE_VISIBILITY_INLINES_HIDDEN|CMAKE_WIN32_EXECUTABLE|EXECUTABLE_OUTPUT_PATH|LIBRARY_OUTPUT_PATH|CMAKE_Fortran_MODDIR_DEFAULT|CMAKE_Fortran_MODDIR_FLAG|CMAKE_Fortran_MODOUT_FLAG|CMAKE_INTERNAL_PLATFORM_ABI)(?!(\\.|-|@|#|\\$))\\b");
             rule.format = keywordFormat;
             highlightingRules.append (rule);
 
-            rule.pattern = QRegExp ("((^\\s*|[\\(\\);&`\\|]+\\s*)((if|then|elif|else|fi|while|do|done|esac)\\s+)*)[A-Za-z0-9_]+(_BINARY_DIR|_SOURCE_DIR|_VERSION|_VERSION_MAJOR|_VERSION_MINOR|_VERSION_PATCH|_VERSION_TWEAK)(?!(\\.|-|@|#|\\$))\\b");
+            rule.pattern = QRegularExpression ("((^\\s*|[\\(\\);&`\\|]+\\s*)((if|then|elif|else|fi|while|do|done|esac)\\s+)*)[A-Za-z0-9_]+(_BINARY_DIR|_SOURCE_DIR|_VERSION|_VERSION_MAJOR|_VERSION_MINOR|_VERSION_PATCH|_VERSION_TWEAK)(?!(\\.|-|@|#|\\$))\\b");
             highlightingRules.append (rule);
 
-            rule.pattern = QRegExp ("((^\\s*|[\\(\\);&`\\|]+\\s*)((if|then|elif|else|fi|while|do|done|esac)\\s+)*)(CMAKE_DISABLE_FIND_PACKAGE_|CMAKE_EXE_LINKER_FLAGS_|CMAKE_MAP_IMPORTED_CONFIG_|CMAKE_MODULE_LINKER_FLAGS_|CMAKE_PDB_OUTPUT_DIRECTORY_|CMAKE_SHARED_LINKER_FLAGS_|CMAKE_STATIC_LINKER_FLAGS_|CMAKE_COMPILER_IS_GNU)[A-Za-z0-9_]+(?!(\\.|-|@|#|\\$))\\b");
+            rule.pattern = QRegularExpression ("((^\\s*|[\\(\\);&`\\|]+\\s*)((if|then|elif|else|fi|while|do|done|esac)\\s+)*)(CMAKE_DISABLE_FIND_PACKAGE_|CMAKE_EXE_LINKER_FLAGS_|CMAKE_MAP_IMPORTED_CONFIG_|CMAKE_MODULE_LINKER_FLAGS_|CMAKE_PDB_OUTPUT_DIRECTORY_|CMAKE_SHARED_LINKER_FLAGS_|CMAKE_STATIC_LINKER_FLAGS_|CMAKE_COMPILER_IS_GNU)[A-Za-z0-9_]+(?!(\\.|-|@|#|\\$))\\b");
             highlightingRules.append (rule);
 
-            rule.pattern = QRegExp ("((^\\s*|[\\(\\);&`\\|]+\\s*)((if|then|elif|else|fi|while|do|done|esac)\\s+)*)(CMAKE_)[A-Za-z0-9_]+(_POSTFIX|_VISIBILITY_PRESET|_ARCHIVE_APPEND|_ARCHIVE_CREATE|_ARCHIVE_FINISH|_COMPILE_OBJECT|_COMPILER_ABI|_COMPILER_ID|_COMPILER_LOADED|_COMPILER|_COMPILER_EXTERNAL_TOOLCHAIN|_COMPILER_TARGET|_COMPILER_VERSION|_CREATE_SHARED_LIBRARY|_CREATE_SHARED_MODULE|_CREATE_STATIC_LIBRARY|_FLAGS_DEBUG|_FLAGS_MINSIZEREL|_FLAGS_RELEASE|_FLAGS_RELWITHDEBINFO|_FLAGS|_IGNORE_EXTENSIONS|_IMPLICIT_INCLUDE_DIRECTORIES|_IMPLICIT_LINK_DIRECTORIES|_IMPLICIT_LINK_FRAMEWOR)(?!(\\.|-|@|#|\\$))\\b");
+            rule.pattern = QRegularExpression ("((^\\s*|[\\(\\);&`\\|]+\\s*)((if|then|elif|else|fi|while|do|done|esac)\\s+)*)(CMAKE_)[A-Za-z0-9_]+(_POSTFIX|_VISIBILITY_PRESET|_ARCHIVE_APPEND|_ARCHIVE_CREATE|_ARCHIVE_FINISH|_COMPILE_OBJECT|_COMPILER_ABI|_COMPILER_ID|_COMPILER_LOADED|_COMPILER|_COMPILER_EXTERNAL_TOOLCHAIN|_COMPILER_TARGET|_COMPILER_VERSION|_CREATE_SHARED_LIBRARY|_CREATE_SHARED_MODULE|_CREATE_STATIC_LIBRARY|_FLAGS_DEBUG|_FLAGS_MINSIZEREL|_FLAGS_RELEASE|_FLAGS_RELWITHDEBINFO|_FLAGS|_IGNORE_EXTENSIONS|_IMPLICIT_INCLUDE_DIRECTORIES|_IMPLICIT_LINK_DIRECTORIES|_IMPLICIT_LINK_FRAMEWOR)(?!(\\.|-|@|#|\\$))\\b");
             highlightingRules.append (rule);
 
-            rule.pattern = QRegExp ("((^\\s*|[\\(\\);&`\\|]+\\s*)((if|then|elif|else|fi|while|do|done|esac)\\s+)*)(CMAKE_PROJECT_)[A-Za-z0-9_]+(_INCLUDE)(?!(\\.|-|@|#|\\$))\\b");
+            rule.pattern = QRegularExpression ("((^\\s*|[\\(\\);&`\\|]+\\s*)((if|then|elif|else|fi|while|do|done|esac)\\s+)*)(CMAKE_PROJECT_)[A-Za-z0-9_]+(_INCLUDE)(?!(\\.|-|@|#|\\$))\\b");
             highlightingRules.append (rule);
         }
         keywordFormat.setFontWeight (QFont::Bold);
         keywordFormat.setForeground (Qt::magenta);
-        rule.pattern = QRegExp ("((^\\s*|[\\(\\);&`\\|]+\\s*)((if|then|elif|else|fi|while|do|done|esac)\\s+)*)(adduser|addgroup|apropos|apt-get|aspell|awk|basename|bash|bc|bzip2|cal|cat|cd|cfdisk|chgrp|chmod|chown|chroot|chkconfig|cksum|clear|cmake|cmp|comm|cp|cron|crontab|csplit|cut|date|dc|dd|ddrescue|df|diff|diff3|dig|dir|dircolors|dirname|dirs|dmesg|dpkg|du|egrep|eject|env|ethtool|expect|expand|expr|fdformat|fdisk|fgrep|file|find|fmt|fold|format|free|fsck|ftp|function|fuser|gawk|git|grep|groups|gzip|head|hostname|id|ifconfig|ifdown|ifup|import|install|join|kdialog|kill|killall|less|ln|locate|logname|look|lpc|lpr|lprint|lprintd|lprintq|lprm|ls|lsof|make|man|mkdir|mkfifo|mkisofs|mknod|more|mount|mtools|mv|mmv|netstat|nice|nl|nohup|nslookup|open|op|passwd|paste|pathchk|ping|pkill|popd|pr|printcap|printenv|ps|pwd|qarma|qmake(-qt[3-9])*|quota|quotacheck|quotactl|ram|rcp|readarray|reboot|rename|renice|remsync|rev|rm|rmdir|rsync|screen|scp|sdiff|sed|seq|sftp|shutdown|sleep|slocate|sort|split|ssh|strace|su|sudo|sum|symlink|sync|tail|tar|tee|time|touch|top|traceroute|tr|tsort|tty|type|ulimit|umount|uname|unexpand|uniq|units|unshar|useradd|usermod|users|uuencode|uudecode|vdir|vi|vmstat|watch|wc|whereis|which|who|whoami|Wget|write|xargs|yad|yes|zenity)(?!\\.)(?!-)(?!(\\.|-|@|#|\\$))\\b");
+        rule.pattern = QRegularExpression ("((^\\s*|[\\(\\);&`\\|]+\\s*)((if|then|elif|else|fi|while|do|done|esac)\\s+)*)(adduser|addgroup|apropos|apt-get|aspell|awk|basename|bash|bc|bzip2|cal|cat|cd|cfdisk|chgrp|chmod|chown|chroot|chkconfig|cksum|clear|cmake|cmp|comm|cp|cron|crontab|csplit|cut|date|dc|dd|ddrescue|df|diff|diff3|dig|dir|dircolors|dirname|dirs|dmesg|dpkg|du|egrep|eject|env|ethtool|expect|expand|expr|fdformat|fdisk|fgrep|file|find|fmt|fold|format|free|fsck|ftp|function|fuser|gawk|git|grep|groups|gzip|head|hostname|id|ifconfig|ifdown|ifup|import|install|join|kdialog|kill|killall|less|ln|locate|logname|look|lpc|lpr|lprint|lprintd|lprintq|lprm|ls|lsof|make|man|mkdir|mkfifo|mkisofs|mknod|more|mount|mtools|mv|mmv|netstat|nice|nl|nohup|nslookup|open|op|passwd|paste|pathchk|ping|pkill|popd|pr|printcap|printenv|ps|pwd|qarma|qmake(-qt[3-9])*|quota|quotacheck|quotactl|ram|rcp|readarray|reboot|rename|renice|remsync|rev|rm|rmdir|rsync|screen|scp|sdiff|sed|seq|sftp|shutdown|sleep|slocate|sort|split|ssh|strace|su|sudo|sum|symlink|sync|tail|tar|tee|time|touch|top|traceroute|tr|tsort|tty|type|ulimit|umount|uname|unexpand|uniq|units|unshar|useradd|usermod|users|uuencode|uudecode|vdir|vi|vmstat|watch|wc|whereis|which|who|whoami|Wget|write|xargs|yad|yes|zenity)(?!\\.)(?!-)(?!(\\.|-|@|#|\\$))\\b");
         rule.format = keywordFormat;
         highlightingRules.append (rule);
     }
@@ -240,7 +519,7 @@ Highlighter::Highlighter (QTextDocument *parent, QString lang, QTextCursor start
     patterns = keywords (lang);
     foreach (const QString &pattern, patterns)
     {
-        rule.pattern = QRegExp (pattern);
+        rule.pattern = QRegularExpression (pattern);
         rule.format = keywordFormat;
         highlightingRules.append (rule);
     }
@@ -250,12 +529,12 @@ Highlighter::Highlighter (QTextDocument *parent, QString lang, QTextCursor start
         QTextCharFormat qmakeFormat;
         /* qmake test functions */
         qmakeFormat.setForeground (DarkMagenta);
-        rule.pattern = QRegExp ("\\b(cache|CONFIG|contains|count|debug|defined|equals|error|eval|exists|export|files|for|greaterThan|if|include|infile|isActiveConfig|isEmpty|isEqual|lessThan|load|log|message|mkpath|packagesExist|prepareRecursiveTarget|qtCompileTest|qtHaveModule|requires|system|touch|unset|warning|write_file)(?=\\s*\\()");
+        rule.pattern = QRegularExpression ("\\b(cache|CONFIG|contains|count|debug|defined|equals|error|eval|exists|export|files|for|greaterThan|if|include|infile|isActiveConfig|isEmpty|isEqual|lessThan|load|log|message|mkpath|packagesExist|prepareRecursiveTarget|qtCompileTest|qtHaveModule|requires|system|touch|unset|warning|write_file)(?=\\s*\\()");
         rule.format = qmakeFormat;
         highlightingRules.append (rule);
         /* qmake paths */
         qmakeFormat.setForeground (Blue);
-        rule.pattern = QRegExp ("\\${1,2}([A-Za-z0-9_]+|\\[[A-Za-z0-9_]+\\]|\\([A-Za-z0-9_]+\\))");
+        rule.pattern = QRegularExpression ("\\${1,2}([A-Za-z0-9_]+|\\[[A-Za-z0-9_]+\\]|\\([A-Za-z0-9_]+\\))");
         rule.format = qmakeFormat;
         highlightingRules.append (rule);
     }
@@ -263,7 +542,7 @@ Highlighter::Highlighter (QTextDocument *parent, QString lang, QTextCursor start
     patterns = types();
     foreach (const QString &pattern, patterns)
     {
-        rule.pattern = QRegExp (pattern);
+        rule.pattern = QRegularExpression (pattern);
         rule.format = typeFormat;
         highlightingRules.append (rule);
     }
@@ -288,9 +567,9 @@ Highlighter::Highlighter (QTextDocument *parent, QString lang, QTextCursor start
         cFormat.setFontWeight (QFont::Bold);
         cFormat.setForeground (DarkMagenta);
         if (progLan == "cpp")
-            rule.pattern = QRegExp ("\\bQ[A-Za-z]+(?!(\\.|-|@|#|\\$))\\b");
+            rule.pattern = QRegularExpression ("\\bQ[A-Za-z]+(?!(\\.|-|@|#|\\$))\\b");
         else
-            rule.pattern = QRegExp ("\\bG[A-Za-z]+(?!(\\.|-|@|#|\\$))\\b");
+            rule.pattern = QRegularExpression ("\\bG[A-Za-z]+(?!(\\.|-|@|#|\\$))\\b");
         rule.format = cFormat;
         highlightingRules.append (rule);
 
@@ -298,20 +577,20 @@ Highlighter::Highlighter (QTextDocument *parent, QString lang, QTextCursor start
         if (progLan == "cpp")
         {
             cFormat.setFontItalic (true);
-            rule.pattern = QRegExp ("\\bq(App)(?!(\\@|#|\\$))\\b|\\bq(Abs|Bound|Critical|Debug|Fatal|FuzzyCompare|InstallMsgHandler|MacVersion|Max|Min|Round64|Round|Version|Warning|getenv|putenv|rand|srand|tTrId|_check_ptr|t_set_sequence_auto_mnemonic|t_symbian_exception2Error|t_symbian_exception2LeaveL|t_symbian_throwIfError)(?!(\\.|-|@|#|\\$))\\b");
+            rule.pattern = QRegularExpression ("\\bq(App)(?!(\\@|#|\\$))\\b|\\bq(Abs|Bound|Critical|Debug|Fatal|FuzzyCompare|InstallMsgHandler|MacVersion|Max|Min|Round64|Round|Version|Warning|getenv|putenv|rand|srand|tTrId|_check_ptr|t_set_sequence_auto_mnemonic|t_symbian_exception2Error|t_symbian_exception2LeaveL|t_symbian_throwIfError)(?!(\\.|-|@|#|\\$))\\b");
             rule.format = cFormat;
             highlightingRules.append (rule);
             cFormat.setFontItalic (false);
 
             cFormat.setForeground (Qt::magenta);
-            rule.pattern = QRegExp ("\\bQt\\s*::\\s*(white|black|red|darkRed|green|darkGreen|blue|darkBlue|cyan|darkCyan|magenta|darkMagenta|yellow|darkYellow|gray|darkGray|lightGray|transparent|color0|color1)(?!(\\.|-|@|#|\\$))\\b");
+            rule.pattern = QRegularExpression ("\\bQt\\s*::\\s*(white|black|red|darkRed|green|darkGreen|blue|darkBlue|cyan|darkCyan|magenta|darkMagenta|yellow|darkYellow|gray|darkGray|lightGray|transparent|color0|color1)(?!(\\.|-|@|#|\\$))\\b");
             rule.format = cFormat;
             highlightingRules.append (rule);
         }
 
         /* preprocess */
         cFormat.setForeground (Blue);
-        rule.pattern = QRegExp ("^\\s*#\\s*include\\s|^\\s*#\\s*ifdef\\s|^\\s*#\\s*elif\\s|^\\s*#\\s*ifndef\\s|^\\s*#\\s*endif\\b|^\\s*#\\s*define\\s|^\\s*#\\s*undef\\s|^\\s*#\\s*error\\s|^\\s*#\\s*if\\s|^\\s*#\\s*else(?!(\\.|-|@|#|\\$))\\b");
+        rule.pattern = QRegularExpression ("^\\s*#\\s*include\\s|^\\s*#\\s*ifdef\\s|^\\s*#\\s*elif\\s|^\\s*#\\s*ifndef\\s|^\\s*#\\s*endif\\b|^\\s*#\\s*define\\s|^\\s*#\\s*undef\\s|^\\s*#\\s*error\\s|^\\s*#\\s*if\\s|^\\s*#\\s*else(?!(\\.|-|@|#|\\$))\\b");
         rule.format = cFormat;
         highlightingRules.append (rule);
     }
@@ -320,7 +599,7 @@ Highlighter::Highlighter (QTextDocument *parent, QString lang, QTextCursor start
         QTextCharFormat pFormat;
         pFormat.setFontWeight (QFont::Bold);
         pFormat.setForeground (DarkMagenta);
-        rule.pattern = QRegExp ("\\bself(?!(@|\\$))\\b");
+        rule.pattern = QRegularExpression ("\\bself(?!(@|\\$))\\b");
         rule.format = pFormat;
         highlightingRules.append (rule);
     }
@@ -329,7 +608,7 @@ Highlighter::Highlighter (QTextDocument *parent, QString lang, QTextCursor start
         QTextCharFormat qmlFormat;
         qmlFormat.setFontWeight (QFont::Bold);
         qmlFormat.setForeground (DarkMagenta);
-        rule.pattern = QRegExp ("\\b(Qt[A-Za-z]+|Accessible|AnchorAnimation|AnchorChanges|AnimatedImage|AnimatedSprite|Animation|AnimationController|Animator|Behavior|BorderImage|Canvas|CanvasGradient|CanvasImageData|CanvasPixelArray|ColorAnimation|Column|Context2D|DoubleValidator|Drag|DragEvent|DropArea|EnterKey|Flickable|Flipable|Flow|FocusScope|FontLoader|FontMetrics|Gradient|GradientStop|Grid|GridMesh|GridView|Image|IntValidator|Item|ItemGrabResult|KeyEvent|KeyNavigation|Keys|LayoutMirroring|ListView|Loader|Matrix4x4|MouseArea|MouseEvent|MultiPointTouchArea|NumberAnimation|OpacityAnimator|OpenGLInfo|ParallelAnimation|ParentAnimation|ParentChange|Path|PathAnimation|PathArc|PathAttribute|PathCubic|PathCurve|PathElement|PathInterpolator|PathLine|PathPercent|PathQuad|PathSvg|PathView|PauseAnimation|PinchArea|PinchEvent|Positioner|PropertyAction|PropertyAnimation|PropertyChanges|Rectangle|RegExpValidator|Repeater|Rotation|RotationAnimation|RotationAnimator|Row|Scale|ScaleAnimator|ScriptAction|SequentialAnimation|ShaderEffect|ShaderEffectSource|Shortcut|SmoothedAnimation|SpringAnimation|Sprite|SpriteSequence|State|StateChangeScript|StateGroup|SystemPalette|Text|TextEdit|TextInput|TextMetrics|TouchPoint|Transform|Transition|Translate|UniformAnimator|Vector3dAnimation|ViewTransition|WheelEvent|XAnimator|YAnimator|CloseEvent|ColorDialog|ColumnLayout|Dialog|FileDialog|FontDialog|GridLayout|Layout|MessageDialog|RowLayout|StackLayout|LocalStorage|Screen|SignalSpy|TestCase|Window|XmlListModel|XmlRole|Action|ApplicationWindow|BusyIndicator|Button|Calendar|CheckBox|ComboBox|ExclusiveGroup|GroupBox|Label|Menu|MenuBar|MenuItem|MenuSeparator|ProgressBar|RadioButton|ScrollView|Slider|SpinBox|SplitView|Stack|StackView|StackViewDelegate|StatusBar|Switch|Tab|TabView|TableView|TableViewColumn|TextArea|TextField|ToolBar|ToolButton|TreeView|Affector|Age|AngleDirection|Attractor|CumulativeDirection|CustomParticle|Direction|EllipseShape|Emitter|Friction|Gravity|GroupGoal|ImageParticle|ItemParticle|LineShape|MaskShape|Particle|ParticleGroup|ParticlePainter|ParticleSystem|PointDirection|RectangleShape|Shape|SpriteGoal|TargetDirection|TrailEmitter|Turbulence|Wander|Timer)(?!(\\-|@|#|\\$))\\b");
+        rule.pattern = QRegularExpression ("\\b(Qt[A-Za-z]+|Accessible|AnchorAnimation|AnchorChanges|AnimatedImage|AnimatedSprite|Animation|AnimationController|Animator|Behavior|BorderImage|Canvas|CanvasGradient|CanvasImageData|CanvasPixelArray|ColorAnimation|Column|Context2D|DoubleValidator|Drag|DragEvent|DropArea|EnterKey|Flickable|Flipable|Flow|FocusScope|FontLoader|FontMetrics|Gradient|GradientStop|Grid|GridMesh|GridView|Image|IntValidator|Item|ItemGrabResult|KeyEvent|KeyNavigation|Keys|LayoutMirroring|ListView|Loader|Matrix4x4|MouseArea|MouseEvent|MultiPointTouchArea|NumberAnimation|OpacityAnimator|OpenGLInfo|ParallelAnimation|ParentAnimation|ParentChange|Path|PathAnimation|PathArc|PathAttribute|PathCubic|PathCurve|PathElement|PathInterpolator|PathLine|PathPercent|PathQuad|PathSvg|PathView|PauseAnimation|PinchArea|PinchEvent|Positioner|PropertyAction|PropertyAnimation|PropertyChanges|Rectangle|RegExpValidator|Repeater|Rotation|RotationAnimation|RotationAnimator|Row|Scale|ScaleAnimator|ScriptAction|SequentialAnimation|ShaderEffect|ShaderEffectSource|Shortcut|SmoothedAnimation|SpringAnimation|Sprite|SpriteSequence|State|StateChangeScript|StateGroup|SystemPalette|Text|TextEdit|TextInput|TextMetrics|TouchPoint|Transform|Transition|Translate|UniformAnimator|Vector3dAnimation|ViewTransition|WheelEvent|XAnimator|YAnimator|CloseEvent|ColorDialog|ColumnLayout|Dialog|FileDialog|FontDialog|GridLayout|Layout|MessageDialog|RowLayout|StackLayout|LocalStorage|Screen|SignalSpy|TestCase|Window|XmlListModel|XmlRole|Action|ApplicationWindow|BusyIndicator|Button|Calendar|CheckBox|ComboBox|ExclusiveGroup|GroupBox|Label|Menu|MenuBar|MenuItem|MenuSeparator|ProgressBar|RadioButton|ScrollView|Slider|SpinBox|SplitView|Stack|StackView|StackViewDelegate|StatusBar|Switch|Tab|TabView|TableView|TableViewColumn|TextArea|TextField|ToolBar|ToolButton|TreeView|Affector|Age|AngleDirection|Attractor|CumulativeDirection|CustomParticle|Direction|EllipseShape|Emitter|Friction|Gravity|GroupGoal|ImageParticle|ItemParticle|LineShape|MaskShape|Particle|ParticleGroup|ParticlePainter|ParticleSystem|PointDirection|RectangleShape|Shape|SpriteGoal|TargetDirection|TrailEmitter|Turbulence|Wander|Timer)(?!(\\-|@|#|\\$))\\b");
         rule.format = qmlFormat;
         highlightingRules.append (rule);
     }
@@ -339,7 +618,7 @@ Highlighter::Highlighter (QTextDocument *parent, QString lang, QTextCursor start
         xmlElementFormat.setFontWeight (QFont::Bold);
         xmlElementFormat.setForeground (Violet);
         /* after </ or before /> */
-        rule.pattern = QRegExp ("\\s*</?[A-Za-z0-9_\\-:]+|\\s*<!(DOCTYPE|ENTITY)\\s|\\s*/?>");
+        rule.pattern = QRegularExpression ("\\s*</?[A-Za-z0-9_\\-:]+|\\s*<!(DOCTYPE|ENTITY)\\s|\\s*/?>");
         rule.format = xmlElementFormat;
         highlightingRules.append (rule);
 
@@ -347,26 +626,26 @@ Highlighter::Highlighter (QTextDocument *parent, QString lang, QTextCursor start
         xmlAttributeFormat.setFontItalic (true);
         xmlAttributeFormat.setForeground (Blue);
         /* before = */
-        rule.pattern = QRegExp ("\\b[A-Za-z0-9_\\-:]+(?=\\s*\\=)");
+        rule.pattern = QRegularExpression ("\\b[A-Za-z0-9_\\-:]+(?=\\s*\\=)");
         rule.format = xmlAttributeFormat;
         highlightingRules.append (rule);
 
         /* <?xml ... ?> */
-        rule.pattern = QRegExp ("^\\s*<\\?xml\\s+(?=.*\\?>)|\\s*\\?>");
+        rule.pattern = QRegularExpression ("^\\s*<\\?xml\\s+(?=.*\\?>)|\\s*\\?>");
         rule.format = keywordFormat;
         highlightingRules.append (rule);
     }
     else if (progLan == "changelog")
     {
         /* before colon */
-        rule.pattern = QRegExp ("^\\s+\\*\\s+[^:]+:");
+        rule.pattern = QRegularExpression ("^\\s+\\*\\s+[^:]+:");
         rule.format = keywordFormat;
         highlightingRules.append (rule);
 
         QTextCharFormat asteriskFormat;
         asteriskFormat.setForeground (DarkMagenta);
         /* the first asterisk */
-        rule.pattern = QRegExp ("^\\s+\\*\\s+");
+        rule.pattern = QRegularExpression ("^\\s+\\*\\s+");
         rule.format = asteriskFormat;
         highlightingRules.append (rule);
     }
@@ -375,9 +654,9 @@ Highlighter::Highlighter (QTextDocument *parent, QString lang, QTextCursor start
     {
         /* # is the sh comment sign when it doesn't follow a character */
         if (progLan == "sh" || progLan == "makefile" || progLan == "cmake")
-            rule.pattern = QRegExp ("^#.*|\\s+#.*");
+            rule.pattern = QRegularExpression ("^#.*|\\s+#.*");
         else
-            rule.pattern = QRegExp ("#.*");
+            rule.pattern = QRegularExpression ("#.*");
         rule.format = commentFormat;
         highlightingRules.append (rule);
 
@@ -386,22 +665,22 @@ Highlighter::Highlighter (QTextDocument *parent, QString lang, QTextCursor start
         if (progLan == "sh" || progLan == "makefile" || progLan == "cmake")
         {
             /* make parentheses and ; neutral as they were in keyword patterns */
-            rule.pattern = QRegExp ("[\\(\\);]");
+            rule.pattern = QRegularExpression ("[\\(\\);]");
             rule.format = neutralFormat;
             highlightingRules.append (rule);
 
             shFormat.setForeground (Blue);
             /* words before = */
              if (progLan == "sh")
-                 rule.pattern = QRegExp ("\\b[A-Za-z0-9_]+(?=\\=)");
+                 rule.pattern = QRegularExpression ("\\b[A-Za-z0-9_]+(?=\\=)");
              else
-                 rule.pattern = QRegExp ("\\b[A-Za-z0-9_]+\\s*(?=\\+{,1}\\=)");
+                 rule.pattern = QRegularExpression ("\\b[A-Za-z0-9_]+\\s*(?=\\+{0,1}\\=)");
             rule.format = shFormat;
             highlightingRules.append (rule);
 
             /* but don't format a word before =
                if it follows a dash */
-            rule.pattern = QRegExp ("-+[^\\s\\\"\\\']+(?=\\=)");
+            rule.pattern = QRegularExpression ("-+[^\\s\\\"\\\']+(?=\\=)");
             rule.format = neutralFormat;
             highlightingRules.append (rule);
         }
@@ -410,14 +689,14 @@ Highlighter::Highlighter (QTextDocument *parent, QString lang, QTextCursor start
         {
             shFormat.setForeground (DarkYellow);
             /* automake/autoconf variables */
-            rule.pattern = QRegExp ("@[A-Za-z0-9_-]+@|^[a-zA-Z0-9_-]+\\s*(?=:)");
+            rule.pattern = QRegularExpression ("@[A-Za-z0-9_-]+@|^[a-zA-Z0-9_-]+\\s*(?=:)");
             rule.format = shFormat;
             highlightingRules.append (rule);
         }
 
         shFormat.setForeground (DarkMagenta);
         /* operators */
-        rule.pattern = QRegExp ("[=\\+\\-*/%<>&`\\|~\\^\\!,]|\\s+-eq\\s+|\\s+-ne\\s+|\\s+-gt\\s+|\\s+-ge\\s+|\\s+-lt\\s+|\\s+-le\\s+|\\s+-z\\s+");
+        rule.pattern = QRegularExpression ("[=\\+\\-*/%<>&`\\|~\\^\\!,]|\\s+-eq\\s+|\\s+-ne\\s+|\\s+-gt\\s+|\\s+-ge\\s+|\\s+-lt\\s+|\\s+-le\\s+|\\s+-z\\s+");
         rule.format = shFormat;
         highlightingRules.append (rule);
 
@@ -425,7 +704,7 @@ Highlighter::Highlighter (QTextDocument *parent, QString lang, QTextCursor start
         {
             shFormat.setFontWeight (QFont::Bold);
             /* brackets */
-            rule.pattern = QRegExp ("\\s+\\[{1,2}\\s+|^\\[{1,2}\\s+|\\s+\\]{1,2}\\s+|\\s+\\]{1,2}$|\\s+\\]{1,2}\\s*(?=;)");
+            rule.pattern = QRegularExpression ("\\s+\\[{1,2}\\s+|^\\[{1,2}\\s+|\\s+\\]{1,2}\\s+|\\s+\\]{1,2}$|\\s+\\]{1,2}\\s*(?=;)");
             rule.format = shFormat;
             highlightingRules.append (rule);
         }
@@ -434,20 +713,20 @@ Highlighter::Highlighter (QTextDocument *parent, QString lang, QTextCursor start
     {
         QTextCharFormat diffMinusFormat;
         diffMinusFormat.setForeground (Red);
-        rule.pattern = QRegExp ("^\\-\\s*.*");
+        rule.pattern = QRegularExpression ("^\\-\\s*.*");
         rule.format = diffMinusFormat;
         highlightingRules.append (rule);
 
         QTextCharFormat diffPlusFormat;
         diffPlusFormat.setForeground (Blue);
-        rule.pattern = QRegExp ("^\\+\\s*.*");
+        rule.pattern = QRegularExpression ("^\\+\\s*.*");
         rule.format = diffPlusFormat;
         highlightingRules.append (rule);
 
         QTextCharFormat diffLinesFormat;
         diffLinesFormat.setFontWeight (QFont::Bold);
         diffLinesFormat.setForeground (DarkGreenAlt);
-        rule.pattern = QRegExp ("^@{2}[0-9,\\-\\+\\s]+@{2}");
+        rule.pattern = QRegularExpression ("^@{2}[0-9,\\-\\+\\s]+@{2}");
         rule.format = diffLinesFormat;
         highlightingRules.append (rule);
     }
@@ -458,41 +737,41 @@ Highlighter::Highlighter (QTextDocument *parent, QString lang, QTextCursor start
          *   blue  green  magenta bold */
         QTextCharFormat logFormat;
         logFormat.setFontWeight (QFont::Bold);
-        rule.pattern = QRegExp ("^[A-Za-z]{3}\\s+[0-9]{1,2}\\s{1}[0-9]{2}:[0-9]{2}:[0-9]{2}\\s+[A-Za-z0-9_\\[\\]\\s]+(?=\\s*:)");
+        rule.pattern = QRegularExpression ("^[A-Za-z]{3}\\s+[0-9]{1,2}\\s{1}[0-9]{2}:[0-9]{2}:[0-9]{2}\\s+[A-Za-z0-9_\\[\\]\\s]+(?=\\s*:)");
         rule.format = logFormat;
         highlightingRules.append (rule);
 
         QTextCharFormat logFormat1;
         logFormat1.setForeground (Qt::magenta);
-        rule.pattern = QRegExp ("^[A-Za-z]{3}\\s+[0-9]{1,2}\\s{1}[0-9]{2}:[0-9]{2}:[0-9]{2}\\s+[A-Za-z]+");
+        rule.pattern = QRegularExpression ("^[A-Za-z]{3}\\s+[0-9]{1,2}\\s{1}[0-9]{2}:[0-9]{2}:[0-9]{2}\\s+[A-Za-z]+");
         rule.format = logFormat1;
         highlightingRules.append (rule);
 
         QTextCharFormat logDateFormat;
         logDateFormat.setFontWeight (QFont::Bold);
         logDateFormat.setForeground (Blue);
-        rule.pattern = QRegExp ("^[A-Za-z]{3}\\s+[0-9]{1,2}(?=\\s{1}[0-9]{2}:[0-9]{2}:[0-9]{2})");
+        rule.pattern = QRegularExpression ("^[A-Za-z]{3}\\s+[0-9]{1,2}(?=\\s{1}[0-9]{2}:[0-9]{2}:[0-9]{2})");
         rule.format = logDateFormat;
         highlightingRules.append (rule);
 
         QTextCharFormat logTimeFormat;
         logTimeFormat.setFontWeight (QFont::Bold);
         logTimeFormat.setForeground (DarkGreenAlt);
-        rule.pattern = QRegExp ("\\s{1}[0-9]{2}:[0-9]{2}:[0-9]{2}\\b");
+        rule.pattern = QRegularExpression ("\\s{1}[0-9]{2}:[0-9]{2}:[0-9]{2}\\b");
         rule.format = logTimeFormat;
         highlightingRules.append (rule);
 
         QTextCharFormat logInOutFormat;
         logInOutFormat.setFontWeight (QFont::Bold);
         logInOutFormat.setForeground (Brown);
-        rule.pattern = QRegExp ("\\s+IN(?=\\s*\\=)|\\s+OUT(?=\\s*\\=)");
+        rule.pattern = QRegularExpression ("\\s+IN(?=\\s*\\=)|\\s+OUT(?=\\s*\\=)");
         rule.format = logInOutFormat;
         highlightingRules.append (rule);
 
         QTextCharFormat logRootFormat;
         logRootFormat.setFontWeight (QFont::Bold);
         logRootFormat.setForeground (Red);
-        rule.pattern = QRegExp ("\\broot\\b");
+        rule.pattern = QRegularExpression ("\\broot\\b");
         rule.format = logRootFormat;
         highlightingRules.append (rule);
     }
@@ -503,38 +782,38 @@ Highlighter::Highlighter (QTextDocument *parent, QString lang, QTextCursor start
 
         /* <...> */
         srtFormat.setForeground (Violet);
-        rule.pattern = QRegExp ("</?[A-Za-z0-9_#\\s\"\\=]+>");
+        rule.pattern = QRegularExpression ("</?[A-Za-z0-9_#\\s\"\\=]+>");
         rule.format = srtFormat;
         highlightingRules.append (rule);
 
         /* hh:mm:ss,ttt */
         srtFormat.setForeground (QBrush());
         srtFormat.setFontItalic (true);
-        rule.pattern = QRegExp ("^[0-9]+$|^[0-9]{2}:[0-9]{2}:[0-9]{2},[0-9]{3}\\s-->\\s[0-9]{2}:[0-9]{2}:[0-9]{2},[0-9]{3}$");
+        rule.pattern = QRegularExpression ("^[0-9]+$|^[0-9]{2}:[0-9]{2}:[0-9]{2},[0-9]{3}\\s-->\\s[0-9]{2}:[0-9]{2}:[0-9]{2},[0-9]{3}$");
         rule.format = srtFormat;
         highlightingRules.append (rule);
 
         /* subtitle line */
         srtFormat.setForeground (Red);
-        rule.pattern = QRegExp ("^[0-9]+$");
+        rule.pattern = QRegularExpression ("^[0-9]+$");
         rule.format = srtFormat;
         highlightingRules.append (rule);
 
         /* mm */
         srtFormat.setForeground (DarkGreenAlt);
-        rule.pattern = QRegExp ("[0-9]{2}(?=:[0-9]{2},[0-9]{3}\\s-->\\s[0-9]{2}:[0-9]{2}:[0-9]{2},[0-9]{3}$)|[0-9]{2}(?=:[0-9]{2},[0-9]{3}$)");
+        rule.pattern = QRegularExpression ("[0-9]{2}(?=:[0-9]{2},[0-9]{3}\\s-->\\s[0-9]{2}:[0-9]{2}:[0-9]{2},[0-9]{3}$)|[0-9]{2}(?=:[0-9]{2},[0-9]{3}$)");
         rule.format = srtFormat;
         highlightingRules.append (rule);
 
         /* hh */
         srtFormat.setForeground (Blue);
-        rule.pattern = QRegExp ("^[0-9]{2}(?=:[0-9]{2}:[0-9]{2},[0-9]{3}\\s-->\\s[0-9]{2}:[0-9]{2}:[0-9]{2},[0-9]{3}$)|\\s[0-9]{2}(?=:[0-9]{2}:[0-9]{2},[0-9]{3}$)");
+        rule.pattern = QRegularExpression ("^[0-9]{2}(?=:[0-9]{2}:[0-9]{2},[0-9]{3}\\s-->\\s[0-9]{2}:[0-9]{2}:[0-9]{2},[0-9]{3}$)|\\s[0-9]{2}(?=:[0-9]{2}:[0-9]{2},[0-9]{3}$)");
         rule.format = srtFormat;
         highlightingRules.append (rule);
 
         /* ss */
         srtFormat.setForeground (Brown);
-        rule.pattern = QRegExp ("[0-9]{2}(?=,[0-9]{3}\\s-->\\s[0-9]{2}:[0-9]{2}:[0-9]{2},[0-9]{3}$)|[0-9]{2}(?=,[0-9]{3}$)");
+        rule.pattern = QRegularExpression ("[0-9]{2}(?=,[0-9]{3}\\s-->\\s[0-9]{2}:[0-9]{2}:[0-9]{2},[0-9]{3}$)|[0-9]{2}(?=,[0-9]{3}$)");
         rule.format = srtFormat;
         highlightingRules.append (rule);
     }
@@ -542,7 +821,7 @@ Highlighter::Highlighter (QTextDocument *parent, QString lang, QTextCursor start
     {
         QTextCharFormat desktopSignsFormat;
         desktopSignsFormat.setForeground (DarkMagenta);
-        rule.pattern = QRegExp ("=|;|/|%|\\+|-");
+        rule.pattern = QRegularExpression ("=|;|/|%|\\+|-");
         rule.format = desktopSignsFormat;
         highlightingRules.append (rule);
 
@@ -550,19 +829,19 @@ Highlighter::Highlighter (QTextDocument *parent, QString lang, QTextCursor start
 
         desktopFormat.setFontWeight (QFont::Bold);
         /* [...] */
-        rule.pattern = QRegExp ("^\\[.*\\]$");
+        rule.pattern = QRegularExpression ("^\\[.*\\]$");
         rule.format = desktopFormat;
         highlightingRules.append (rule);
 
         desktopFormat.setForeground (DarkGreenAlt);
         /* before = */
-        rule.pattern = QRegExp ("^[^\\=]+(?=\\s*\\=)");
+        rule.pattern = QRegularExpression ("^[^\\=]+(?=\\s*\\=)");
         rule.format = desktopFormat;
         highlightingRules.append (rule);
 
         desktopFormat.setForeground (Blue);
         /* [...] and before = */
-        rule.pattern = QRegExp ("\\[.*\\](?=\\s*\\=)");
+        rule.pattern = QRegularExpression ("\\[.*\\](?=\\s*\\=)");
         rule.format = desktopFormat;
         highlightingRules.append (rule);
     }
@@ -572,16 +851,16 @@ Highlighter::Highlighter (QTextDocument *parent, QString lang, QTextCursor start
         {
             QTextCharFormat slFormat;
             slFormat.setFontWeight (QFont::Bold);
-            rule.pattern = QRegExp ("\\bdeb(?=\\s+)|\\bdeb-src(?=\\s+)");
+            rule.pattern = QRegularExpression ("\\bdeb(?=\\s+)|\\bdeb-src(?=\\s+)");
             rule.format = slFormat;
             highlightingRules.append (rule);
 
             slFormat.setFontItalic (true);
-            rule.pattern = QRegExp ("\\bstable\\b|\\btesting\\b|\\bunstable\\b|\\bsid\\b|\\bexperimental\\b");
+            rule.pattern = QRegularExpression ("\\bstable\\b|\\btesting\\b|\\bunstable\\b|\\bsid\\b|\\bexperimental\\b");
             rule.format = slFormat;
             highlightingRules.append (rule);
         }
-        rule.pattern = QRegExp ("\\b[A-Za-z0-9_]+://[A-Za-z0-9_.+/\\?\\=~&%#\\-:\\(\\)]+");
+        rule.pattern = QRegularExpression ("\\b[A-Za-z0-9_]+://[A-Za-z0-9_.+/\\?\\=~&%#\\-:\\(\\)]+");
         rule.format = urlFormat;
         highlightingRules.append (rule);
     }
@@ -591,12 +870,12 @@ Highlighter::Highlighter (QTextDocument *parent, QString lang, QTextCursor start
         QTextCharFormat gtkrcFormat;
         gtkrcFormat.setForeground (DarkGreenAlt);
         gtkrcFormat.setFontWeight (QFont::Bold);
-        rule.pattern = QRegExp ("#\\b([A-Za-z0-9]{3}){,4}(?![A-Za-z0-9_]+)");
+        rule.pattern = QRegularExpression ("#\\b([A-Za-z0-9]{3}){0,4}(?![A-Za-z0-9_]+)");
         rule.format = gtkrcFormat;
         highlightingRules.append (rule);
 
         gtkrcFormat.setForeground (Blue);
-        rule.pattern = QRegExp ("(fg|bg|base|text)(\\[NORMAL\\]|\\[PRELIGHT\\]|\\[ACTIVE\\]|\\[SELECTED\\]|\\[INSENSITIVE\\])");
+        rule.pattern = QRegularExpression ("(fg|bg|base|text)(\\[NORMAL\\]|\\[PRELIGHT\\]|\\[ACTIVE\\]|\\[SELECTED\\]|\\[INSENSITIVE\\])");
         rule.format = gtkrcFormat;
         highlightingRules.append (rule);
     }
@@ -609,41 +888,41 @@ Highlighter::Highlighter (QTextDocument *parent, QString lang, QTextCursor start
 
         /* italic */
         markdownFormat.setFontItalic (true);
-        rule.pattern = QRegExp ("\\*[^\\*\\s]\\*|\\*[^\\*\\s][^\\*]*[^\\*\\s]\\*"
-                                "|"
-                                "_[^_\\s]_|_[^_\\s][^_]*[^_\\s]_");
+        rule.pattern = QRegularExpression ("\\*[^\\*\\s]\\*|\\*[^\\*\\s][^\\*]*[^\\*\\s]\\*"
+                                           "|"
+                                           "_[^_\\s]_|_[^_\\s][^_]*[^_\\s]_");
         rule.format = markdownFormat;
         highlightingRules.append (rule);
         markdownFormat.setFontItalic (false);
 
         /* bold */
         markdownFormat.setFontWeight (QFont::Bold);
-        rule.pattern = QRegExp ("\\*{2}[^\\*\\s]\\*{2}|\\*{2}[^\\*\\s][^\\*]*[^\\*\\s]\\*{2}"
-                                "|"
-                                "_{2}[^_\\s]_{2}|_{2}[^_\\s][^_]*[^_\\s]_{2}");
+        rule.pattern = QRegularExpression ("\\*{2}[^\\*\\s]\\*{2}|\\*{2}[^\\*\\s][^\\*]*[^\\*\\s]\\*{2}"
+                                           "|"
+                                           "_{2}[^_\\s]_{2}|_{2}[^_\\s][^_]*[^_\\s]_{2}");
         rule.format = markdownFormat;
         highlightingRules.append (rule);
 
         /* lists */
         markdownFormat.setForeground (DarkBlue);
-        rule.pattern = QRegExp ("^ {,3}(\\*|\\+|\\-|[0-9]+\\.|[0-9]+\\))\\s+");
+        rule.pattern = QRegularExpression ("^ {0,3}(\\*|\\+|\\-|[0-9]+\\.|[0-9]+\\))\\s+");
         rule.format = markdownFormat;
         highlightingRules.append (rule);
 
         /* footnotes */
         markdownFormat.setFontItalic (true);
-        rule.pattern = QRegExp ("\\[\\^.+\\]");
+        rule.pattern = QRegularExpression ("\\[\\^.+\\]");
         rule.format = markdownFormat;
         highlightingRules.append (rule);
         markdownFormat.setFontItalic (false);
 
         /* horizontal rules */
         markdownFormat.setForeground (DarkMagenta);
-        rule.pattern = QRegExp ("^ {,3}(\\* {,2}){3,}\\s*$"
-                                "|"
-                                "^ {,3}(- {,2}){3,}\\s*$"
-                                "|"
-                                "^ {,3}(\\= {,2}){3,}\\s*$");
+        rule.pattern = QRegularExpression ("^ {0,3}(\\* {0,2}){3,}\\s*$"
+                                           "|"
+                                           "^ {0,3}(- {0,2}){3,}\\s*$"
+                                           "|"
+                                           "^ {0,3}(\\= {0,2}){3,}\\s*$");
         rule.format = markdownFormat;
         highlightingRules.append (rule);
 
@@ -654,13 +933,13 @@ Highlighter::Highlighter (QTextDocument *parent, QString lang, QTextCursor start
            [link text]: http://example.com
            <http://example.com>
         */
-        rule.pattern = QRegExp ("\\[[^\\]\\^]*\\]\\s*\\[[^\\]\\s]*\\]"
-                                "|"
-                                "\\[[^\\]\\^]*\\]\\s*\\(\\s*[^\\)\\(\\s]+(\\s+\\\".*\\\")*\\s*\\)"
-                                "|"
-                                "\\[[^\\]\\^]*\\]:\\s+\\s*[^\\)\\(\\s]+(\\s+\\\".*\\\")*"
-                                "|"
-                                "<([A-Za-z0-9_]+://[A-Za-z0-9_.+/\\?\\=~&%#\\-:]+|[A-Za-z0-9_.\\-]+@[A-Za-z0-9_\\-]+\\.[A-Za-z0-9.]+)>");
+        rule.pattern = QRegularExpression ("\\[[^\\]\\^]*\\]\\s*\\[[^\\]\\s]*\\]"
+                                           "|"
+                                           "\\[[^\\]\\^]*\\]\\s*\\(\\s*[^\\)\\(\\s]+(\\s+\\\".*\\\")*\\s*\\)"
+                                           "|"
+                                           "\\[[^\\]\\^]*\\]:\\s+\\s*[^\\)\\(\\s]+(\\s+\\\".*\\\")*"
+                                           "|"
+                                           "<([A-Za-z0-9_]+://[A-Za-z0-9_.+/\\?\\=~&%#\\-:]+|[A-Za-z0-9_.\\-]+@[A-Za-z0-9_\\-]+\\.[A-Za-z0-9.]+)>");
         rule.format = urlFormat;
         highlightingRules.append (rule);
 
@@ -673,22 +952,22 @@ Highlighter::Highlighter (QTextDocument *parent, QString lang, QTextCursor start
         markdownFormat.setFontWeight (QFont::Normal);
         markdownFormat.setForeground (Violet);
         markdownFormat.setFontUnderline (true);
-        rule.pattern = QRegExp ("\\!\\[[^\\]\\^]*\\]\\s*"
-                                "(\\(\\s*[^\\)\\(\\s]+(\\s+\\\".*\\\")*\\s*\\)|\\s*\\[[^\\]]*\\])");
+        rule.pattern = QRegularExpression ("\\!\\[[^\\]\\^]*\\]\\s*"
+                                           "(\\(\\s*[^\\)\\(\\s]+(\\s+\\\".*\\\")*\\s*\\)|\\s*\\[[^\\]]*\\])");
         rule.format = markdownFormat;
         highlightingRules.append (rule);
         markdownFormat.setFontUnderline (false);
 
         /* code blocks */
         codeBlockFormat.setForeground (DarkRed);
-        rule.pattern = QRegExp ("^( {4,}|\\s*\\t+\\s*).*");
+        rule.pattern = QRegularExpression ("^( {4,}|\\s*\\t+\\s*).*");
         rule.format = codeBlockFormat;
         highlightingRules.append (rule);
 
         /* headings */
         markdownFormat.setFontWeight (QFont::Bold);
         markdownFormat.setForeground (Blue);
-        rule.pattern = QRegExp ("^#+\\s+.*");
+        rule.pattern = QRegularExpression ("^#+\\s+.*");
         rule.format = markdownFormat;
         highlightingRules.append (rule);
     }
@@ -698,23 +977,23 @@ Highlighter::Highlighter (QTextDocument *parent, QString lang, QTextCursor start
      ************/
 
     /* single line comments */
-    rule.pattern = QRegExp();
+    rule.pattern = QRegularExpression();
     if (progLan == "c" || progLan == "cpp" || lang == "javascript" // javascript inside html
         || lang == "qml" || progLan == "php" /*|| progLan == "css"*/)
     {
-        rule.pattern = QRegExp ("//.*"); // why had I set it to QRegExp ("//(?!\\*).*")?
+        rule.pattern = QRegularExpression ("//.*"); // why had I set it to QRegExp ("//(?!\\*).*")?
     }
     else if (progLan == "python" || progLan == "desktop"
              || progLan == "sourceslist" || progLan == "qmake"
              || progLan == "gtkrc")
     {
-        rule.pattern = QRegExp ("#.*"); // or "#[^\n]*"
+        rule.pattern = QRegularExpression ("#.*"); // or "#[^\n]*"
     }
     else if (progLan == "lua")
-        rule.pattern = QRegExp ("--(?!\\[).*");
+        rule.pattern = QRegularExpression ("--(?!\\[).*");
     else if (progLan == "troff")
-        rule.pattern = QRegExp ("\\\\\"|\\.\\s*\\\\\"");
-    if (!rule.pattern.isEmpty())
+        rule.pattern = QRegularExpression ("\\\\\"|\\.\\s*\\\\\"");
+    if (!rule.pattern.pattern().isEmpty())
     {
         rule.format = commentFormat;
         highlightingRules.append (rule);
@@ -753,6 +1032,19 @@ Highlighter::Highlighter (QTextDocument *parent, QString lang, QTextCursor start
         commentStartExpression = QRegExp ("<!--");
         commentEndExpression = QRegExp ("-->");
     }
+
+    makeKeywordRules();
+    compileRules();
+    cacheRules (cacheKey);
+}
+/*************************/
+Highlighter::~Highlighter()
+{
+    if (profile_)
+    {
+        dumpProfile();
+        delete profile_;
+    }
 }
 /*************************/
 // Check if a start or end quotation mark (positioned at "pos") is escaped.
@@ -866,7 +1158,7 @@ bool Highlighter::isQuoted (const QString &text, const int index)
     while ((pos = quoteExpression.indexIn (text, pos + 1)) >= 0)
     {
         /* skip formatted comments */
-        if (format (pos) == commentFormat) continue;
+        if (classAt (pos) == commentClass) continue;
 
         ++N;
         if ((N % 2 == 0 && isEscapedQuote (text, pos, false)) // an escaped end quote
@@ -933,8 +1225,8 @@ bool Highlighter::isMLCommented (const QString &text, const int index)
     while ((pos = commentExpression.indexIn (text, pos + 1)) >= 0)
     {
         /* skip formatted quotations */
-        if (format (pos) == quoteFormat
-            || format (pos) == altQuoteFormat)
+        if (classAt (pos) == quoteClass
+            || classAt (pos) == altQuoteClass)
         {
             continue;
         }
@@ -994,12 +1286,12 @@ void Highlighter::pythonMLComment (const QString &text, const int indx)
     {
         index = commentStartExpression.indexIn (text, indx);
 
-        while (format (index) == quoteFormat
-               || format (index) == altQuoteFormat)
+        while (classAt (index) == quoteClass
+               || classAt (index) == altQuoteClass)
         {
             index = commentStartExpression.indexIn (text, index + 3);
         }
-        while (format (index) == commentFormat)
+        while (classAt (index) == commentClass)
             index = commentStartExpression.indexIn (text, index + 3);
 
         /* if the comment start is found... */
@@ -1095,7 +1387,7 @@ void Highlighter::pythonMLComment (const QString &text, const int indx)
         while ((pIndex = str.indexOf (notePattern, indx)) > -1)
         {
             int ml = notePattern.matchedLength();
-            if (format (pIndex) != urlFormat)
+            if (classAt (pIndex) != urlClass)
               setFormat (pIndex + index, ml, noteFormat);
             indx = indx + ml;
         }
@@ -1103,12 +1395,12 @@ void Highlighter::pythonMLComment (const QString &text, const int indx)
         /* the next quote may be different */
         commentStartExpression = QRegExp ("\"\"\"|\'\'\'");
         index = commentStartExpression.indexIn (text, index + quoteLength);
-        while (format (index) == quoteFormat
-               || format (index) == altQuoteFormat)
+        while (classAt (index) == quoteClass
+               || classAt (index) == altQuoteClass)
         {
             index = commentStartExpression.indexIn (text, index + 3);
         }
-        while (format (index) == commentFormat)
+        while (classAt (index) == commentClass)
             index = commentStartExpression.indexIn (text, index + 3);
     }
 }
@@ -1299,8 +1591,7 @@ void Highlighter::singleLineComment (const QString &text, int start, int end, bo
             if (progLan == "html") // javascript end
                 end = QRegExp ("</script\\s*>").indexIn (text, start);
             if (end == -1) end = text.length();
-            QRegExp expression (rule.pattern);
-            start = expression.indexIn (text, start);
+            start = rule.pattern.match (text, start).capturedStart();
             if (start >= 0 && start < end
                 && (canBeQuoted || !isQuoted (text, start)))
             {
@@ -1320,7 +1611,7 @@ void Highlighter::singleLineComment (const QString &text, int start, int end, bo
                 while ((pIndex = str.indexOf (notePattern, indx)) > -1)
                 {
                     int ml = notePattern.matchedLength();
-                    if (format (pIndex) != urlFormat)
+                    if (classAt (pIndex) != urlClass)
                       setFormat (pIndex + start, ml, noteFormat);
                     indx = indx + ml;
                 }
@@ -1350,11 +1641,11 @@ void Highlighter::multiLineComment (const QString &text,
     {
         index = commentStartExp.indexIn (text, index);
         /* skip single-line comments */
-        if (format (index) == commentFormat)
+        if (classAt (index) == commentClass)
             index = -1;
         /* skip quotations (usually all formatted to this point) */
-        while (format (index) == quoteFormat
-               || format (index) == altQuoteFormat)
+        while (classAt (index) == quoteClass
+               || classAt (index) == altQuoteClass)
         {
             index = commentStartExp.indexIn (text, index + 1);
         }
@@ -1381,8 +1672,8 @@ void Highlighter::multiLineComment (const QString &text,
                                               index + commentStartExp.matchedLength());
 
         /* skip quotations */
-        while (format (endIndex) == quoteFormat
-               || format (endIndex) == altQuoteFormat)
+        while (classAt (endIndex) == quoteClass
+               || classAt (endIndex) == altQuoteClass)
         {
             endIndex = commentEndExp.indexIn (text, endIndex + 1);
         }
@@ -1395,7 +1686,7 @@ void Highlighter::multiLineComment (const QString &text,
             badIndex = endIndex + 1;
             for (int i = badIndex; i < text.length(); ++i)
             {
-                if (format (i) == commentFormat)
+                if (classAt (i) == commentClass)
                     setFormat (i, 1, neutralFormat);
             }
         }
@@ -1439,7 +1730,7 @@ void Highlighter::multiLineComment (const QString &text,
         while ((pIndex = str.indexOf (notePattern, indx)) > -1)
         {
             int ml = notePattern.matchedLength();
-            if (format (pIndex) != urlFormat)
+            if (classAt (pIndex) != urlClass)
               setFormat (pIndex + index, ml, noteFormat);
             indx = indx + ml;
         }
@@ -1453,13 +1744,12 @@ void Highlighter::multiLineComment (const QString &text,
             {
                 if (rule.format == commentFormat)
                 {
-                    QRegExp expression (rule.pattern);
-                    int INDX = expression.indexIn (text, badIndex);
-                    while (format (INDX) == quoteFormat
-                           || format (INDX) == altQuoteFormat
+                    int INDX = rule.pattern.match (text, badIndex).capturedStart();
+                    while (classAt (INDX) == quoteClass
+                           || classAt (INDX) == altQuoteClass
                            || isMLCommented (text, INDX))
                     {
-                        INDX = expression.indexIn (text, INDX + 1);
+                        INDX = rule.pattern.match (text, INDX + 1).capturedStart();
                     }
                     if (INDX >= 0)
                         setFormat (INDX, text.length() - INDX, commentFormat);
@@ -1469,10 +1759,10 @@ void Highlighter::multiLineComment (const QString &text,
         }
 
         /* skip single-line comments and quotations again */
-        if (format (index) == commentFormat)
+        if (classAt (index) == commentClass)
             index = -1;
-        while (format (index) == quoteFormat
-               || format (index) == altQuoteFormat)
+        while (classAt (index) == quoteClass
+               || classAt (index) == altQuoteClass)
         {
             index = commentStartExp.indexIn (text, index + 1);
         }
@@ -1525,7 +1815,7 @@ void Highlighter::multiLineQuote (const QString &text)
         {
             index = quoteExpression.indexIn (text, index + 1);
         }
-        while (format (index) == commentFormat) // single-line and Python
+        while (classAt (index) == commentClass) // single-line and Python
             index = quoteExpression.indexIn (text, index + 1);
 
         /* if the start quote is found... */
@@ -1643,7 +1933,7 @@ void Highlighter::multiLineQuote (const QString &text)
         {
             index = quoteExpression.indexIn (text, index + 1);
         }
-        while (format (index) == commentFormat)
+        while (classAt (index) == commentClass)
             index = quoteExpression.indexIn (text, index + 1);
     }
 }
@@ -1661,9 +1951,9 @@ void Highlighter::setFormatWithoutOverwrite (int start,
         while (index < start + count
                && (format (index) == oldFormat
                    /* skip comments and quotes */
-                   || format (index) == commentFormat
-                   || format (index) == quoteFormat
-                   || format (index) == altQuoteFormat))
+                   || classAt (index) == commentClass
+                   || classAt (index) == quoteClass
+                   || classAt (index) == altQuoteClass))
         {
             ++ index;
         }
@@ -1672,9 +1962,9 @@ void Highlighter::setFormatWithoutOverwrite (int start,
             indx = index;
             while (indx < start + count
                    && format (indx) != oldFormat
-                   && format (indx) != commentFormat
-                   && format (indx) != quoteFormat
-                   && format (indx) != altQuoteFormat)
+                   && classAt (indx) != commentClass
+                   && classAt (indx) != quoteClass
+                   && classAt (indx) != altQuoteClass)
             {
                 ++ indx;
             }
@@ -1701,7 +1991,7 @@ void Highlighter::xmlQuotes (const QString &text)
     {
         index = quoteExpression.indexIn (text);
         /* skip all comments */
-        while (format (index) == commentFormat)
+        while (classAt (index) == commentClass)
             index = quoteExpression.indexIn (text, index + 1);
         /* skip all values (that are formatted by multiLineComment()) */
         while (format (index) == neutralFormat)
@@ -1784,7 +2074,7 @@ void Highlighter::xmlQuotes (const QString &text)
         while (format (index) == neutralFormat)
             index = quoteExpression.indexIn (text, index + 1);
         /* skip all comments */
-        while (format (index) == commentFormat)
+        while (classAt (index) == commentClass)
             index = quoteExpression.indexIn (text, index + 1);
     }
 }
@@ -1880,20 +2170,396 @@ bool Highlighter::isHereDocument (const QString &text)
     return false;
 }
 /*************************/
+// The visible blocks and a page before and after them.
+bool Highlighter::isNearViewport (int blockNumber) const
+{
+    const int first = startCursor.blockNumber();
+    const int last = endCursor.blockNumber();
+    const int page = last - first + 1;
+    return blockNumber >= first - page && blockNumber <= last + page;
+}
+/*************************/
+bool Highlighter::isCaughtUp (int first, int last) const
+{
+    for (int i = 0; i < dirtyRanges_.size(); ++i)
+    {
+        if (dirtyRanges_.at (i).first.blockNumber() <= last
+            && dirtyRanges_.at (i).second.blockNumber() >= first)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+/*************************/
+void Highlighter::markDirty (const QTextBlock &block)
+{
+    /* highlightBlock() is usually called for successive blocks,
+       so that a new dirty block may just extend the last range */
+    if (!dirtyRanges_.isEmpty())
+    {
+        QTextCursor &last = dirtyRanges_.last().second;
+        const QTextBlock lastBlock = last.block();
+        if (lastBlock == block)
+            return;
+        if (lastBlock.next() == block)
+        {
+            last.setPosition (block.position());
+            startCatchingUp();
+            return;
+        }
+    }
+    QTextCursor cur (block);
+    dirtyRanges_.append (qMakePair (cur, cur));
+    startCatchingUp();
+}
+/*************************/
+void Highlighter::startCatchingUp()
+{
+    if (catchUpTimerId_ == 0 && !progLan.isEmpty())
+        catchUpTimerId_ = startTimer (0); // works when there's no other event
+}
+/*************************/
+// Highlights a block that isn't highlighted completely.
+void Highlighter::catchUp (const QTextBlock &block)
+{
+    TextBlockData *data = static_cast<TextBlockData *>(block.userData());
+    if (data && data->isHighlighted()) return;
+
+    /* if the state of the block changes, QSyntaxHighlighter goes to the next
+       block but, if that is far from the viewport, it's only marked as dirty
+       by highlightBlock() and the cascade continues in the next steps */
+    catchUpBlock_ = block.blockNumber();
+    rehighlightBlock (block);
+    catchUpBlock_ = -1;
+}
+/*************************/
+// The lexer thread is kept at most two batches ahead of the catch-up.
+static const int lexBatchBlocks = 1000; // the most blocks that are lexed at once
+
+void Highlighter::timerEvent (QTimerEvent *event)
+{
+    if (event->timerId() != catchUpTimerId_)
+    {
+        QSyntaxHighlighter::timerEvent (event);
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    const int timeSlice = 8; // ms
+    catchingUp_ = true;
+
+    /* first, the neighborhood of the viewport */
+    const int first = startCursor.blockNumber();
+    const int last = endCursor.blockNumber();
+    const int page = last - first + 1;
+    QTextBlock block = document()->findBlockByNumber (qMax (first - page, 0));
+    while (block.isValid() && block.blockNumber() <= last + page && timer.elapsed() < timeSlice)
+    {
+        catchUp (block);
+        block = block.next();
+    }
+
+    /* then, the dirty ranges in order but, with a big text, only up to the
+       neighborhood of the viewport, so that the size limit of lazy highlighting
+       bounds the work (the rest is caught up when it's scrolled to) */
+    const int limit = lazy_ ? last + page : INT_MAX;
+    int r = 0;
+    while (r < dirtyRanges_.size() && timer.elapsed() < timeSlice)
+    {
+        QTextCursor &from = dirtyRanges_[r].first;
+        if (from.blockNumber() > limit)
+        {
+            ++r;
+            continue;
+        }
+        const int end = dirtyRanges_.at (r).second.blockNumber();
+        block = from.block();
+        while (block.isValid() && block.blockNumber() <= end && block.blockNumber() <= limit
+               && timer.elapsed() < timeSlice)
+        {
+            if (lazy_ && !isLexed (block))
+            {
+                lexAhead (block);
+                if (lexWatcher_.isRunning())
+                { // wait for the lexer thread without spinning
+                    waitingForLexer_ = true;
+                    break;
+                }
+            }
+            catchUp (block);
+            block = block.next();
+        }
+        if (!block.isValid() || block.blockNumber() > end)
+            dirtyRanges_.removeAt (r);
+        else
+        {
+            from.setPosition (block.position());
+            if (waitingForLexer_) break;
+            if (block.blockNumber() > limit)
+                ++r;
+        }
+    }
+
+    catchingUp_ = false;
+    if (r >= dirtyRanges_.size() || waitingForLexer_)
+    {
+        killTimer (catchUpTimerId_);
+        catchUpTimerId_ = 0;
+        if (dirtyRanges_.isEmpty())
+        {
+            lexed_.clear(); // the results of removed blocks
+            lexCursor_ = QTextCursor();
+        }
+    }
+    else if (lazy_ && lexed_.size() < lexBatchBlocks)
+        lexAhead(); // the lookahead was consumed
+}
+/*************************/
+bool Highlighter::isLexed (const QTextBlock &block) const
+{
+    TextBlockData *data = static_cast<TextBlockData *>(block.userData());
+    return (data && data->isHighlighted()) || lexed_.contains (block.blockNumber());
+}
+/*************************/
+// Takes snapshots of the next blocks that should be caught up and lexes them in a worker thread.
+// If "from" is valid, the old lookahead is dropped and lexing is resumed from it; otherwise,
+// lexing is resumed from where the last batch ended, so that no block is checked twice.
+void Highlighter::lexAhead (const QTextBlock &from)
+{
+    if (lexWatcher_.isRunning()) return;
+    if (from.isValid())
+    {
+        lexed_.clear(); // the catch-up has left it behind
+        lexCursor_ = QTextCursor (from);
+    }
+    else if (lexCursor_.isNull() || lexed_.size() >= 2 * lexBatchBlocks)
+        return;
+    static const int maxChars = 512 * 1024;
+    const int resume = lexCursor_.blockNumber();
+    QVector<LexedBlock> blocks;
+    QTextBlock block;
+    int chars = 0;
+    for (int i = 0; i < dirtyRanges_.size() && blocks.size() < lexBatchBlocks && chars < maxChars; ++i)
+    {
+        const int end = dirtyRanges_.at (i).second.blockNumber();
+        if (end < resume) continue; // lexed before or left to the catch-up
+        block = dirtyRanges_.at (i).first.block();
+        if (block.blockNumber() < resume)
+            block = lexCursor_.block();
+        while (block.isValid() && block.blockNumber() <= end
+               && blocks.size() < lexBatchBlocks && chars < maxChars)
+        {
+            if (!isLexed (block))
+            {
+                LexedBlock b;
+                b.blockNumber = block.blockNumber();
+                b.revision = block.revision();
+                b.text = block.text();
+                chars += b.text.length();
+                blocks.append (b);
+            }
+            block = block.next();
+        }
+    }
+    if (blocks.isEmpty() || !block.isValid())
+        lexCursor_ = QTextCursor(); // nothing remains to be lexed
+    else
+        lexCursor_.setPosition (block.position());
+    if (blocks.isEmpty()) return;
+    lexWatcher_.setFuture (QtConcurrent::run (&Highlighter::lexBlocks, highlightingRules, commentFormat, blocks));
+}
+/*************************/
+// Runs in a worker thread and should only use its arguments.
+QVector<Highlighter::LexedBlock> Highlighter::lexBlocks (const QVector<HighlightingRule> &rules,
+                                                        const QTextCharFormat &commentFormat,
+                                                        QVector<LexedBlock> blocks)
+{
+    for (int i = 0; i < blocks.size(); ++i)
+    {
+        LexedBlock &b = blocks[i];
+        findWords (b.text, b.words);
+        for (int r = 0; r < rules.size(); ++r)
+        {
+            b.ruleStart.append (b.ranges.size());
+            const HighlightingRule &rule = rules.at (r);
+            if (rule.format == commentFormat || !rule.keywords.isEmpty())
+                continue;
+            QRegularExpressionMatchIterator it = rule.pattern.globalMatch (b.text);
+            while (it.hasNext())
+            {
+                const QRegularExpressionMatch match = it.next();
+                WordPos range;
+                range.start = match.capturedStart();
+                range.length = match.capturedLength();
+                b.ranges.append (range);
+            }
+        }
+        b.ruleStart.append (b.ranges.size());
+    }
+    return blocks;
+}
+/*************************/
+void Highlighter::onLexed()
+{
+    const QVector<LexedBlock> blocks = lexWatcher_.result();
+    foreach (const LexedBlock &b, blocks)
+        lexed_.insert (b.blockNumber, b);
+    if (waitingForLexer_)
+    {
+        waitingForLexer_ = false;
+        startCatchingUp();
+    }
+    if (lexed_.size() < 2 * lexBatchBlocks)
+        lexAhead(); // the next blocks are lexed while these ones are applied
+}
+/*************************/
+// Adds the time of its scope to a profile entry when profiling is enabled.
+class Highlighter::ProfileScope
+{
+public:
+    ProfileScope (QHash<QString, ProfileEntry> *profile, const char *name) :
+        profile_ (profile),
+        latin1Name_ (name),
+        matches_ (0)
+    {
+        if (profile_)
+            timer_.start();
+    }
+    /* the name is made only when profiling */
+    ProfileScope (QHash<QString, ProfileEntry> *profile, const HighlightingRule &rule, int index) :
+        profile_ (profile),
+        latin1Name_ (nullptr),
+        matches_ (0)
+    {
+        if (!profile_) return;
+        if (!rule.keywords.isEmpty())
+            name_ = QString ("rule %1: %2 keywords").arg (index).arg (rule.keywords.size());
+        else
+        {
+            name_ = rule.pattern.pattern();
+            if (name_.length() > 60)
+                name_ = name_.left (57) + "...";
+            name_ = QString ("rule %1: %2").arg (index).arg (name_);
+        }
+        timer_.start();
+    }
+    ~ProfileScope() {
+        if (profile_)
+        {
+            ProfileEntry &entry = (*profile_)[latin1Name_ ? QString (QLatin1String (latin1Name_)) : name_];
+            entry.nsecs += timer_.nsecsElapsed();
+            entry.matches += matches_;
+            ++ entry.calls;
+        }
+    }
+    void addMatch() {
+        ++ matches_;
+    }
+
+private:
+    QHash<QString, ProfileEntry> *profile_;
+    const char *latin1Name_;
+    QString name_;
+    qint64 matches_;
+    QElapsedTimer timer_;
+};
+/*************************/
+void Highlighter::dumpProfile() const
+{
+    if (!profile_ || profile_->isEmpty()) return;
+    QList<QPair<qint64, QString> > order;
+    for (QHash<QString, ProfileEntry>::const_iterator it = profile_->constBegin(); it != profile_->constEnd(); ++it)
+        order.append (qMakePair (it.value().nsecs, it.key()));
+    std::sort (order.begin(), order.end());
+
+    qDebug ("Highlighting profile (%s, %d blocks):", progLan.toLatin1().constData(),
+            document() ? document()->blockCount() : 0);
+    qDebug ("%12s %10s %10s %10s  %s", "total (ms)", "calls", "matches", "us/call", "rule or pass");
+    for (int i = order.size() - 1; i >= 0; --i)
+    {
+        const ProfileEntry &entry = profile_->value (order.at (i).second);
+        qDebug ("%12.2f %10lld %10lld %10.2f  %s",
+                static_cast<double>(entry.nsecs) / 1000000,
+                entry.calls, entry.matches,
+                entry.calls > 0 ? static_cast<double>(entry.nsecs) / 1000 / entry.calls : 0.0,
+                order.at (i).second.toUtf8().constData());
+    }
+}
+/*************************/
+void Highlighter::setFormat (int start, int count, const QTextCharFormat &format)
+{
+    QSyntaxHighlighter::setFormat (start, count, format);
+    if (start < 0 || start >= classes_.size()) return;
+    count = qMin (count, classes_.size() - start);
+    if (count <= 0) return;
+    char c = codeClass;
+    if (format == commentFormat)
+        c = commentClass;
+    else if (format == quoteFormat)
+        c = quoteClass;
+    else if (format == altQuoteFormat)
+        c = altQuoteClass;
+    else if (format == urlFormat)
+        c = urlClass;
+    memset (classes_.data() + start, c, static_cast<size_t>(count));
+}
+/*************************/
 // Start syntax highlighting!
 void Highlighter::highlightBlock (const QString &text)
 {
     if (progLan.isEmpty()) return;
+    ProfileScope profileTotal (profile_, "highlightBlock (total)");
+
+    classes_.fill (codeClass, text.length());
 
     bool rehighlightNextBlock = false;
     int prevOpenNests = 0; // to be used in SH_CmndSubstVar()
-    if (TextBlockData *prevData = static_cast<TextBlockData *>(currentBlockUserData()))
-        prevOpenNests = prevData->openNests();
+    TextBlockData *data = static_cast<TextBlockData *>(currentBlockUserData());
+
+    /* Blocks far from the viewport aren't highlighted in rehighlighting cascades
+       but are left to the catch-up worker, which highlights them one by one, so
+       that a cascade stops as soon as the state of a block doesn't change. With
+       a big text, this is also the case when a block is highlighted for the first
+       time (the block inherits the state of its previous block until then). */
+    int bn = currentBlock().blockNumber();
+    if (!isNearViewport (bn)
+        && (catchingUp_ ? bn != catchUpBlock_ : (lazy_ || data != nullptr)))
+    {
+        if (data)
+        { // the old state, nests and delimiter are kept until the block is caught up
+            data->insertHighlightInfo (false);
+            /* but not the brackets, which may not exist anymore */
+            if (!data->brackets().isEmpty())
+            {
+                data->clearBrackets();
+                bracketIndex_.update (currentBlock());
+            }
+        }
+        else
+        {
+            data = new TextBlockData;
+            setCurrentBlockUserData (data);
+            setCurrentBlockState (previousBlockState());
+        }
+        markDirty (currentBlock());
+        return;
+    }
+
+    if (data)
+    { // reuse the old data
+        prevOpenNests = data->openNests();
+        data->reset(); // not highlighted yet
+    }
+    else
+    {
+        data = new TextBlockData;
+        setCurrentBlockUserData (data); // to be fed in later
+    }
 
     int index;
-    TextBlockData *data = new TextBlockData;
-    data->insertHighlightInfo (false); // not highlighted yet
-    setCurrentBlockUserData (data); // to be fed in later
+
     setCurrentBlockState (0);
 
     /********************
@@ -1903,9 +2569,15 @@ void Highlighter::highlightBlock (const QString &text)
     if (progLan == "sh" || progLan == "makefile" || progLan == "cmake"
         || progLan == "perl" || progLan == "ruby")
     {
-        if (isHereDocument (text))
+        bool hereDoc;
+        {
+            ProfileScope p (profile_, "isHereDocument");
+            hereDoc = isHereDocument (text);
+        }
+        if (hereDoc)
         {
             data->insertHighlightInfo (true); // completely highlighted
+            bracketIndex_.update (currentBlock()); // its brackets are reset
             return;
         }
     }
@@ -1915,17 +2587,26 @@ void Highlighter::highlightBlock (const QString &text)
      ************************/
 
     if (progLan != "html")
+    {
+        ProfileScope p (profile_, "singleLineComment");
         singleLineComment (text, 0);
+    }
 
     /* this is only for setting the format of
        command substitution variables in bash */
-    rehighlightNextBlock = SH_CmndSubstVar (text, data, prevOpenNests);
+    {
+        ProfileScope p (profile_, "SH_CmndSubstVar");
+        rehighlightNextBlock = SH_CmndSubstVar (text, data, prevOpenNests);
+    }
 
     /*******************
      * Python Comments *
      *******************/
 
-    pythonMLComment (text, 0);
+    {
+        ProfileScope p (profile_, "pythonMLComment");
+        pythonMLComment (text, 0);
+    }
 
     /*******************************
      * XML Quotations and Comments *
@@ -1933,6 +2614,7 @@ void Highlighter::highlightBlock (const QString &text)
 
     if (progLan == "xml")
     {
+        ProfileScope p (profile_, "xml values and quotes");
         /* value is handled as a kind of comment */
         multiLineComment (text, 0, -1, QRegExp (">"), QRegExp ("<"), xmlValueState, neutralFormat);
         /* multiline quotes as signs of errors in the xml doc */
@@ -1942,12 +2624,16 @@ void Highlighter::highlightBlock (const QString &text)
      * (Multiline) Quotations *
      **************************/
     else if (progLan == "sh") // bash has its own method
+    {
+        ProfileScope p (profile_, "SH_MultiLineQuote");
         SH_MultiLineQuote (text);
+    }
     else if (progLan != "diff" && progLan != "log"
              && progLan != "desktop" && progLan != "theme"
              && progLan != "changelog" && progLan != "url"
              && progLan != "srt" && progLan != "html")
     {
+        ProfileScope p (profile_, "multiLineQuote");
         multiLineQuote (text);
     }
 
@@ -1956,14 +2642,21 @@ void Highlighter::highlightBlock (const QString &text)
      *******/
 
     /* helps seeing if a comment destroys a css block */
-    int cssIndx = cssHighlighter (text);
+    int cssIndx;
+    {
+        ProfileScope p (profile_, "cssHighlighter");
+        cssIndx = cssHighlighter (text);
+    }
 
     /**********************
      * Multiline Comments *
      **********************/
 
     if (!commentStartExpression.isEmpty() && progLan != "python")
+    {
+        ProfileScope p (profile_, "multiLineComment");
         multiLineComment (text, 0, cssIndx, commentStartExpression, commentEndExpression, commentState, commentFormat);
+    }
 
     /**************
      * Exceptions *
@@ -1971,6 +2664,7 @@ void Highlighter::highlightBlock (const QString &text)
 
     if (progLan == "markdown")
     {
+        ProfileScope p (profile_, "markdown blocks");
         /* the block quote of markdown is like a multiline comment
            but shouldn't be formatted inside a real comment */
         if (previousBlockState() != commentState && blockQuoteFormat.isValid())
@@ -1985,12 +2679,20 @@ void Highlighter::highlightBlock (const QString &text)
      * HTML Only *
      *************/
 
-    int bn = currentBlock().blockNumber();
     if (progLan == "html")
     {
-        htmlBrackets (text);
-        htmlStyleHighlighter (text);
-        htmlJavascript (text);
+        {
+            ProfileScope p (profile_, "htmlBrackets");
+            htmlBrackets (text);
+        }
+        {
+            ProfileScope p (profile_, "htmlStyleHighlighter");
+            htmlStyleHighlighter (text);
+        }
+        {
+            ProfileScope p (profile_, "htmlJavascript");
+            htmlJavascript (text);
+        }
         /* go to braces matching */
         data->insertHighlightInfo (true); // completely highlighted
     }
@@ -2000,43 +2702,97 @@ void Highlighter::highlightBlock (const QString &text)
      *******************/
 
     // we format html embedded javascript in htmlJavascript()
-    else if (bn >= startCursor.blockNumber() && bn <= endCursor.blockNumber())
+    else if (catchingUp_ || (bn >= startCursor.blockNumber() && bn <= endCursor.blockNumber()))
     {
         data->insertHighlightInfo (true); // completely highlighted
-        foreach (const HighlightingRule &rule, highlightingRules)
+        /* the matches may have been found by the lexer thread */
+        LexedBlock lexed;
+        bool useLexed = false;
+        if (!lexed_.isEmpty())
         {
+            QHash<int, LexedBlock>::iterator it = lexed_.find (bn);
+            if (it != lexed_.end())
+            {
+                if (it.value().revision == currentBlock().revision() && it.value().text == text)
+                {
+                    lexed = it.value();
+                    useLexed = true;
+                }
+                lexed_.erase (it);
+            }
+        }
+        QVector<WordPos> words;
+        bool wordsFound = false;
+        if (useLexed)
+        {
+            words = lexed.words;
+            wordsFound = true;
+        }
+        for (int r = 0; r < highlightingRules.size(); ++r)
+        {
+            const HighlightingRule &rule = highlightingRules.at (r);
             /* single-line comments are already formatted */
             if (rule.format == commentFormat)
                 continue;
+            ProfileScope profileRule (profile_, rule, r);
 
-            QRegExp expression (rule.pattern);
-            index = expression.indexIn (text);
-            /* skip quotes and all comments */
-            while (format (index) == quoteFormat
-                   || format (index) == altQuoteFormat
-                   || format (index) == commentFormat
-                   || format (index) == urlFormat)
-            {
-                index = expression.indexIn (text, index + 1);
+            if (!rule.keywords.isEmpty())
+            { // the words are found only once
+                if (!wordsFound)
+                {
+                    findWords (text, words);
+                    wordsFound = true;
+                }
+                formatKeywords (text, rule, words, 0, text.length());
+                continue;
             }
 
-            while (index >= 0)
+            bool skipUrls = true; // urls are skipped only before the first match is formatted
+            int from = 0;
+            if (useLexed)
+            { // the matches are the same as below until one of them is skipped
+                bool skipped = false;
+                for (int m = lexed.ruleStart.at (r); m < lexed.ruleStart.at (r + 1); ++m)
+                {
+                    index = lexed.ranges.at (m).start;
+                    const char cl = classAt (index);
+                    if (cl == quoteClass || cl == altQuoteClass || cl == commentClass
+                        || (skipUrls && cl == urlClass))
+                    {
+                        from = index + 1;
+                        skipped = true;
+                        break;
+                    }
+                    skipUrls = false;
+                    int l = lexed.ranges.at (m).length;
+                    while (classAt (index + l - 1) == commentClass)
+                        -- l;
+                    setFormat (index, l, rule.format);
+                    profileRule.addMatch();
+                }
+                if (!skipped) continue;
+            }
+            QRegularExpressionMatchIterator it = rule.pattern.globalMatch (text, from);
+            while (it.hasNext())
             {
-                int length = expression.matchedLength();
-                int l = length;
+                const QRegularExpressionMatch match = it.next();
+                index = match.capturedStart();
+                /* skip quotes and all comments by searching again from the next position */
+                const char cl = classAt (index);
+                if (cl == quoteClass || cl == altQuoteClass || cl == commentClass
+                    || (skipUrls && cl == urlClass))
+                {
+                    it = rule.pattern.globalMatch (text, index + 1);
+                    continue;
+                }
+                skipUrls = false;
+                int l = match.capturedLength();
                 /* in c/c++, the neutral pattern after "#define" may contain
                    a (double-)slash but it's harmless to do this always: */
-                while (format (index + l - 1) == commentFormat)
+                while (classAt (index + l - 1) == commentClass)
                     -- l;
                 setFormat (index, l, rule.format);
-                index = expression.indexIn (text, index + length);
-
-                while (format (index) == quoteFormat
-                       || format (index) == altQuoteFormat
-                       || format (index) == commentFormat)
-                {
-                    index = expression.indexIn (text, index + 1);
-                }
+                profileRule.addMatch();
             }
         }
     }
@@ -2045,101 +2801,38 @@ void Highlighter::highlightBlock (const QString &text)
      * Parentheses and Braces Matching *
      ***********************************/
 
-    /* left parenthesis */
-    index = text.indexOf ('(');
-    while (format (index) == quoteFormat || format (index) == altQuoteFormat
-           || format (index) == commentFormat)
+    /* all of them in one pass and in order of position */
+    const int l = text.length();
+    for (index = 0; index < l; ++index)
     {
-        index = text.indexOf ('(', index + 1);
-    }
-    while (index != -1)
-    {
-        ParenthesisInfo *info = new ParenthesisInfo;
-        info->character = '(';
-        info->position = index;
-        data->insertInfo (info);
-
-        index = text.indexOf ('(', index + 1);
-        while (format (index) == quoteFormat || format (index) == altQuoteFormat
-               || format (index) == commentFormat)
+        const ushort c = text.at (index).unicode();
+        if ((c == '(' || c == ')' || c == '{' || c == '}' || c == '[' || c == ']')
+            && classAt (index) != quoteClass && classAt (index) != altQuoteClass
+            && classAt (index) != commentClass)
         {
-            index = text.indexOf ('(', index + 1);
-        }
-    }
-
-    /* right parenthesis */
-    index = text.indexOf (')');
-    while (format (index) == quoteFormat || format (index) == altQuoteFormat
-           || format (index) == commentFormat)
-    {
-        index = text.indexOf (')', index + 1);
-    }
-    while (index != -1)
-    {
-        ParenthesisInfo *info = new ParenthesisInfo;
-        info->character = ')';
-        info->position = index;
-        data->insertInfo (info);
-
-        index = text.indexOf (')', index +1);
-        while (format (index) == quoteFormat || format (index) == altQuoteFormat
-               || format (index) == commentFormat)
-        {
-            index = text.indexOf (')', index + 1);
-        }
-    }
-
-    /* left brace */
-    index = text.indexOf ('{');
-    while (format (index) == quoteFormat || format (index) == altQuoteFormat
-           || format (index) == commentFormat)
-    {
-        index = text.indexOf ('{', index + 1);
-    }
-    while (index != -1)
-    {
-        BraceInfo *info = new BraceInfo;
-        info->character = '{';
-        info->position = index;
-        data->insertInfo (info);
-
-        index = text.indexOf ('{', index + 1);
-        while (format (index) == quoteFormat || format (index) == altQuoteFormat
-               || format (index) == commentFormat)
-        {
-            index = text.indexOf ('{', index + 1);
-        }
-    }
-
-    /* right brace */
-    index = text.indexOf ('}');
-    while (format (index) == quoteFormat || format (index) == altQuoteFormat
-           || format (index) == commentFormat)
-    {
-        index = text.indexOf ('}', index + 1);
-    }
-    while (index != -1)
-    {
-        BraceInfo *info = new BraceInfo;
-        info->character = '}';
-        info->position = index;
-        data->insertInfo (info);
-
-        index = text.indexOf ('}', index +1);
-        while (format (index) == quoteFormat || format (index) == altQuoteFormat
-               || format (index) == commentFormat)
-        {
-            index = text.indexOf ('}', index + 1);
+            data->insertInfo (static_cast<char>(c), index);
         }
     }
 
     setCurrentBlockUserData (data);
+    bracketIndex_.update (currentBlock());
+    if (!data->isHighlighted())
+        markDirty (currentBlock());
 
     if (rehighlightNextBlock)
     {
         QTextBlock block = currentBlock().next();
         if (block.isValid())
-            QMetaObject::invokeMethod (this, "rehighlightBlock", Qt::QueuedConnection, Q_ARG (QTextBlock, block));
+        {
+            if (isNearViewport (block.blockNumber()))
+                QMetaObject::invokeMethod (this, "rehighlightBlock", Qt::QueuedConnection, Q_ARG (QTextBlock, block));
+            else
+            { // leave it to the catch-up worker
+                if (TextBlockData *nextData = static_cast<TextBlockData *>(block.userData()))
+                    nextData->insertHighlightInfo (false);
+                markDirty (block);
+            }
+        }
     }
 }
 
@@ -19,66 +19,136 @@
 #define HIGHLIGHTER_H
 
 #include <QSyntaxHighlighter>
+#include <QHash>
+#include <QSet>
+#include <QRegularExpression>
+#include <QVarLengthArray>
+#include <QFutureWatcher>
+#include "bracketindex.h"
 
 namespace FeatherPad {
 
-struct ParenthesisInfo
+/* A parenthesis, brace or square bracket of a block. */
+struct BracketInfo
 {
-    char character; // '(' or ')'
     int position;
+    char character; // '(', ')', '{', '}', '[' or ']'
 };
 
-struct BraceInfo
-{
-    char character; // '{' or '}'
-    int position;
-};
+/* This class is for detection of matching parentheses, braces
+   and square brackets, and also for highlighting of here-documents.
 
-/* This class is for detection of matching parentheses and
-   braces, and also for highlighting of here-documents. */
+   Since there is one object per block, it's kept small: the brackets
+   are stored by value, in order of position, and the first few of them
+   don't need any allocation. The objects come from a pool and are reused
+   by the highlighter when their blocks are rehighlighted. */
 class TextBlockData : public QTextBlockUserData
 {
 public:
+    typedef QVarLengthArray<BracketInfo, 4> Brackets;
+
     TextBlockData() { Highlighted = false; OpenNests = 0; }
-    ~TextBlockData();
-    QVector<ParenthesisInfo *> parentheses();
-    QVector<BraceInfo *> braces();
-    QString delimiter();
-    bool isHighlighted();
-    int openNests();
-    void insertInfo (ParenthesisInfo *info);
-    void insertInfo (BraceInfo *info);
-    void insertInfo (QString str);
-    void insertHighlightInfo (bool highlighted);
-    void insertNestInfo (int nests);
+    ~TextBlockData() {}
+
+    static void *operator new (size_t size);
+    static void operator delete (void *p, size_t size);
+
+    const Brackets &brackets() const {
+        return allBrackets;
+    }
+    QString delimiter() const {
+        return Delimiter;
+    }
+    bool isHighlighted() const {
+        return Highlighted;
+    }
+    int openNests() const {
+        return OpenNests;
+    }
+    /* brackets should be inserted in order of position */
+    void insertInfo (char character, int position) {
+        BracketInfo info;
+        info.position = position;
+        info.character = character;
+        allBrackets.append (info);
+    }
+    void insertInfo (const QString &str) {
+        Delimiter = str;
+    }
+    void insertHighlightInfo (bool highlighted) {
+        Highlighted = highlighted;
+    }
+    void insertNestInfo (int nests) {
+        OpenNests = nests;
+    }
+    void clearBrackets() {
+        allBrackets.clear();
+    }
+    /* clears the data for reuse (the bracket storage is kept) */
+    void reset() {
+        allBrackets.clear();
+        Delimiter.clear();
+        Highlighted = false;
+        OpenNests = 0;
+    }
 
 private:
-    QVector<ParenthesisInfo *> allParentheses;
-    QVector<BraceInfo *> allBraces;
-    QString Delimiter; // The delimiter string of a here-doc.
-    bool Highlighted; // Is this block completely highlighted?
+    Brackets allBrackets;
+    QString Delimiter; // The delimiter string of a here-doc (null and without allocation if there's none).
     /* "Nest" is a generalized bracket. This variable
        is the number of unclosed nests in a block. */
     int OpenNests;
+    bool Highlighted; // Is this block completely highlighted?
 };
 /*************************/
 /* This is a tricky but effective way for syntax highlighting. */
 class Highlighter : public QSyntaxHighlighter
 {
     Q_OBJECT
+    friend class TestHighlighter; // the benchmarks use the rules
 
 public:
-    Highlighter (QTextDocument *parent, QString lang, QTextCursor start, QTextCursor end, bool darkColorScheme);
+    Highlighter (QTextDocument *parent, QString lang, QTextCursor start, QTextCursor end, bool darkColorScheme,
+                 bool lazy = false);
+    ~Highlighter();
 
     void setLimit (QTextCursor start, QTextCursor end) {
         startCursor = start;
         endCursor = end;
+        startCatchingUp(); // the new neighborhood of the viewport should be highlighted first
     }
 
+    BracketIndex &bracketIndex() {
+        return bracketIndex_;
+    }
+    /* Are the blocks from "first" to "last" highlighted (with their brackets)? */
+    bool isCaughtUp (int first, int last) const;
+
 protected:
     void highlightBlock (const QString &text);
+    void timerEvent (QTimerEvent *event);
 
 private:
+    /* Lexical classes: */
+    enum
+    {
+        codeClass = 0,
+        commentClass,
+        quoteClass,
+        altQuoteClass,
+        urlClass
+    };
+    /* The lexical class of a position in the current block (for out-of-range positions, it's codeClass). */
+    char classAt (int pos) const {
+        return pos >= 0 && pos < classes_.size() ? classes_.at (pos) : static_cast<char>(codeClass);
+    }
+    /* also updates the lexical classes */
+    void setFormat (int start, int count, const QTextCharFormat &format);
+
+    bool isNearViewport (int blockNumber) const;
+    void markDirty (const QTextBlock &block);
+    void startCatchingUp();
+    void catchUp (const QTextBlock &block);
     QStringList keywords (QString& lang);
     QStringList types();
     bool isEscapedQuote (const QString &text, const int pos, bool isStartQuote);
@@ -116,11 +186,63 @@ private:
 
     struct HighlightingRule
     {
-        QRegExp pattern;
+        QRegularExpression pattern; // compiled once, when the rules are made
         QTextCharFormat format;
+        /* A simple "\\b(word1|word2|...)\\b" pattern is replaced by a hash of its
+           words, so that the words of a block are found once and looked up. */
+        QSet<QString> keywords;
+        QString notFollowedBy; // the characters that can't come after a keyword
     };
     QVector<HighlightingRule> highlightingRules;
 
+    struct WordPos
+    {
+        int start;
+        int length;
+    };
+    void makeKeywordRules();
+    void compileRules();
+    static void findWords (const QString &text, QVector<WordPos> &words);
+    void formatKeywords (const QString &text, const HighlightingRule &rule,
+                         const QVector<WordPos> &words, int start, int end);
+
+    /* With a big text, the rule matches of the blocks that should be caught up
+       are found by a worker thread on snapshots of their texts, in the order of
+       the catch-up, so that the GUI thread only applies the formats. A result is
+       used only if the block's revision and text haven't changed meanwhile. */
+    struct LexedBlock
+    {
+        LexedBlock() : blockNumber (-1), revision (-1) {}
+        int blockNumber;
+        int revision;
+        QString text;
+        QVector<WordPos> words;
+        /* the matches of the i-th rule are from ranges[ruleStart[i]] to ranges[ruleStart[i+1]-1] */
+        QVector<int> ruleStart;
+        QVector<WordPos> ranges;
+    };
+    static QVector<LexedBlock> lexBlocks (const QVector<HighlightingRule> &rules,
+                                          const QTextCharFormat &commentFormat,
+                                          QVector<LexedBlock> blocks);
+    bool isLexed (const QTextBlock &block) const;
+    void lexAhead (const QTextBlock &from = QTextBlock());
+    void onLexed();
+
+    /* The rules, formats and colors of a language and color scheme. They are made only
+       once and shared by all highlighters (QVector and QTextCharFormat are implicitly
+       shared and copies of a QRegExp or QRegularExpression share its compiled engine). */
+    struct RuleSet
+    {
+        QVector<HighlightingRule> highlightingRules;
+        QRegExp commentStartExpression, commentEndExpression, quoteMark;
+        QTextCharFormat commentFormat, quoteFormat, altQuoteFormat, urlFormat,
+                        blockQuoteFormat, codeBlockFormat, neutralFormat;
+        QColor Blue, DarkBlue, Red, DarkRed, DarkGreen, DarkGreenAlt, DarkMagenta, Violet, Brown, DarkYellow;
+    };
+    static QHash<QString, RuleSet>& ruleCache();
+    bool restoreRules (const QString &key);
+    void cacheRules (const QString &key);
+
     /* Multiline comments: */
     QRegExp commentStartExpression;
     QRegExp commentEndExpression;
@@ -137,12 +259,53 @@ private:
     /* Programming language: */
     QString progLan;
 
+    /* The lexical classes of the characters of the current block. Whether a position is
+       quoted or commented is found here, instead of by comparing text formats. */
+    QByteArray classes_;
+
     QRegExp quoteMark;
     QColor Blue, DarkBlue, Red, DarkRed, DarkGreen, DarkGreenAlt, DarkMagenta, Violet, Brown, DarkYellow;
 
     /* The start and end cursors of the visible text: */
     QTextCursor startCursor, endCursor;
 
+    BracketIndex bracketIndex_;
+
+    /* Blocks outside the visible text aren't highlighted completely at first.
+       They are highlighted later, in small time slices, by a catch-up worker
+       that begins with the neighborhood of the viewport. */
+    QList<QPair<QTextCursor, QTextCursor> > dirtyRanges_; // the cursors follow the edits
+    int catchUpTimerId_;
+    bool catchingUp_; // Is the worker highlighting?
+    int catchUpBlock_; // the number of the block that the worker is highlighting (or -1)
+    /* With a big text, only the neighborhood of the viewport is highlighted at
+       first, even for multiline comments and quotes, and other blocks inherit
+       the state of their previous blocks until the worker reaches them. */
+    bool lazy_;
+    QHash<int, LexedBlock> lexed_; // by block number (at most two batches ahead)
+    QTextCursor lexCursor_; // where the lookahead resumes (null if it shouldn't)
+    QFutureWatcher<QVector<LexedBlock> > lexWatcher_;
+    bool waitingForLexer_; // Is the catch-up worker waiting for the lexer thread?
+    /* Is there nothing left to catch up or lex? (for the tests) */
+    bool isIdle() const {
+        return catchUpTimerId_ == 0 && !waitingForLexer_
+               && !lexWatcher_.isRunning() && dirtyRanges_.isEmpty();
+    }
+
+    /* If the environment variable FEATHERPAD_PROFILE_HIGHLIGHTER is set, the time spent
+       in each rule and pass and the number of matches of each rule are accumulated for
+       the document, and are printed as a sorted table when the highlighter is deleted. */
+    struct ProfileEntry
+    {
+        ProfileEntry() : nsecs (0), calls (0), matches (0) {}
+        qint64 nsecs;
+        qint64 calls;
+        qint64 matches;
+    };
+    class ProfileScope;
+    QHash<QString, ProfileEntry> *profile_; // null if there's no profiling
+    void dumpProfile() const;
+
     /* Block states: */
     enum
     {
@@ -0,0 +1,333 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014 <tsujan2000@gmail.com>
+ *
+ * FeatherPad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FeatherPad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "largefile.h"
+#include "encoding.h"
+#include <QFile>
+#include <QTextCodec>
+#include <cstring>
+#include <fcntl.h> // open
+#include <unistd.h> // close
+#include <sys/stat.h> // fstat
+#include <sys/mman.h> // mmap, munmap
+
+namespace FeatherPad {
+
+static const qint64 searchLines = 65536; // the number of lines that are decoded at once for searching
+
+LargeFile::LargeFile (const QString& fileName, const QString& charset) :
+    data_ (nullptr),
+    size_ (0),
+    codec_ (nullptr),
+    charset_ (charset),
+    lineCount_ (0)
+{
+    int fd = open (QFile::encodeName (fileName).constData(), O_RDONLY);
+    if (fd == -1) return;
+    struct stat st;
+    if (fstat (fd, &st) == 0 && st.st_size > 0)
+    {
+        void *p = mmap (nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED)
+        {
+            data_ = static_cast<const char*>(p);
+            size_ = st.st_size;
+        }
+    }
+    close (fd);
+    if (data_ == nullptr) return;
+
+    /* lines are found by their newline bytes, so UTF-16 and UTF-32 aren't supported */
+    if (charset_.isEmpty())
+    {
+        const unsigned char *C = reinterpret_cast<const unsigned char*>(data_);
+        if (size_ >= 4 && memchr (C, '\0', 4) != nullptr)
+        {
+            if ((C[0] == 0xFF && C[1] == 0xFE && C[2] != '\0' && C[3] == '\0') // UTF-16
+                || (C[0] == 0xFE && C[1] == 0xFF && C[2] == '\0' && C[3] != '\0')
+                || (C[0] != '\0' && C[1] == '\0' && C[2] != '\0' && C[3] == '\0')
+                || (C[0] == '\0' && C[1] != '\0' && C[2] == '\0' && C[3] != '\0')
+                || (C[0] != '\0' && C[1] != '\0' && C[2] == '\0' && C[3] == '\0') // UTF-32
+                || (C[0] == '\0' && C[1] == '\0' && C[2] != '\0' && C[3] != '\0'))
+            {
+                return;
+            }
+        }
+        /* guess the encoding from the complete lines of the first MiB */
+        int headSize = static_cast<int>(qMin (size_, static_cast<qint64>(1024*1024)));
+        if (memchr (data_, '\0', static_cast<size_t>(headSize)) != nullptr)
+            charset_ = "UTF-8"; // always open non-text files as UTF-8
+        else
+        {
+            QByteArray head = QByteArray::fromRawData (data_, headSize);
+            int indx = head.lastIndexOf ('\n');
+            if (indx > 0 && headSize < size_)
+                head = QByteArray::fromRawData (data_, indx);
+            charset_ = detectCharset (head);
+        }
+    }
+    else if (charset_.startsWith ("UTF-16") || charset_.startsWith ("UTF-32"))
+        return;
+
+    codec_ = QTextCodec::codecForName (charset_.toUtf8());
+    if (!codec_) // prevent any chance of crash if there's a bug
+    {
+        charset_ = "UTF-8";
+        codec_ = QTextCodec::codecForName ("UTF-8");
+    }
+
+    buildIndex();
+}
+/*************************/
+LargeFile::~LargeFile()
+{
+    if (data_)
+        munmap (const_cast<char*>(data_), static_cast<size_t>(size_));
+}
+/*************************/
+void LargeFile::buildIndex()
+{
+    index_.append (0);
+    qint64 line = 0;
+    const char *p = data_;
+    const char *end = data_ + size_;
+    while (const char *nl = static_cast<const char*>(memchr (p, '\n', static_cast<size_t>(end - p))))
+    {
+        p = nl + 1;
+        ++ line;
+        if (line % indexStep == 0)
+            index_.append (p - data_);
+    }
+    lineCount_ = line + 1; // like the block count of a text document
+}
+/*************************/
+// The offset of the start of a line. For the (nonexistent) line after
+// the last one, it is the file size plus one (as if there were a newline).
+qint64 LargeFile::lineOffset (qint64 line) const
+{
+    if (line >= lineCount_)
+        return size_ + 1;
+    if (line <= 0)
+        return 0;
+    qint64 offset = index_.at (static_cast<int>(line / indexStep));
+    for (qint64 i = line - line % indexStep; i < line; ++i)
+    {
+        const char *nl = static_cast<const char*>(memchr (data_ + offset, '\n',
+                                                          static_cast<size_t>(size_ - offset)));
+        if (nl == nullptr) return size_ + 1; // impossible
+        offset = nl - data_ + 1;
+    }
+    return offset;
+}
+/*************************/
+QString LargeFile::text (qint64 first, qint64 count) const
+{
+    if (!isValid() || first < 0 || first >= lineCount_ || count <= 0)
+        return QString();
+    qint64 from = lineOffset (first);
+    const qint64 to = lineOffset (qMin (first + count, lineCount_)) - 1; // without the last newline
+    if (to - from <= maxLineBytes) // no line can be too long
+        return codec_->toUnicode (data_ + from, static_cast<int>(to - from));
+
+    /* the lines are decoded in runs, which end before the lines that should be cut */
+    QString res;
+    qint64 runStart = from;
+    qint64 pos = from;
+    qint64 used = 0; // the bytes of the shown text
+    while (true)
+    {
+        const char *nl = static_cast<const char*>(memchr (data_ + pos, '\n', static_cast<size_t>(to - pos)));
+        const qint64 lineEnd = nl ? nl - data_ : to;
+        const qint64 cut = lineEnd - pos > maxLineBytes ? boundary (pos + maxLineBytes) : lineEnd;
+        if (pos > from && used + (cut - pos) > maxTextBytes)
+        { // no room for this line
+            if (runStart < pos)
+                res += codec_->toUnicode (data_ + runStart, static_cast<int>(pos - 1 - runStart));
+            else
+                res.chop (1); // the newline after a cut line
+            break;
+        }
+        used += cut - pos + 1;
+        if (cut < lineEnd || nl == nullptr)
+        {
+            res += codec_->toUnicode (data_ + runStart, static_cast<int>(cut - runStart));
+            if (nl == nullptr) break;
+            res += QLatin1Char ('\n');
+            runStart = lineEnd + 1;
+        }
+        pos = lineEnd + 1;
+    }
+    return res;
+}
+/*************************/
+// The first line of the longest range of lines that ends with "last"
+// and has at most "maxLines" lines and "maxBytes" bytes (or one line).
+qint64 LargeFile::firstLine (qint64 last, qint64 maxLines, qint64 maxBytes) const
+{
+    const qint64 end = lineOffset (last + 1);
+    qint64 lo = qMax (static_cast<qint64>(0), last - maxLines + 1);
+    qint64 hi = last;
+    while (lo < hi)
+    {
+        const qint64 mid = lo + (hi - lo) / 2;
+        if (end - lineOffset (mid) <= maxBytes)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    return lo;
+}
+/*************************/
+qint64 LargeFile::pageStart (qint64 line) const
+{
+    line = qBound (static_cast<qint64>(0), line, lineCount_ - 1);
+    return firstLine (line, windowLines / 2, maxTextBytes / 2);
+}
+/*************************/
+qint64 LargeFile::boundary (qint64 pos) const
+{
+    if (pos <= 0) return 0;
+    if (pos >= size_) return size_;
+    const unsigned char *C = reinterpret_cast<const unsigned char*>(data_);
+    if (charset_ == "UTF-8")
+    { // skip continuation bytes
+        qint64 p = pos;
+        while (p > pos - 3 && p > 0 && (C[p] & 0xC0) == 0x80)
+            --p;
+        return p;
+    }
+    /* in the supported multi-byte charsets, a byte below '0' is always a character */
+    for (qint64 p = pos; p > pos - 8 && p > 0; --p)
+    {
+        if (C[p - 1] < 0x30)
+            return p;
+    }
+    return pos; // a single-byte charset
+}
+/*************************/
+qint64 LargeFile::partEnd (qint64 from) const
+{
+    qint64 end = from + maxTextBytes;
+    if (end >= size_) return size_;
+    /* look for a newline only near the end, so that the cost is bounded */
+    const char *start = data_ + qMax (from, end - maxLineBytes);
+    for (const char *p = data_ + end - 1; p >= start; --p)
+    {
+        if (*p == '\n')
+            return p - data_ + 1;
+    }
+    return boundary (end);
+}
+/*************************/
+QString LargeFile::decode (qint64 from, qint64 to) const
+{
+    if (!isValid()) return QString();
+    from = qBound (static_cast<qint64>(0), from, size_);
+    to = qBound (from, to, qMin (size_, from + maxTextBytes));
+    return codec_->toUnicode (data_ + from, static_cast<int>(to - from));
+}
+/*************************/
+static int findInText (const QString& text, const QString& str, int from, bool forward,
+                       Qt::CaseSensitivity cs, bool wholeWords)
+{
+    int idx = from;
+    while (idx >= 0)
+    {
+        idx = forward ? text.indexOf (str, idx, cs) : text.lastIndexOf (str, idx, cs);
+        if (idx == -1 || !wholeWords)
+            return idx;
+        const int end = idx + str.length();
+        if ((idx == 0 || !text.at (idx - 1).isLetterOrNumber())
+            && (end == text.length() || !text.at (end).isLetterOrNumber()))
+        {
+            return idx;
+        }
+        idx = forward ? idx + 1 : idx - 1;
+    }
+    return -1;
+}
+/*************************/
+// The search is done on the decoded text of many lines at once (as they're
+// shown, i.e., with long lines cut). Because the string may have newlines,
+// successive parts of the text overlap.
+bool LargeFile::find (const QString& str, qint64& line, int& column, bool forward,
+                      Qt::CaseSensitivity cs, bool wholeWords) const
+{
+    if (!isValid() || str.isEmpty() || line < 0 || line >= lineCount_)
+        return false;
+
+    const qint64 overlap = qMin (static_cast<qint64>(str.count (QLatin1Char ('\n'))), searchLines / 2);
+    if (forward)
+    {
+        qint64 first = line;
+        int from = column;
+        while (first < lineCount_)
+        {
+            QString txt = text (first, searchLines); // may have fewer lines
+            int idx = findInText (txt, str, from, true, cs, wholeWords);
+            if (idx > -1)
+            {
+                line = first + txt.leftRef (idx).count (QLatin1Char ('\n'));
+                column = idx == 0 ? 0 : idx - (txt.lastIndexOf (QLatin1Char ('\n'), idx - 1) + 1);
+                return true;
+            }
+            const qint64 lines = txt.count (QLatin1Char ('\n')) + 1;
+            if (first + lines >= lineCount_)
+                break;
+            first += qMax (static_cast<qint64>(1), lines - overlap);
+            from = 0;
+        }
+    }
+    else
+    {
+        qint64 last = line;
+        qint64 prevFirst = -1; // the first line of the previous part
+        while (last >= 0)
+        {
+            qint64 first = firstLine (last, searchLines, maxTextBytes);
+            QString txt = text (first, last - first + 1);
+            int from;
+            if (prevFirst == -1)
+            { // the first part; we don't want a match with the start position inside it
+                from = txt.lastIndexOf (QLatin1Char ('\n')) + 1 + column - str.length();
+            }
+            else
+            { // only matches that start before the previous part
+                from = 0;
+                for (qint64 i = first; i < prevFirst; ++i)
+                    from = txt.indexOf (QLatin1Char ('\n'), from) + 1;
+                -- from;
+            }
+            int idx = from < 0 ? -1 : findInText (txt, str, from, false, cs, wholeWords);
+            if (idx > -1)
+            {
+                line = first + txt.leftRef (idx).count (QLatin1Char ('\n'));
+                column = idx == 0 ? 0 : idx - (txt.lastIndexOf (QLatin1Char ('\n'), idx - 1) + 1);
+                return true;
+            }
+            if (first == 0)
+                break;
+            /* the next part ends "overlap" lines after the start of this part
+               (but before the end of this part, which may have a few lines) */
+            prevFirst = first;
+            last = qMin (first - 1 + overlap, last - 1);
+        }
+    }
+    return false;
+}
+
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014 <tsujan2000@gmail.com>
+ *
+ * FeatherPad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FeatherPad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LARGEFILE_H
+#define LARGEFILE_H
+
+#include <QString>
+#include <QVector>
+
+class QTextCodec;
+
+namespace FeatherPad {
+
+/* A read-only access to a file that is too large for a text document.
+   The file is memory-mapped and only the offsets of every 1024th line
+   are kept, so that any line can be found and decoded quickly. */
+class LargeFile
+{
+public:
+    LargeFile (const QString& fileName, const QString& charset = QString());
+    ~LargeFile();
+
+    bool isValid() const {
+        return data_ != nullptr && codec_ != nullptr;
+    }
+    QString getCharset() const {
+        return charset_;
+    }
+    qint64 lineCount() const {
+        return lineCount_;
+    }
+
+    qint64 size() const {
+        return size_;
+    }
+
+    /* The text of "count" lines, starting from "first". At most maxTextBytes bytes are
+       decoded and a line is cut after maxLineBytes bytes, so that the text may have
+       fewer lines than requested (but never less than one). */
+    QString text (qint64 first, qint64 count) const;
+    /* the first line of a page that has "line" near its middle */
+    qint64 pageStart (qint64 line) const;
+    /* the first line of the last page */
+    qint64 lastPageStart() const {
+        return firstLine (lineCount_ - 1, windowLines, maxTextBytes);
+    }
+
+    /* For searching the whole file in parts: the end of the part that starts at the
+       byte "from", which has at most maxTextBytes bytes and ends after a newline if
+       possible (otherwise, a long line is split at a character boundary). */
+    qint64 partEnd (qint64 from) const;
+    /* the text between two character boundaries (not more than maxTextBytes bytes) */
+    QString decode (qint64 from, qint64 to) const;
+    /* the nearest character boundary at or before "pos" */
+    qint64 boundary (qint64 pos) const;
+
+    /* "line" and "column" are the start of the search and, if
+       a match is found, they will be the start of the match */
+    bool find (const QString& str, qint64& line, int& column, bool forward,
+               Qt::CaseSensitivity cs, bool wholeWords) const;
+
+    static const int windowLines = 10000; // the number of lines that are shown at once
+    static const int maxTextBytes = 16 * 1024 * 1024; // the bytes that are decoded at once
+    static const int maxLineBytes = 1024 * 1024; // the bytes of a line that are shown
+
+private:
+    qint64 lineOffset (qint64 line) const;
+    qint64 firstLine (qint64 last, qint64 maxLines, qint64 maxBytes) const;
+    void buildIndex();
+
+    const char *data_;
+    qint64 size_;
+    QTextCodec *codec_;
+    QString charset_;
+    QVector<qint64> index_; // the offsets of every indexStep-th line
+    qint64 lineCount_;
+    static const int indexStep = 1024;
+};
+
+}
+
+#endif // LARGEFILE_H
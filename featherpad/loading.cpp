@@ -17,19 +17,218 @@
 
 #include "loading.h"
 #include "encoding.h"
+#include "largefile.h"
 #include <QFile>
 #include <QTextCodec>
+#include <QVector>
+#include <QtConcurrent>
+#include <cstring>
 
 namespace FeatherPad {
 
-Loading::Loading (QString fname, QString charset, bool reload, bool multiple) :
+Loading::Loading (QString fname, QString charset, bool reload, bool multiple, int sampleSize) :
     fname_ (fname),
     charset_ (charset),
     reload_ (reload),
-    multiple_ (multiple)
+    multiple_ (multiple),
+    sampleSize_ (sampleSize),
+    progressive_ (false),
+    stopped_ (0),
+    largeFile_ (nullptr)
 {}
 /*************************/
-Loading::~Loading() {}
+Loading::~Loading()
+{
+    delete largeFile_;
+}
+/*************************/
+static QString guessCharset (const QByteArray& data)
+{
+    /* a single pass finds null bytes and whatever the charset detection needs */
+    const CharsetInfo info = scanBytes (data.constData(), data.size());
+    if (info.nullPos >= 0)
+        return "UTF-8"; // always open non-text files as UTF-8
+    return detectCharset (data, info);
+}
+/*************************/
+struct DecodingSlice {
+    const uchar *start;
+    const uchar *end;
+    int offset; // the position of the decoded slice in the whole text
+    int length; // the length of the decoded slice (-1 for invalid UTF-8)
+};
+/*************************/
+// The number of UTF-16 code units of a UTF-8 text, or -1 if it isn't valid.
+static int utf8Length (const uchar *p, const uchar *end)
+{
+    static const uint minCodePoint[5] = {0, 0, 0x80, 0x800, 0x10000}; // against overlong forms
+    int length = 0;
+    while (p < end)
+    {
+        const uchar c = *p;
+        if (c < 0x80)
+        {
+            ++p;
+            ++length;
+            continue;
+        }
+        uint cp;
+        int bn;
+        if ((c & 0xE0) == 0xC0)
+        {
+            cp = c & 0x1F;
+            bn = 2;
+        }
+        else if ((c & 0xF0) == 0xE0)
+        {
+            cp = c & 0x0F;
+            bn = 3;
+        }
+        else if ((c & 0xF8) == 0xF0)
+        {
+            cp = c & 0x07;
+            bn = 4;
+        }
+        else
+            return -1;
+        if (end - p < bn)
+            return -1;
+        for (int i = 1; i < bn; ++i)
+        {
+            if ((p[i] & 0xC0) != 0x80)
+                return -1;
+            cp = (cp << 6) | (p[i] & 0x3F);
+        }
+        if (cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF) || cp < minCodePoint[bn])
+            return -1;
+        p += bn;
+        length += cp >= 0x10000 ? 2 : 1;
+    }
+    return length;
+}
+/*************************/
+// Decodes a valid UTF-8 text.
+static void utf8Decode (const uchar *p, const uchar *end, QChar *out)
+{
+    while (p < end)
+    {
+        const uchar c = *p;
+        if (c < 0x80)
+        {
+            *out++ = QChar (static_cast<ushort>(c));
+            ++p;
+            continue;
+        }
+        uint cp;
+        int bn;
+        if ((c & 0xE0) == 0xC0)
+        {
+            cp = c & 0x1F;
+            bn = 2;
+        }
+        else if ((c & 0xF0) == 0xE0)
+        {
+            cp = c & 0x0F;
+            bn = 3;
+        }
+        else
+        {
+            cp = c & 0x07;
+            bn = 4;
+        }
+        for (int i = 1; i < bn; ++i)
+            cp = (cp << 6) | (p[i] & 0x3F);
+        p += bn;
+        if (cp >= 0x10000)
+        {
+            *out++ = QChar (QChar::highSurrogate (cp));
+            *out++ = QChar (QChar::lowSurrogate (cp));
+        }
+        else
+            *out++ = QChar (static_cast<ushort>(cp));
+    }
+}
+/*************************/
+/* For big texts in UTF-8 or single-byte charsets: the data are split into
+   slices at character boundaries, the decoded length of each slice is found
+   in parallel, and then the slices are decoded in parallel directly into
+   their places in a preallocated string. Returns false if the text should
+   be decoded by the codec (another charset, invalid UTF-8 or a single core). */
+static bool decodeInParallel (const QByteArray& data, const QString& charset, QTextCodec *codec, QString& text)
+{
+    const int n = QThread::idealThreadCount();
+    if (n < 2) return false;
+
+    const QString cs = charset.toUpper();
+    const bool utf8 = cs == "UTF-8";
+    QVector<QChar> table; // the map of a single-byte charset
+    if (!utf8)
+    {
+        if (!cs.startsWith ("ISO-8859") && !cs.startsWith ("CP125")
+            && !cs.startsWith ("WINDOWS-125") && !cs.startsWith ("KOI8"))
+        {
+            return false;
+        }
+        table.resize (256);
+        for (int i = 0; i < 256; ++i)
+        {
+            const char c = static_cast<char>(i);
+            QString str = codec->toUnicode (&c, 1);
+            if (str.size() != 1 || str.at (0) == QChar::ReplacementCharacter)
+                return false; // not really single-byte or with undefined bytes
+            table[i] = str.at (0);
+        }
+    }
+
+    const uchar *start = reinterpret_cast<const uchar*>(data.constData());
+    const uchar *end = start + data.size();
+    if (utf8 && end - start >= 3 && start[0] == 0xEF && start[1] == 0xBB && start[2] == 0xBF)
+        start += 3; // the codec skips the BOM too
+
+    const qint64 sliceSize = (end - start) / n + 1;
+    QVector<DecodingSlice> slices;
+    const uchar *p = start;
+    while (p < end)
+    {
+        const uchar *e = end - p > sliceSize ? p + sliceSize : end;
+        if (utf8)
+        { // don't split a multibyte sequence
+            while (e < end && (*e & 0xC0) == 0x80)
+                ++e;
+        }
+        DecodingSlice slice = {p, e, 0, 0};
+        slices.append (slice);
+        p = e;
+    }
+
+    QtConcurrent::blockingMap (slices, [utf8] (DecodingSlice& slice) {
+        slice.length = utf8 ? utf8Length (slice.start, slice.end)
+                            : static_cast<int>(slice.end - slice.start);
+    });
+    int length = 0;
+    for (int i = 0; i < slices.size(); ++i)
+    {
+        if (slices.at (i).length < 0)
+            return false; // invalid UTF-8 is left to the codec
+        slices[i].offset = length;
+        length += slices.at (i).length;
+    }
+
+    text = QString (length, Qt::Uninitialized);
+    QChar *out = text.data();
+    const QChar *map = table.constData();
+    QtConcurrent::blockingMap (slices, [utf8, out, map] (DecodingSlice& slice) {
+        if (utf8)
+            utf8Decode (slice.start, slice.end, out + slice.offset);
+        else
+        {
+            QChar *o = out + slice.offset;
+            for (const uchar *c = slice.start; c < slice.end; ++c)
+                *o++ = map[*c];
+        }
+    });
+    return true;
+}
 /*************************/
 void Loading::run()
 {
@@ -40,9 +239,19 @@ void Loading::run()
     }
 
     QFile file (fname_);
-    if (file.size() > 500*1024*1024) // don't open files with sizes > 500 Mib
-    {
-        emit completed (QString(), fname_, QString(), false, false, false);
+    if (file.size() > 500*1024*1024)
+    { // don't load files with sizes > 500 Mib but show them page by page
+        bool enforced = !charset_.isEmpty();
+        LargeFile *lf = new LargeFile (fname_, charset_);
+        if (!lf->isValid()) // UTF-16, UTF-32 or not mappable
+        {
+            delete lf;
+            emit completed (QString(), fname_, QString(), false, false, false);
+            return;
+        }
+        largeFile_ = lf;
+        charset_ = lf->getCharset();
+        emit completed (lf->text (0, LargeFile::windowLines), fname_, charset_, enforced, reload_, multiple_);
         return;
     }
     if (!file.open (QFile::ReadOnly))
@@ -51,78 +260,88 @@ void Loading::run()
         return;
     }
 
-    /* read the file character by character to know
-       if it includes null (and because that's faster) */
     bool enforced = !charset_.isEmpty();
-    bool hasNull = false;
     QByteArray data;
-    char c;
-    qint64 charSize = sizeof (char); // 1
-    if (enforced)
-    { // no need to check for the null character here
-        while (file.read (&c, charSize) > 0)
-            data.append (c);
+    const qint64 fileSize = file.size();
+    const int chunkSize = 4*1024*1024; // 4 MiB
+    const int progressiveSize = 32*1024*1024; // files larger than 32 MiB are loaded progressively
+    const int parallelSize = 2*1024*1024; // bigger texts are decoded on all cores
+    int total = 0;
+
+    /* big regular files are mapped into memory, so that the charset
+       detection and decoding can be done without copying them first */
+    uchar *mapped = nullptr;
+    if (fileSize > chunkSize && !file.isSequential())
+        mapped = file.map (0, fileSize);
+    if (mapped)
+    {
+        total = static_cast<int>(fileSize);
+        data = QByteArray::fromRawData (reinterpret_cast<const char*>(mapped), total);
     }
     else
     {
-        unsigned char C[4];
-        int num = 0;
-        /* checking 4 bytes is enough to guess
-           whether the encoding is UTF-16 or UTF-32 */
-        while (num < 4 && file.read (&c, charSize) > 0)
+        /* read the file in large chunks */
+        if (fileSize > 0)
+            data.reserve (static_cast<int>(fileSize));
+        forever
         {
-            data.append (c);
-            if (c == '\0')
-                hasNull = true;
-            C[num] = c;
-            ++ num;
+            int toRead = chunkSize;
+            if (fileSize > total)
+                toRead = static_cast<int>(qMin (static_cast<qint64>(chunkSize), fileSize - total));
+            else if (fileSize > 0 && file.atEnd()) // don't grow beyond the reserved size
+                break;
+            data.resize (total + toRead);
+            qint64 num = file.read (data.data() + total, toRead);
+            if (num <= 0)
+                break;
+            total += static_cast<int>(num);
         }
+        data.resize (total);
+        file.close();
+    }
+
+    if (!enforced)
+    {
+        /* checking 4 bytes is enough to guess
+           whether the encoding is UTF-16 or UTF-32 */
+        const int num = qMin (total, 4);
+        const unsigned char *C = reinterpret_cast<const unsigned char*>(data.constData());
         if (num == 2 && ((C[0] != '\0' && C[1] == '\0') || (C[0] == '\0' && C[1] != '\0')))
             charset_ = "UTF-16"; // single character
-        else if (num == 4)
+        else if (num == 4 && memchr (C, '\0', 4) != nullptr)
         {
-            if (hasNull)
+            if ((C[0] == 0xFF && C[1] == 0xFE && C[2] != '\0' && C[3] == '\0') // le
+                || (C[0] == 0xFE && C[1] == 0xFF && C[2] == '\0' && C[3] != '\0') // be
+                || (C[0] != '\0' && C[1] == '\0' && C[2] != '\0' && C[3] == '\0') // le
+                || (C[0] == '\0' && C[1] != '\0' && C[2] == '\0' && C[3] != '\0')) // be
             {
-                if ((C[0] == 0xFF && C[1] == 0xFE && C[2] != '\0' && C[3] == '\0') // le
-                    || (C[0] == 0xFE && C[1] == 0xFF && C[2] == '\0' && C[3] != '\0') // be
-                    || (C[0] != '\0' && C[1] == '\0' && C[2] != '\0' && C[3] == '\0') // le
-                    || (C[0] == '\0' && C[1] != '\0' && C[2] == '\0' && C[3] != '\0')) // be
-                {
-                    charset_ = "UTF-16";
-                }
-                /*else if ((C[0] == 0xFF && C[1] == 0xFE && C[2] == '\0' && C[3] == '\0')
-                          || (C[0] == '\0' && C[1] == '\0' && C[2] == 0xFE && C[3] == 0xFF))*/
-                else if ((C[0] != '\0' && C[1] != '\0' && C[2] == '\0' && C[3] == '\0') // le
-                         || (C[0] == '\0' && C[1] == '\0' && C[2] != '\0' && C[3] != '\0')) // be
-                {
-                    charset_ = "UTF-32";
-                }
+                charset_ = "UTF-16";
             }
-            /* reading may still be possible */
-            if (charset_.isEmpty() && !hasNull)
+            /*else if ((C[0] == 0xFF && C[1] == 0xFE && C[2] == '\0' && C[3] == '\0')
+                      || (C[0] == '\0' && C[1] == '\0' && C[2] == 0xFE && C[3] == 0xFF))*/
+            else if ((C[0] != '\0' && C[1] != '\0' && C[2] == '\0' && C[3] == '\0') // le
+                     || (C[0] == '\0' && C[1] == '\0' && C[2] != '\0' && C[3] != '\0')) // be
             {
-                while (file.read (&c, charSize) > 0)
-                {
-                    data.append (c);
-                    if (c == '\0' && !hasNull)
-                        hasNull = true;
-                }
-            }
-            else
-            { // the meaning of null characters was determined before
-                while (file.read (&c, charSize) > 0)
-                    data.append (c);
+                charset_ = "UTF-32";
             }
         }
     }
-    file.close();
 
+    /* the charset of a big text is guessed from a sample of it but, if
+       decoding finds invalid sequences, the whole text will be checked */
+    bool sampled = false;
     if (charset_.isEmpty())
     {
-        if (hasNull)
-            charset_ = "UTF-8"; // always open non-text files as UTF-8
+        sampled = sampleSize_ > 0 && total > sampleSize_;
+        /* a null byte anywhere means a non-text file, which is always opened as UTF-8
+           (finding it is cheap in comparison with charset detection) */
+        if (sampled && memchr (data.constData(), '\0', static_cast<size_t>(total)) != nullptr)
+        {
+            sampled = false;
+            charset_ = "UTF-8";
+        }
         else
-            charset_ = detectCharset (data);
+            charset_ = guessCharset (sampled ? charsetSample (data, sampleSize_) : data);
     }
 
     QTextCodec *codec = QTextCodec::codecForName (charset_.toUtf8()); // or charset.toStdString().c_str()
@@ -132,7 +351,96 @@ void Loading::run()
         codec = QTextCodec::codecForName ("UTF-8");
     }
 
-    QString text = codec->toUnicode (data);
+    if (total > progressiveSize)
+    {
+        /* decode the text in chunks that end at line boundaries, so
+           that the window can show the first one and append the others
+           without freezing (the first chunk is small to be shown soon) */
+        QTextDecoder *decoder = codec->makeDecoder();
+        QString rest;
+        bool first = true;
+        int chunkSize = 256*1024;
+        int pos = 0;
+        while (pos < total && stopped_.load() == 0)
+        {
+            const int num = qMin (chunkSize, total - pos);
+            rest += decoder->toUnicode (data.constData() + pos, num);
+            pos += num;
+            QString chunk;
+            if (pos < total)
+            {
+                int indx = rest.lastIndexOf (QLatin1Char ('\n'));
+                if (indx < 0) continue; // a very long line
+                chunk = rest.left (indx + 1);
+                rest.remove (0, indx + 1);
+            }
+            else
+                chunk.swap (rest);
+            if (sampled && decoder->hasFailure())
+            { // the sample wasn't enough; start again with the whole text
+                sampled = false;
+                QString charset = guessCharset (data);
+                if (charset != charset_)
+                {
+                    if (QTextCodec *c = QTextCodec::codecForName (charset.toUtf8()))
+                    {
+                        charset_ = charset;
+                        codec = c;
+                        delete decoder;
+                        decoder = codec->makeDecoder();
+                        rest.clear();
+                        pos = 0;
+                        if (!first) // the window should discard the text it has received
+                            emit charsetChanged (charset_);
+                        continue;
+                    }
+                }
+            }
+            if (first)
+            {
+                first = false;
+                progressive_ = pos < total; // more chunks will come
+                chunkSize = 1024*1024;
+                emit completed (chunk, fname_, charset_, enforced, reload_, multiple_);
+            }
+            else
+            {
+                emit chunkLoaded (chunk, pos < total ? static_cast<int>(static_cast<qint64>(pos) * 100 / total)
+                                                     : 100);
+            }
+        }
+        delete decoder;
+        if (mapped)
+        {
+            data = QByteArray();
+            file.unmap (mapped);
+            file.close();
+        }
+        return;
+    }
+
+    QString text;
+    QTextCodec::ConverterState state;
+    if (total <= parallelSize || !decodeInParallel (data, charset_, codec, text))
+        text = codec->toUnicode (data.constData(), data.size(), &state);
+    if (sampled && state.invalidChars > 0)
+    { // the sample wasn't enough
+        QString charset = guessCharset (data);
+        if (charset != charset_)
+        {
+            if (QTextCodec *c = QTextCodec::codecForName (charset.toUtf8()))
+            {
+                charset_ = charset;
+                text = c->toUnicode (data.constData(), data.size());
+            }
+        }
+    }
+    if (mapped)
+    { // release the mapping as soon as possible
+        data = QByteArray();
+        file.unmap (mapped);
+        file.close();
+    }
     emit completed (text, fname_, charset_, enforced, reload_, multiple_);
 }
 
@@ -19,19 +19,41 @@
 #define LOADING_H
 
 #include <QThread>
+#include <QAtomicInt>
 
 namespace FeatherPad {
 
+class LargeFile;
+
 class Loading : public QThread {
     Q_OBJECT
 
 public:
-    Loading (QString fname, QString charset, bool reload, bool multiple);
+    Loading (QString fname, QString charset, bool reload, bool multiple, int sampleSize = 0);
     ~Loading();
 
+    /* huge files are loaded progressively: the first part of the text
+       comes with completed() and the rest with chunkLoaded() */
+    bool isProgressive() const {
+        return progressive_;
+    }
+    void stop() {
+        stopped_.store (1);
+    }
+    /* files larger than 500 MiB are shown in a read-only paged viewer */
+    LargeFile *takeLargeFile() {
+        LargeFile *lf = largeFile_;
+        largeFile_ = nullptr;
+        return lf;
+    }
+
 signals:
     void completed (const QString str, const QString fname, const QString charset,
                     bool enforceEncod, bool reload, bool multiple);
+    void chunkLoaded (const QString chunk, int progress); // progress is in percent
+    /* the text that has been sent progressively had a wrong charset and
+       the whole text will be sent again by chunkLoaded() */
+    void charsetChanged (const QString charset);
 
 private:
     void run();
@@ -40,6 +62,10 @@ private:
     QString charset_;
     bool reload_; // Is this a reloading?
     bool multiple_; // Are there multiple files to load?
+    int sampleSize_; // The size of the sample for charset detection (0 means the whole text).
+    bool progressive_; // Is the text sent in chunks?
+    QAtomicInt stopped_; // Should the progressive loading be stopped?
+    LargeFile *largeFile_; // A huge file that isn't taken by the window yet.
 };
 
 }
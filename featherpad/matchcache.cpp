@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014 <tsujan2000@gmail.com>
+ *
+ * FeatherPad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FeatherPad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QTextDocument>
+#include <QTextCursor>
+#include <algorithm>
+#include "matchcache.h"
+#include "textfinder.h"
+
+namespace FeatherPad {
+
+MatchCache::MatchCache (QTextDocument *doc) :
+    doc_ (doc),
+    cs_ (Qt::CaseInsensitive),
+    wholeWords_ (false),
+    revision_ (-1)
+{
+}
+/*************************/
+void MatchCache::setQuery (const QString &str, Qt::CaseSensitivity cs, bool wholeWords)
+{
+    if (str == str_ && cs == cs_ && wholeWords == wholeWords_)
+        return;
+    clear();
+    str_ = str;
+    cs_ = cs;
+    wholeWords_ = wholeWords;
+}
+/*************************/
+void MatchCache::clear()
+{
+    starts_.clear();
+    searched_.clear();
+}
+/*************************/
+// A match is affected by a change if the change touches it or the characters around it
+// (for whole words). Therefore, the matches that start in [position - n, position + charsRemoved]
+// are removed and the range becomes unsearched, where "n" is the length of the searched text.
+void MatchCache::contentsChange (int position, int charsRemoved, int charsAdded)
+{
+    if (searched_.isEmpty()) return;
+    /* syntax highlighting may change formats, which shouldn't clear the cache */
+    if (charsRemoved == charsAdded && doc_->isUndoRedoEnabled() && doc_->revision() == revision_)
+        return;
+    revision_ = doc_->revision();
+
+    const int from = position - str_.length();
+    const int to = position + charsRemoved + 1;
+    const int diff = charsAdded - charsRemoved;
+
+    QVector<int>::iterator first = std::lower_bound (starts_.begin(), starts_.end(), from);
+    QVector<int>::iterator last = std::lower_bound (first, starts_.end(), to);
+    for (QVector<int>::iterator it = last; it != starts_.end(); ++it)
+        *it += diff;
+    starts_.erase (first, last);
+
+    QVector<Range> searched;
+    searched.reserve (searched_.size() + 1);
+    for (int i = 0; i < searched_.size(); ++i)
+    {
+        const Range &r = searched_.at (i);
+        if (r.from < from)
+        {
+            Range part = {r.from, qMin (r.to, from)};
+            searched.append (part);
+        }
+        if (r.to > to)
+        {
+            Range part = {qMax (r.from, to) + diff, r.to + diff};
+            searched.append (part);
+        }
+    }
+    searched_ = searched;
+}
+/*************************/
+// Searches [from, to), which isn't searched, and adds its matches.
+void MatchCache::search (int from, int to)
+{
+    /* include a character before the range and the characters after it, which may be in matches */
+    const int n = str_.length();
+    const int textStart = qMax (from - 1, 0);
+    const int textEnd = qMin (to + n, doc_->characterCount() - 1);
+    if (textEnd <= textStart)
+    {
+        cover (from, to);
+        return;
+    }
+    QTextCursor cur (doc_);
+    cur.setPosition (textStart);
+    cur.setPosition (textEnd, QTextCursor::KeepAnchor);
+    const QString text = cur.selection().toPlainText(); // '\n' is included in this way
+
+    QVector<int> found;
+    const TextFinder finder (str_, cs_, wholeWords_);
+    int pos = from - textStart;
+    while ((pos = finder.findForward (text, pos, to - textStart)) != -1)
+    {
+        found.append (textStart + pos);
+        ++pos;
+    }
+    if (!found.isEmpty())
+    {
+        int i = std::lower_bound (starts_.begin(), starts_.end(), from) - starts_.begin();
+        starts_.insert (i, found.size(), 0);
+        std::copy (found.constBegin(), found.constEnd(), starts_.begin() + i);
+    }
+    cover (from, to);
+}
+/*************************/
+// Adds [from, to) to the searched ranges and merges the adjacent ones.
+void MatchCache::cover (int from, int to)
+{
+    Range range = {from, to};
+    QVector<Range>::iterator it = std::lower_bound (searched_.begin(), searched_.end(), range,
+                                                    [] (const Range &a, const Range &b) {
+        return a.from < b.from;
+    });
+    it = searched_.insert (it, range);
+    int i = it - searched_.begin();
+    if (i > 0 && searched_.at (i - 1).to >= searched_.at (i).from)
+    {
+        searched_[i - 1].to = qMax (searched_.at (i - 1).to, searched_.at (i).to);
+        searched_.remove (i);
+        --i;
+    }
+    while (i + 1 < searched_.size() && searched_.at (i).to >= searched_.at (i + 1).from)
+    {
+        searched_[i].to = qMax (searched_.at (i).to, searched_.at (i + 1).to);
+        searched_.remove (i + 1);
+    }
+}
+/*************************/
+QVector<int> MatchCache::matches (int from, int to)
+{
+    QVector<int> res;
+    if (str_.isEmpty() || from >= to) return res;
+    revision_ = doc_->revision();
+
+    /* search the gaps between the searched ranges */
+    QVector<Range> gaps;
+    int pos = from;
+    for (int i = 0; i < searched_.size(); ++i)
+    {
+        const Range &r = searched_.at (i);
+        if (r.to <= pos) continue;
+        if (r.from >= to) break;
+        if (r.from > pos)
+        {
+            Range gap = {pos, r.from};
+            gaps.append (gap);
+        }
+        pos = r.to;
+    }
+    if (pos < to)
+    {
+        Range gap = {pos, to};
+        gaps.append (gap);
+    }
+    for (int i = 0; i < gaps.size(); ++i)
+        search (gaps.at (i).from, gaps.at (i).to);
+
+    QVector<int>::const_iterator first = std::lower_bound (starts_.constBegin(), starts_.constEnd(), from);
+    QVector<int>::const_iterator last = std::lower_bound (first, starts_.constEnd(), to);
+    for (QVector<int>::const_iterator it = first; it != last; ++it)
+        res.append (*it);
+    return res;
+}
+
+}
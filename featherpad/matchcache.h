@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014 <tsujan2000@gmail.com>
+ *
+ * FeatherPad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FeatherPad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MATCHCACHE_H
+#define MATCHCACHE_H
+
+#include <QVector>
+#include <QString>
+
+class QTextDocument;
+
+namespace FeatherPad {
+
+/* Keeps the starts of the matches of the searched text in the parts of a document
+   that have been searched, so that the matches in the visible part can be found
+   without searching again after scrolling. When the text is changed, only the
+   matches around the changed range are removed and the others are shifted. */
+class MatchCache
+{
+public:
+    MatchCache (QTextDocument *doc);
+
+    /* the cache is cleared if the query is changed */
+    void setQuery (const QString &str, Qt::CaseSensitivity cs, bool wholeWords);
+    void clear();
+
+    /* should be called when the document's contents are changed */
+    void contentsChange (int position, int charsRemoved, int charsAdded);
+
+    /* The starts of the matches that start in [from, to). The
+       parts of the range that aren't searched yet are searched. */
+    QVector<int> matches (int from, int to);
+
+private:
+    struct Range
+    {
+        int from;
+        int to; // exclusive
+    };
+
+    void search (int from, int to);
+    void cover (int from, int to);
+
+    QTextDocument *doc_;
+    QString str_;
+    Qt::CaseSensitivity cs_;
+    bool wholeWords_;
+    QVector<int> starts_; // sorted
+    QVector<Range> searched_; // sorted and disjoint
+    int revision_; // the document's revision when it was last seen
+};
+
+}
+
+#endif // MATCHCACHE_H
@@ -0,0 +1,197 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014 <tsujan2000@gmail.com>
+ *
+ * FeatherPad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FeatherPad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QtConcurrent>
+#include <QMutex>
+#include <QTimerEvent>
+#include "multifind.h"
+#include "textedit.h"
+#include "largefile.h"
+#include "regexfinder.h"
+
+namespace FeatherPad {
+
+/* The state of a search, which is shared with its tasks. They may outlive the
+   search (and even MultiFind) because they aren't waited for when they're stopped. */
+struct MultiFindJob
+{
+    MultiFindJob() : owner (nullptr), regex (false) {}
+
+    QMutex mutex; // for "owner"
+    MultiFind *owner; // null when the matches of the tasks aren't needed anymore
+    bool regex; // Are the tasks in the regex pool?
+    QList<QSharedPointer<RegexJob> > tasks; // the stop flags (and the regex pool states)
+};
+
+MultiFind::MultiFind (QObject *parent) :
+    QObject (parent),
+    remaining_ (0),
+    timedOut_ (false),
+    generation_ (0),
+    timeoutTimerId_ (0)
+{
+    qRegisterMetaType<QVector<FeatherPad::FindAllMatch> >("QVector<FeatherPad::FindAllMatch>");
+    connect (this, &MultiFind::found, this, &MultiFind::addMatches, Qt::QueuedConnection);
+}
+/*************************/
+MultiFind::~MultiFind()
+{
+    stopWorkers();
+}
+/*************************/
+// The tasks aren't waited for because a regex match may not stop soon.
+void MultiFind::stopWorkers()
+{
+    generation_.ref(); // the matches of the old search will be ignored
+    if (timeoutTimerId_)
+    {
+        killTimer (timeoutTimerId_);
+        timeoutTimerId_ = 0;
+    }
+    if (job_)
+    {
+        {
+            QMutexLocker locker (&job_->mutex);
+            job_->owner = nullptr; // the tasks won't emit any signal after this
+        }
+        for (int i = 0; i < job_->tasks.size(); ++i)
+        {
+            if (job_->regex)
+                RegexFinder::abandon (job_->tasks.at (i));
+            else
+                job_->tasks.at (i)->stop.store (1); // a task that isn't started yet is just stopped at once
+        }
+        job_.clear();
+    }
+    remaining_ = 0;
+}
+/*************************/
+void MultiFind::cancel()
+{
+    stopWorkers();
+    str_.clear();
+    docs_.clear();
+}
+/*************************/
+void MultiFind::start (const QList<TextEdit*> &textEdits, const QStringList &names,
+                       const QString &str, Qt::CaseSensitivity cs, bool wholeWords, bool regex)
+{
+    cancel();
+    timedOut_ = false;
+    emit started();
+    if (str.isEmpty() || textEdits.isEmpty())
+    {
+        emit finished();
+        return;
+    }
+    str_ = str;
+
+    const int generation = generation_.load();
+    remaining_ = textEdits.size();
+    QSharedPointer<MultiFindJob> job (new MultiFindJob);
+    job->owner = this;
+    job->regex = regex;
+    job_ = job;
+    for (int i = 0; i < textEdits.size(); ++i)
+    {
+        TextEdit *textEdit = textEdits.at (i);
+        Document doc;
+        doc.textEdit = textEdit;
+        doc.name = names.at (i);
+        doc.truncated = false;
+        docs_.append (doc);
+
+        /* the snapshot of a document is shared (not copied) with its task but
+           a huge file is opened again because it may be closed meanwhile */
+        QString text, fileName, charset;
+        if (LargeFile *largeFile = textEdit->getLargeFile())
+        {
+            fileName = textEdit->getFileName();
+            charset = largeFile->getCharset();
+        }
+        else
+            text = textEdit->plainTextSnapshot();
+        QSharedPointer<RegexJob> task (new RegexJob);
+        job->tasks.append (task);
+        auto search = [=] (const QAtomicInt *stop) -> QVector<RegexMatch> {
+            if (stop->load() != 0) return QVector<RegexMatch>();
+            QVector<FindAllMatch> matches;
+            bool truncated = false;
+            auto collect = [&matches] (const QVector<FindAllMatch> &batch) {
+                matches += batch;
+            };
+            if (!fileName.isEmpty())
+            {
+                const LargeFile largeFile (fileName, charset);
+                if (largeFile.isValid())
+                {
+                    truncated = FindAll::find (QString(), &largeFile, str, cs, wholeWords, regex,
+                                               maxMatches, stop, collect);
+                }
+            }
+            else
+            {
+                truncated = FindAll::find (text, nullptr, str, cs, wholeWords, regex,
+                                           maxMatches, stop, collect);
+            }
+            QMutexLocker locker (&job->mutex);
+            if (job->owner)
+                emit job->owner->found (generation, i, matches, truncated, QPrivateSignal());
+            return QVector<RegexMatch>();
+        };
+        if (regex)
+            RegexFinder::start (task, search);
+        else
+        {
+            QtConcurrent::run ([search, task] {
+                search (&task->stop);
+            });
+        }
+    }
+    if (regex)
+        timeoutTimerId_ = startTimer (RegexFinder::timeout);
+}
+/*************************/
+void MultiFind::addMatches (int generation, int index, const QVector<FindAllMatch> &matches,
+                            bool truncated)
+{
+    if (generation != generation_.load()) return;
+    Document &doc = docs_[index];
+    doc.matches = matches;
+    doc.truncated = truncated;
+    if (!matches.isEmpty())
+        emit documentSearched (index);
+    if (--remaining_ == 0)
+    {
+        stopWorkers(); // all tasks are done but the timer should be stopped
+        emit finished();
+    }
+}
+/*************************/
+void MultiFind::timerEvent (QTimerEvent *event)
+{
+    if (event->timerId() == timeoutTimerId_)
+    { // the documents that are searched are kept
+        stopWorkers();
+        timedOut_ = true;
+        emit finished();
+        return;
+    }
+    QObject::timerEvent (event);
+}
+
+}
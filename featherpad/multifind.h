@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014 <tsujan2000@gmail.com>
+ *
+ * FeatherPad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FeatherPad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MULTIFIND_H
+#define MULTIFIND_H
+
+#include <QObject>
+#include <QPointer>
+#include <QList>
+#include <QAtomicInt>
+#include <QSharedPointer>
+#include "findall.h"
+
+namespace FeatherPad {
+
+struct MultiFindJob;
+
+/* Finds all matches of a string in several documents, which may be in different
+   windows, with the global thread pool. Each document is searched in a separate
+   task, so that the search time is divided by the number of cores, and its matches
+   are added as soon as its search is finished. The documents are searched in their
+   snapshots and huge files in their own copies, so that they can be edited or
+   closed meanwhile. The tasks are never waited for and a regular expression is
+   searched for in the regex pool and given up after a timeout. */
+class MultiFind : public QObject
+{
+    Q_OBJECT
+public:
+    struct Document
+    {
+        QPointer<TextEdit> textEdit; // null if the document is closed
+        QString name;
+        QVector<FindAllMatch> matches;
+        bool truncated;
+    };
+
+    MultiFind (QObject *parent = nullptr);
+    ~MultiFind();
+
+    /* "names" are shown for "textEdits" and "wholeWords"
+       is ignored if "str" is a regular expression */
+    void start (const QList<TextEdit*> &textEdits, const QStringList &names,
+                const QString &str, Qt::CaseSensitivity cs, bool wholeWords, bool regex);
+    /* stops searching and forgets the query and its matches */
+    void cancel();
+
+    QString query() const {
+        return str_;
+    }
+    bool isRunning() const {
+        return remaining_ > 0;
+    }
+    /* Was the search for a regular expression abandoned because it took too long? */
+    bool isTimedOut() const {
+        return timedOut_;
+    }
+    const QList<Document> &documents() const {
+        return docs_;
+    }
+
+    static const int maxMatches = 1000; // the matches of each document
+
+signals:
+    void started(); // the old matches are removed
+    void documentSearched (int index); // only if there's a match
+    void finished();
+    /* emitted by the workers */
+    void found (int generation, int index, const QVector<FeatherPad::FindAllMatch> &matches,
+                bool truncated, QPrivateSignal);
+
+private slots:
+    void addMatches (int generation, int index, const QVector<FeatherPad::FindAllMatch> &matches,
+                     bool truncated);
+
+protected:
+    void timerEvent (QTimerEvent *event);
+
+private:
+    void stopWorkers();
+
+    QString str_;
+    QList<Document> docs_;
+    int remaining_; // the documents that aren't searched yet
+    bool timedOut_;
+    QAtomicInt generation_; // incremented when the matches of the workers become invalid
+    QSharedPointer<MultiFindJob> job_; // shared with the current tasks
+    int timeoutTimerId_; // for giving up a regex search
+};
+
+}
+
+#endif // MULTIFIND_H
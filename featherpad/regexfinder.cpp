@@ -0,0 +1,280 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014 <tsujan2000@gmail.com>
+ *
+ * FeatherPad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FeatherPad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QThread>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QMutex>
+#include <QTimerEvent>
+#include "regexfinder.h"
+
+namespace FeatherPad {
+
+// Regex workers have their own threads, so that a match that can't be stopped (inside
+// the regex engine) doesn't occupy the global pool. The pool is never deleted because
+// quitting shouldn't wait for such a match.
+static QMutex poolMutex;
+static QThreadPool *regexPool = nullptr;
+static int baseThreads = 0;
+static int abandonedThreads = 0; // the threads of the abandoned workers that still run
+
+static QThreadPool *pool()
+{
+    QMutexLocker locker (&poolMutex);
+    if (regexPool == nullptr)
+    {
+        regexPool = new QThreadPool;
+        baseThreads = qMax (QThread::idealThreadCount() / 2, 2);
+        regexPool->setMaxThreadCount (baseThreads);
+    }
+    return regexPool;
+}
+/*************************/
+// The abandoned workers don't count, so that runaway matches can't fill the pool.
+static void addAbandoned (int n)
+{
+    QThreadPool *threadPool = pool();
+    QMutexLocker locker (&poolMutex);
+    abandonedThreads += n;
+    threadPool->setMaxThreadCount (baseThreads + abandonedThreads);
+}
+/*************************/
+class RegexRunnable : public QRunnable
+{
+public:
+    RegexRunnable (const QSharedPointer<RegexJob> &job,
+                   const std::function<QVector<RegexMatch>(const QAtomicInt*)> &work) :
+        job_ (job),
+        work_ (work)
+    {}
+    void run() {
+        if (job_->stop.load() == 0)
+            job_->matches = work_ (&job_->stop);
+        if (!job_->state.testAndSetOrdered (RegexJob::Running, RegexJob::Finished))
+            addAbandoned (-1); // the thread isn't occupied by an abandoned worker anymore
+    }
+
+private:
+    QSharedPointer<RegexJob> job_;
+    std::function<QVector<RegexMatch>(const QAtomicInt*)> work_;
+};
+/*************************/
+RegexFinder::RegexFinder (const QString &pattern, Qt::CaseSensitivity cs)
+{
+    /* the blocks of the text are separated by newlines */
+    QRegularExpression::PatternOptions options = QRegularExpression::MultilineOption
+                                                 | QRegularExpression::UseUnicodePropertiesOption;
+    if (cs == Qt::CaseInsensitive)
+        options |= QRegularExpression::CaseInsensitiveOption;
+    /* a pattern that backtracks catastrophically is given up at a position
+       much sooner than with PCRE's default limit (10000000) */
+    regex_.setPattern ("(*LIMIT_MATCH=1000000)" + pattern);
+    regex_.setPatternOptions (options);
+    /* compile the pattern (with JIT) here and not in every worker */
+    regex_.optimize();
+}
+/*************************/
+// Makes the replacing text of a match. "\N" and "$N" are replaced by the N-th captured
+// text, where N has one or two digits, "\n" and "\t" by a newline and a tab, and "\\"
+// and "$$" by a backslash and a dollar sign.
+QString RegexFinder::expand (const QString &replacement, const QRegularExpressionMatch &match)
+{
+    QString res;
+    const int n = replacement.length();
+    for (int i = 0; i < n; ++i)
+    {
+        const QChar c = replacement.at (i);
+        if ((c == QLatin1Char ('\\') || c == QLatin1Char ('$')) && i + 1 < n)
+        {
+            const QChar next = replacement.at (i + 1);
+            if (next >= QLatin1Char ('0') && next <= QLatin1Char ('9'))
+            {
+                int group = next.digitValue();
+                ++i;
+                if (i + 1 < n && replacement.at (i + 1) >= QLatin1Char ('0') && replacement.at (i + 1) <= QLatin1Char ('9'))
+                { // two digits only if there is such a group
+                    const int group2 = group * 10 + replacement.at (i + 1).digitValue();
+                    if (group2 <= match.lastCapturedIndex())
+                    {
+                        group = group2;
+                        ++i;
+                    }
+                }
+                res += match.captured (group);
+                continue;
+            }
+            if (c == QLatin1Char ('\\'))
+            {
+                if (next == QLatin1Char ('n'))
+                {
+                    res += QLatin1Char ('\n');
+                    ++i;
+                    continue;
+                }
+                if (next == QLatin1Char ('t'))
+                {
+                    res += QLatin1Char ('\t');
+                    ++i;
+                    continue;
+                }
+                if (next == QLatin1Char ('\\'))
+                {
+                    res += QLatin1Char ('\\');
+                    ++i;
+                    continue;
+                }
+            }
+            else if (next == QLatin1Char ('$'))
+            {
+                res += QLatin1Char ('$');
+                ++i;
+                continue;
+            }
+        }
+        res += c;
+    }
+    return res;
+}
+/*************************/
+QVector<RegexMatch> RegexFinder::search (const QString &text, int from, int to, int maxCount,
+                                         const QString &replacement, const QAtomicInt *stop) const
+{
+    QVector<RegexMatch> res;
+    int pos = qMax (from, 0);
+    to = qMin (to, text.length());
+    while (pos < to && stop->load() == 0)
+    {
+        const QRegularExpressionMatch match = regex_.match (text, pos);
+        if (!match.hasMatch() || match.capturedStart() >= to) // also if the match limit is reached
+            break;
+        if (match.capturedLength() == 0)
+        {
+            pos = match.capturedStart() + 1;
+            continue;
+        }
+        RegexMatch m;
+        m.position = match.capturedStart();
+        m.length = match.capturedLength();
+        if (!replacement.isNull())
+            m.replacement = expand (replacement, match);
+        res.append (m);
+        if (maxCount > 0 && res.size() >= maxCount)
+            break;
+        pos = match.capturedEnd();
+    }
+    return res;
+}
+/*************************/
+QVector<RegexMatch> RegexFinder::searchBackward (const QString &text, int to,
+                                                 const QString &replacement, const QAtomicInt *stop) const
+{
+    to = qMin (to, text.length());
+    int window = 64 * 1024;
+    while (to > 0 && stop->load() == 0)
+    {
+        int from = qMax (to - window, 0);
+        if (from > 0)
+        { // begin with a line if it isn't too long, for "^" and lookbehinds
+            const int lineStart = text.lastIndexOf (QLatin1Char ('\n'), from - 1) + 1;
+            if (from - lineStart <= window)
+                from = lineStart;
+        }
+        /* the replacing text is made only for the last match */
+        const QVector<RegexMatch> matches = search (text, from, to, 0, QString(), stop);
+        if (!matches.isEmpty())
+        {
+            if (replacement.isNull())
+                return QVector<RegexMatch>() << matches.last();
+            const int pos = matches.last().position;
+            return search (text, pos, pos + 1, 1, replacement, stop);
+        }
+        to = from;
+        window *= 4;
+    }
+    return QVector<RegexMatch>();
+}
+/*************************/
+void RegexFinder::start (const QSharedPointer<RegexJob> &job,
+                         const std::function<QVector<RegexMatch>(const QAtomicInt*)> &work)
+{
+    pool()->start (new RegexRunnable (job, work));
+}
+/*************************/
+void RegexFinder::abandon (const QSharedPointer<RegexJob> &job)
+{
+    job->stop.store (1);
+    if (job->state.testAndSetOrdered (RegexJob::Running, RegexJob::Abandoned))
+        addAbandoned (1);
+}
+/*************************/
+RegexSearch::RegexSearch (QObject *parent) :
+    QObject (parent),
+    timeout_ (0),
+    timerId_ (0)
+{}
+/*************************/
+RegexSearch::~RegexSearch()
+{
+    cancel();
+}
+/*************************/
+void RegexSearch::start (const std::function<QVector<RegexMatch>(const QAtomicInt*)> &work, int timeout)
+{
+    cancel();
+    job_ = QSharedPointer<RegexJob> (new RegexJob);
+    timeout_ = timeout;
+    elapsed_.start();
+    RegexFinder::start (job_, work);
+    /* the worker is polled, so that it never has to reach this object */
+    timerId_ = startTimer (10);
+}
+/*************************/
+void RegexSearch::cancel()
+{
+    if (timerId_)
+    {
+        killTimer (timerId_);
+        timerId_ = 0;
+    }
+    if (job_)
+    {
+        RegexFinder::abandon (job_);
+        job_.clear();
+    }
+}
+/*************************/
+void RegexSearch::timerEvent (QTimerEvent *event)
+{
+    if (event->timerId() != timerId_)
+    {
+        QObject::timerEvent (event);
+        return;
+    }
+    if (job_->state.loadAcquire() == RegexJob::Finished)
+    {
+        const QVector<RegexMatch> matches = job_->matches;
+        cancel();
+        emit finished (matches, false);
+    }
+    else if (elapsed_.elapsed() > timeout_)
+    {
+        cancel();
+        emit finished (QVector<RegexMatch>(), true);
+    }
+}
+
+}
@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014 <tsujan2000@gmail.com>
+ *
+ * FeatherPad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FeatherPad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef REGEXFINDER_H
+#define REGEXFINDER_H
+
+#include <QRegularExpression>
+#include <QAtomicInt>
+#include <QVector>
+#include <QObject>
+#include <QSharedPointer>
+#include <QElapsedTimer>
+#include <functional>
+
+namespace FeatherPad {
+
+struct RegexMatch
+{
+    int position;
+    int length;
+    QString replacement; // the replacing text with the captured texts (if requested)
+};
+
+/* The state of a worker in the regex pool, which is shared with whoever started it
+   and may outlive it if the worker is abandoned. */
+struct RegexJob
+{
+    enum {Running = 0, Finished, Abandoned};
+
+    RegexJob() : stop (0), state (Running) {}
+
+    QAtomicInt stop; // Should the worker stop?
+    QAtomicInt state;
+    QVector<RegexMatch> matches; // valid when the state is Finished
+};
+
+/* Finds the matches of a regular expression in a plain text (usually, the snapshot
+   of a document, where blocks are separated by newlines). Because a pattern may need
+   a very long time to be matched, the search is done in a worker thread of a separate
+   pool and is given up after a timeout. Empty matches are skipped. */
+class RegexFinder
+{
+public:
+    RegexFinder (const QString &pattern, Qt::CaseSensitivity cs);
+
+    bool isValid() const {
+        return regex_.isValid();
+    }
+    QString errorString() const {
+        return regex_.errorString();
+    }
+
+    /* The matches that start in [from, to), at most "maxCount" of them if it's positive.
+       If "replacement" isn't null, the replacing text of each match is also made, where
+       "\N" or "$N" is the N-th captured text. The search stops as soon as "*stop" isn't
+       zero or at a position where the regex engine reaches its match limit. */
+    QVector<RegexMatch> search (const QString &text, int from, int to, int maxCount,
+                                const QString &replacement, const QAtomicInt *stop) const;
+    /* The last match that starts before "to" (or nothing). The text before "to" is searched
+       in growing windows, so that the time doesn't depend on how far from the start it is. */
+    QVector<RegexMatch> searchBackward (const QString &text, int to,
+                                        const QString &replacement, const QAtomicInt *stop) const;
+
+    /* Runs "work" in the regex pool, which is separate from the global pool. */
+    static void start (const QSharedPointer<RegexJob> &job,
+                       const std::function<QVector<RegexMatch>(const QAtomicInt*)> &work);
+    /* Stops the worker of "job" without waiting for it. Because a match can't be stopped
+       inside the regex engine, the pool has one more thread as long as the worker runs. */
+    static void abandon (const QSharedPointer<RegexJob> &job);
+
+    static const int timeout = 5000; // in ms
+    static const int visibleTimeout = 300; // for highlighting the visible matches
+
+private:
+    static QString expand (const QString &replacement, const QRegularExpressionMatch &match);
+
+    QRegularExpression regex_;
+};
+
+/* A regex search in the regex pool whose result comes with finished(), so that the
+   GUI isn't blocked while waiting. The search is stopped if it takes more than its
+   timeout, if another one is started or if this object is deleted. */
+class RegexSearch : public QObject
+{
+    Q_OBJECT
+
+public:
+    RegexSearch (QObject *parent = nullptr);
+    ~RegexSearch();
+
+    /* "work" runs in a worker thread and should stop as soon as "*stop" isn't zero */
+    void start (const std::function<QVector<RegexMatch>(const QAtomicInt*)> &work, int timeout);
+    void cancel();
+
+    bool isRunning() const {
+        return timerId_ != 0;
+    }
+
+signals:
+    /* the matches are empty if the search is timed out (and abandoned) */
+    void finished (const QVector<FeatherPad::RegexMatch> &matches, bool timedOut);
+
+protected:
+    void timerEvent (QTimerEvent *event);
+
+private:
+    QSharedPointer<RegexJob> job_;
+    QElapsedTimer elapsed_;
+    int timeout_;
+    int timerId_;
+};
+
+}
+
+#endif // REGEXFINDER_H
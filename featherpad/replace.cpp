@@ -17,6 +17,8 @@
 
 #include "fpwin.h"
 #include "ui_fp.h"
+#include "textfinder.h"
+#include "regexfinder.h"
 
 namespace FeatherPad {
 
@@ -121,6 +123,85 @@ void FPwin::replace()
         removeGreenSel();
     }
 
+    QTextDocument::FindFlags searchFlags = getSearchFlags();
+    const bool forward = QObject::sender() == ui->toolButtonNext;
+    if (qobject_cast< TabPage *>(ui->tabWidget->widget (index))->matchRegex())
+    { // the match is replaced by onRegexReplaceFound() when it's found in a worker thread
+        const RegexFinder finder (txtFind, searchFlags & QTextDocument::FindCaseSensitively
+                                               ? Qt::CaseSensitive : Qt::CaseInsensitive);
+        if (!finder.isValid())
+        {
+            replaceSearch_->cancel();
+            showWarningBar ("<center><b><big>" + tr ("Invalid regular expression!") + "</big></b></center>\n"
+                            + "<center>" + finder.errorString() + "</center>");
+            return;
+        }
+        const QTextCursor cur = textEdit->textCursor();
+        pendingReplace_.textEdit = textEdit;
+        pendingReplace_.revision = textEdit->textRevision();
+        pendingReplace_.anchor = cur.anchor();
+        pendingReplace_.position = cur.position();
+        pendingReplace_.newSearch = false;
+        pendingReplace_.all = false;
+        const QString text = textEdit->plainTextSnapshot();
+        const QString replacement = txtReplace_;
+        const int selStart = cur.selectionStart();
+        const int selEnd = cur.selectionEnd();
+        replaceSearch_->start ([finder, text, replacement, forward, selStart, selEnd] (const QAtomicInt *stop) -> QVector<RegexMatch> {
+            if (forward)
+                return finder.search (text, selEnd, text.length(), 1, replacement, stop);
+            return finder.searchBackward (text, selStart, replacement, stop);
+        }, RegexFinder::timeout);
+        return;
+    }
+
+    QTextCursor found = finding (txtFind, textEdit->textCursor(),
+                                 forward ? searchFlags : searchFlags | QTextDocument::FindBackward);
+    replaceFound (textEdit, found, txtReplace_);
+}
+/*************************/
+// Replaces the regex match(es) found by replace() or replaceAll() if the text
+// (and its selection for replace()) is the same as before.
+void FPwin::onRegexReplaceFound (const QVector<RegexMatch> &matches, bool timedOut)
+{
+    TabPage *tabPage = qobject_cast< TabPage *>(ui->tabWidget->currentWidget());
+    if (tabPage == nullptr) return;
+    TextEdit *textEdit = tabPage->textEdit();
+    QTextCursor found = textEdit->textCursor();
+    if (pendingReplace_.textEdit != textEdit
+        || pendingReplace_.revision != textEdit->textRevision()
+        || (!pendingReplace_.all && (pendingReplace_.anchor != found.anchor()
+                                     || pendingReplace_.position != found.position()))
+        || textEdit->isReadOnly())
+    {
+        return;
+    }
+    if (timedOut)
+    {
+        showWarningBar ("<center><b><big>" + tr ("The regular expression took too long and its search was abandoned.") + "</big></b></center>");
+        return;
+    }
+    if (pendingReplace_.all)
+    {
+        const QString text = textEdit->plainTextSnapshot(); // the snapshot will be cleared
+        replaceAllFound (textEdit, text, matches);
+        return;
+    }
+    QString replacement;
+    if (matches.isEmpty())
+        found = QTextCursor();
+    else
+    {
+        found.setPosition (matches.first().position);
+        found.setPosition (matches.first().position + matches.first().length, QTextCursor::KeepAnchor);
+        replacement = matches.first().replacement;
+    }
+    replaceFound (textEdit, found, replacement);
+}
+/*************************/
+// Replaces the found match (if any) with a green highlight.
+void FPwin::replaceFound (TextEdit *textEdit, const QTextCursor &found, const QString &replacement)
+{
     bool lineNumShown (ui->actionLineNumbers->isChecked() || ui->spinBox->isVisible());
 
     /* remember all previous (yellow and) green highlights */
@@ -134,14 +215,8 @@ void FPwin::replace()
     if (!es.isEmpty() && lineNumShown)
         es.removeFirst();
 
-    QTextDocument::FindFlags searchFlags = getSearchFlags();
     QTextCursor start = textEdit->textCursor();
     QTextCursor tmp = start;
-    QTextCursor found;
-    if (QObject::sender() == ui->toolButtonNext)
-        found = finding (txtFind, start, searchFlags);
-    else// if (QObject::sender() == ui->toolButtonPrv)
-        found = finding (txtFind, start, searchFlags | QTextDocument::FindBackward);
     QColor color = QColor (textEdit->hasDarkScheme() ? Qt::darkGreen : Qt::green);
     int pos;
     QList<QTextEdit::ExtraSelection> gsel = textEdit->getGreenSel();
@@ -151,7 +226,7 @@ void FPwin::replace()
         pos = found.anchor();
         start.setPosition (found.position(), QTextCursor::KeepAnchor);
         textEdit->setTextCursor (start);
-        textEdit->insertPlainText (txtReplace_);
+        textEdit->insertPlainText (replacement);
 
         start = textEdit->textCursor();
         tmp.setPosition (pos);
@@ -193,44 +268,139 @@ void FPwin::replaceAll()
     }
 
     QTextDocument::FindFlags searchFlags = getSearchFlags();
+    Qt::CaseSensitivity cs = searchFlags & QTextDocument::FindCaseSensitively ? Qt::CaseSensitive : Qt::CaseInsensitive;
+
+    /* find all matches in one pass over the plain text (a copy
+       is used because the snapshot will be cleared by the edits) */
+    const QString text = textEdit->plainTextSnapshot();
+    if (qobject_cast< TabPage *>(ui->tabWidget->widget (index))->matchRegex())
+    { // the matches are replaced by onRegexReplaceFound() when they're found in a worker thread
+        const RegexFinder finder (txtFind, cs);
+        if (!finder.isValid())
+        {
+            replaceSearch_->cancel();
+            showWarningBar ("<center><b><big>" + tr ("Invalid regular expression!") + "</big></b></center>\n"
+                            + "<center>" + finder.errorString() + "</center>");
+            return;
+        }
+        pendingReplace_.textEdit = textEdit;
+        pendingReplace_.revision = textEdit->textRevision();
+        pendingReplace_.anchor = pendingReplace_.position = -1; // the selection doesn't matter
+        pendingReplace_.newSearch = false;
+        pendingReplace_.all = true;
+        const QString replacement = txtReplace_;
+        replaceSearch_->start ([finder, text, replacement] (const QAtomicInt *stop) {
+            return finder.search (text, 0, text.length(), 0, replacement, stop);
+        }, RegexFinder::timeout);
+        return;
+    }
+
+    QVector<RegexMatch> matches;
+    const TextFinder finder (txtFind, cs, searchFlags & QTextDocument::FindWholeWords);
+    const int findLength = txtFind.length();
+    int pos = 0;
+    while ((pos = finder.findForward (text, pos)) != -1)
+    {
+        RegexMatch m;
+        m.position = pos;
+        m.length = findLength;
+        m.replacement = txtReplace_;
+        matches.append (m);
+        pos += findLength;
+    }
+    replaceAllFound (textEdit, text, matches);
+}
+/*************************/
+// Replaces all matches of "text", which is the plain text of the document.
+void FPwin::replaceAllFound (TextEdit *textEdit, const QString &text, const QVector<RegexMatch> &matches)
+{
+    const int count = matches.size();
 
+    /* Replace the matches of each range of blocks with a single edit, from the end
+       of the text, so that the positions of the previous matches don't change. All
+       edits are in one edit block, so that there is one undo step and one change
+       signal, and the highlighter only has to highlight the visible blocks at once. */
     QTextCursor orig = textEdit->textCursor();
     QTextCursor start = orig;
-    QColor color = QColor (textEdit->hasDarkScheme() ? Qt::darkGreen : Qt::green);
-    int pos; QTextCursor found;
     start.beginEditBlock();
-    start.setPosition (0);
-    QTextCursor tmp = start;
+    int i = count - 1;
+    while (i >= 0)
+    {
+        const int last = i;
+        while (i > 0)
+        {
+            const int prevEnd = matches.at (i - 1).position + matches.at (i - 1).length;
+            if (text.midRef (prevEnd, matches.at (i).position - prevEnd).contains (QLatin1Char ('\n')))
+                break;
+            --i;
+        }
+        /* the text between the matches is taken from their block because
+           the plain text has spaces instead of non-breaking spaces */
+        QString blockText;
+        int blockPos = 0;
+        if (last > i)
+        {
+            const QTextBlock block = textEdit->document()->findBlock (matches.at (i).position);
+            blockText = block.text();
+            blockPos = block.position();
+        }
+        QString replacement;
+        for (int j = i; j <= last; ++j)
+        {
+            replacement += matches.at (j).replacement;
+            if (j < last)
+            {
+                const int end = matches.at (j).position + matches.at (j).length;
+                replacement += blockText.midRef (end - blockPos, matches.at (j + 1).position - end);
+            }
+        }
+        start.setPosition (matches.at (i).position);
+        start.setPosition (matches.at (last).position + matches.at (last).length, QTextCursor::KeepAnchor);
+        start.insertText (replacement);
+        --i;
+    }
+    start.endEditBlock();
+
+    /* restore the original cursor without selection */
+    orig.setPosition (orig.anchor());
+    textEdit->setTextCursor (orig);
+
+    /* only the visible replacements are marked because every cursor
+       of a green highlight should be updated with each later edit */
+    QColor color = QColor (textEdit->hasDarkScheme() ? Qt::darkGreen : Qt::green);
     QList<QTextEdit::ExtraSelection> gsel = textEdit->getGreenSel();
     QList<QTextEdit::ExtraSelection> es;
-    int count = 0;
-    while (!(found = finding (txtFind, start, searchFlags)).isNull())
+    if (count > 0)
     {
-        start.setPosition (found.anchor());
-        pos = found.anchor();
-        start.setPosition (found.position(), QTextCursor::KeepAnchor);
-        start.insertText (txtReplace_);
-
-        tmp.setPosition (pos);
-        tmp.setPosition (start.position(), QTextCursor::KeepAnchor);
-        start.setPosition (start.position());
-        QTextEdit::ExtraSelection extra;
-        extra.format.setBackground (color);
-        extra.cursor = tmp;
-        es.prepend (extra);
-        gsel.append (extra);
-        ++count;
+        const int visStart = textEdit->cursorForPosition (QPoint (0, 0)).position();
+        const int visEnd = textEdit->cursorForPosition (QPoint (textEdit->geometry().width(),
+                                                                textEdit->geometry().height())).position();
+        /* the replacements may have different lengths, so their
+           new positions are found by accumulating the shifts */
+        QTextCursor tmp = orig;
+        int shift = 0;
+        for (int k = 0; k < count; ++k)
+        {
+            const RegexMatch &m = matches.at (k);
+            const int newPos = m.position + shift;
+            if (newPos > visEnd) break;
+            shift += m.replacement.length() - m.length;
+            if (newPos + m.replacement.length() < visStart) continue;
+            tmp.setPosition (newPos);
+            tmp.setPosition (newPos + m.replacement.length(), QTextCursor::KeepAnchor);
+            QTextEdit::ExtraSelection extra;
+            extra.format.setBackground (color);
+            extra.cursor = tmp;
+            es.prepend (extra);
+            gsel.append (extra);
+        }
     }
     textEdit->setGreenSel (gsel);
-    start.endEditBlock();
     if ((ui->actionLineNumbers->isChecked() || ui->spinBox->isVisible()))
         es.prepend (textEdit->currentLineSelection());
     es.append (textEdit->getRedSel());
     textEdit->setExtraSelections (es);
     hlight();
-    /* restore the original cursor without selection */
-    orig.setPosition (orig.anchor());
-    textEdit->setTextCursor (orig);
 
     QString title;
     if (count == 0)
@@ -28,6 +28,11 @@ SearchBar::SearchBar(QWidget *parent, bool hasText, Qt::WindowFlags f) : QFrame
     lineEdit_->setMinimumWidth (150);
     lineEdit_->setPlaceholderText (tr ("Search..."));
 
+    /* shows "n of m" when all matches are found */
+    matchLabel_ = new QLabel (this);
+    matchLabel_->setContentsMargins (5, 0, 5, 0);
+    matchLabel_->hide();
+
     /* See the comment about KAcceleratorManager in "fpwin.cpp". */
 
     toolButton_nxt_ = new QToolButton (this);
@@ -58,6 +63,12 @@ SearchBar::SearchBar(QWidget *parent, bool hasText, Qt::WindowFlags f) : QFrame
     pushButton_whole_->setCheckable (true);
     pushButton_whole_->setFocusPolicy (Qt::NoFocus);
 
+    pushButton_regex_ = new QPushButton (this);
+    pushButton_regex_->setText (tr ("Regex"));
+    pushButton_regex_->setToolTip (tr ("Regular expression"));
+    pushButton_regex_->setCheckable (true);
+    pushButton_regex_->setFocusPolicy (Qt::NoFocus);
+
     setTabOrder (lineEdit_, toolButton_nxt_);
     setTabOrder (toolButton_nxt_, toolButton_prv_);
 
@@ -65,10 +76,12 @@ SearchBar::SearchBar(QWidget *parent, bool hasText, Qt::WindowFlags f) : QFrame
     mainGrid->setHorizontalSpacing (1);
     mainGrid->setContentsMargins (2, 0, 2, 0);
     mainGrid->addWidget (lineEdit_, 0, 0);
-    mainGrid->addWidget (toolButton_nxt_, 0, 1);
-    mainGrid->addWidget (toolButton_prv_, 0, 2);
-    mainGrid->addWidget (pushButton_case_, 0, 3);
-    mainGrid->addWidget (pushButton_whole_, 0, 4);
+    mainGrid->addWidget (matchLabel_, 0, 1);
+    mainGrid->addWidget (toolButton_nxt_, 0, 2);
+    mainGrid->addWidget (toolButton_prv_, 0, 3);
+    mainGrid->addWidget (pushButton_case_, 0, 4);
+    mainGrid->addWidget (pushButton_whole_, 0, 5);
+    mainGrid->addWidget (pushButton_regex_, 0, 6);
     setLayout (mainGrid);
 
     connect (lineEdit_, &QLineEdit::returnPressed, this, &SearchBar::findForward);
@@ -76,6 +89,7 @@ SearchBar::SearchBar(QWidget *parent, bool hasText, Qt::WindowFlags f) : QFrame
     connect (toolButton_prv_, &QAbstractButton::clicked, this, &SearchBar::findBackward);
     connect (pushButton_case_, &QAbstractButton::clicked, this, &SearchBar::searchFlagChanged);
     connect (pushButton_whole_, &QAbstractButton::clicked, this, &SearchBar::searchFlagChanged);
+    connect (pushButton_regex_, &QAbstractButton::clicked, this, &SearchBar::searchFlagChanged);
 }
 /*************************/
 void SearchBar::focusLineEdit()
@@ -119,6 +133,11 @@ bool SearchBar::matchWhole() const
     return pushButton_whole_->isChecked();
 }
 /*************************/
+bool SearchBar::matchRegex() const
+{
+    return pushButton_regex_->isChecked();
+}
+/*************************/
 // Used only in a workaround (-> FPwin::disableShortcuts())
 void SearchBar::disableShortcuts (bool disable)
 {
@@ -143,5 +162,11 @@ void SearchBar::setSearchIcons (QIcon iconNext, QIcon iconPrev)
     toolButton_nxt_->setIcon (iconNext);
     toolButton_prv_->setIcon (iconPrev);
 }
+/*************************/
+void SearchBar::setMatchInfo (const QString &info)
+{
+    matchLabel_->setText (info);
+    matchLabel_->setVisible (!info.isEmpty());
+}
 
 }
@@ -20,6 +20,7 @@
 
 #include <QPointer>
 #include <QPushButton>
+#include <QLabel>
 #include "lineedit.h"
 
 namespace FeatherPad {
@@ -37,9 +38,12 @@ public:
 
     bool matchCase() const;
     bool matchWhole() const;
+    bool matchRegex() const;
 
     void disableShortcuts (bool disable);
     void setSearchIcons (QIcon iconNext, QIcon iconPrev);
+    /* shows the number of matches (hidden if empty) */
+    void setMatchInfo (const QString &info);
 
 signals:
     void searchFlagChanged();
@@ -50,10 +54,12 @@ private:
     void findBackward();
 
     QPointer<LineEdit> lineEdit_;
+    QPointer<QLabel> matchLabel_;
     QPointer<QToolButton> toolButton_nxt_;
     QPointer<QToolButton> toolButton_prv_;
     QPointer<QPushButton> pushButton_case_;
     QPointer<QPushButton> pushButton_whole_;
+    QPointer<QPushButton> pushButton_regex_;
 };
 
 }
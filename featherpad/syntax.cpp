@@ -236,15 +236,15 @@ void FPwin::syntaxHighlighting (TextEdit *textEdit)
         return;
     }
 
-    if (textEdit->getSize() > static_cast<FPsingleton*>(qApp)->getConfig().getMaxSHSize()*1024*1024)
-        return;
+    /* the size limit is a soft budget: bigger texts are highlighted lazily */
+    bool lazy = textEdit->getSize() > static_cast<FPsingleton*>(qApp)->getConfig().getMaxSHSize()*1024*1024;
 
     QPoint Point (0, 0);
     QTextCursor start = textEdit->cursorForPosition (Point);
     Point = QPoint (textEdit->geometry().width(), textEdit->geometry().height());
     QTextCursor end = textEdit->cursorForPosition (Point);
 
-    Highlighter *highlighter = new Highlighter (textEdit->document(), progLan, start, end, textEdit->hasDarkScheme());
+    Highlighter *highlighter = new Highlighter (textEdit->document(), progLan, start, end, textEdit->hasDarkScheme(), lazy);
     textEdit->setHighlighter (highlighter);
 
     QCoreApplication::processEvents(); // it's necessary to wait until the text is completely loaded
@@ -44,13 +44,24 @@ TabPage::TabPage (ICONMODE iconMode, int bgColorValue, QWidget *parent) : QWidge
         break;
     }
 
+    progressBar_ = new QProgressBar (this);
+    progressBar_->setRange (0, 100);
+    progressBar_->setMaximumHeight (progressBar_->fontMetrics().height());
+    progressBar_->hide();
+
     QGridLayout *mainGrid = new QGridLayout (this);
     mainGrid->setVerticalSpacing (4);
     mainGrid->setContentsMargins (0, 0, 0, 0);
     mainGrid->addWidget (textEdit_, 0, 0);
-    mainGrid->addWidget (searchBar_, 1, 0);
+    mainGrid->addWidget (progressBar_, 1, 0);
+    mainGrid->addWidget (searchBar_, 2, 0);
     setLayout (mainGrid);
 
+    connect (textEdit_, &TextEdit::loadingProgress, progressBar_, [this] (int percent) {
+        progressBar_->setValue (percent);
+        progressBar_->setVisible (percent < 100);
+    });
+
     connect (searchBar_, &SearchBar::find, this, &TabPage::find);
     connect (searchBar_, &SearchBar::searchFlagChanged, this, &TabPage::searchFlagChanged);
 }
@@ -95,6 +106,16 @@ bool TabPage::matchWhole() const
     return searchBar_->matchWhole();
 }
 /*************************/
+bool TabPage::matchRegex() const
+{
+    return searchBar_->matchRegex();
+}
+/*************************/
+void TabPage::setMatchInfo (const QString &info)
+{
+    searchBar_->setMatchInfo (info);
+}
+/*************************/
 void TabPage::disableShortcuts (bool disable)
 {
     searchBar_->disableShortcuts (disable);
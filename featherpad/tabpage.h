@@ -19,6 +19,7 @@
 #define TABPAGE_H
 
 #include <QPointer>
+#include <QProgressBar>
 #include "searchbar.h"
 #include "textedit.h"
 #include "utils.h"
@@ -45,6 +46,9 @@ public:
 
     bool matchCase() const;
     bool matchWhole() const;
+    bool matchRegex() const;
+
+    void setMatchInfo (const QString &info);
 
     void disableShortcuts (bool disable);
 
@@ -55,6 +59,7 @@ signals:
 private:
     QPointer<TextEdit> textEdit_;
     QPointer<SearchBar> searchBar_;
+    QProgressBar *progressBar_; // shown while a huge file is being loaded
 };
 
 }
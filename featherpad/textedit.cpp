@@ -17,6 +17,9 @@
 
 #include "textedit.h"
 #include "vscrollbar.h"
+#include "largefile.h"
+#include "findall.h"
+#include "matchcache.h"
 
 namespace FeatherPad {
 
@@ -75,26 +78,62 @@ TextEdit::TextEdit (QWidget *parent, int bgColorValue) : QPlainTextEdit (parent)
 
     resizeTimerId = 0;
     updateTimerId = 0;
+    chunkTimerId = 0;
     Dy = 0;
     size_ = 0;
     wordNumber_ = -1; // not calculated yet
     encoding_= "UTF-8";
     highlighter_ = nullptr;
+    streaming_ = false;
+    readOnlyAfterLoading_ = false;
+    largeFile_ = nullptr;
+    firstLine_ = 0;
+    shiftPending_ = false;
+    snapshotValid_ = false;
+    textRevision_ = 0;
     setFrameShape (QFrame::NoFrame);
     /* first we replace the widget's vertical scrollbar with ours because
        we want faster wheel scrolling when the mouse cursor is on the scrollbar */
     VScrollBar *vScrollBar = new VScrollBar;
     setVerticalScrollBar (vScrollBar);
+    connect (vScrollBar, &QAbstractSlider::valueChanged, this, &TextEdit::scrollLargeFile);
 
     lineNumberArea = new LineNumberArea (this);
     lineNumberArea->hide();
 
     connect (this, &QPlainTextEdit::updateRequest, this, &TextEdit::onUpdateRequesting);
+    /* syntax highlighting doesn't emit this signal; only real changes do */
+    connect (document(), &QTextDocument::contentsChanged, this, [this] {
+        snapshot_.clear();
+        snapshotValid_ = false;
+        ++textRevision_;
+    });
+
+    matchCache_ = new MatchCache (document());
+    connect (document(), &QTextDocument::contentsChange, this, [this] (int position, int charsRemoved, int charsAdded) {
+        if (matchCache_)
+            matchCache_->contentsChange (position, charsRemoved, charsAdded);
+    });
+
+    findAll_ = new FindAll (this);
+}
+/*************************/
+const QString &TextEdit::plainTextSnapshot()
+{
+    if (!snapshotValid_)
+    {
+        snapshot_ = document()->toPlainText();
+        snapshotValid_ = true;
+    }
+    return snapshot_;
 }
 /*************************/
 TextEdit::~TextEdit()
 {
     delete lineNumberArea;
+    delete matchCache_; matchCache_ = nullptr;
+    findAll_->cancel(); // the worker may be searching the huge file
+    delete largeFile_;
 }
 /*************************/
 void TextEdit::showLineNumbers (bool show)
@@ -128,7 +167,7 @@ void TextEdit::showLineNumbers (bool show)
 int TextEdit::lineNumberAreaWidth()
 {
     int digits = 1;
-    int max = qMax (1, blockCount());
+    qint64 max = qMax (static_cast<qint64>(1), totalLineCount());
     while (max >= 10) {
         max /= 10;
         ++digits;
@@ -376,6 +415,67 @@ void TextEdit::timerEvent (QTimerEvent *e)
            updateRequest() provides after 50ms may be null */
         emit updateRect (rect(), Dy);
     }
+    else if (e->timerId() == chunkTimerId)
+    {
+        /* append as many chunks as possible in about 30 ms (but at least one),
+           so that the text can be scrolled while the rest of it is coming */
+        QElapsedTimer timer;
+        timer.start();
+        QTextCursor cur (document());
+        cur.movePosition (QTextCursor::End);
+        int progress = -1;
+        while (!pendingChunks_.isEmpty() && (progress == -1 || timer.elapsed() < 30))
+        {
+            QPair<QString, int> chunk = pendingChunks_.takeFirst();
+            cur.insertText (chunk.first);
+            progress = chunk.second;
+        }
+        /* without undo/redo, appending text makes the document modified */
+        document()->setModified (false);
+        emit loadingProgress (progress);
+
+        if (pendingChunks_.isEmpty())
+        {
+            killTimer (chunkTimerId);
+            chunkTimerId = 0;
+            if (progress >= 100)
+            {
+                streaming_ = false;
+                document()->setUndoRedoEnabled (true);
+                document()->setModified (false);
+                setReadOnly (readOnlyAfterLoading_);
+                emit streamingFinished();
+            }
+        }
+    }
+}
+/*************************/
+void TextEdit::appendChunk (const QString& chunk, int progress)
+{
+    if (!streaming_)
+    { // the first chunk is set by setPlainText()
+        streaming_ = true;
+        readOnlyAfterLoading_ = isReadOnly();
+        setReadOnly (true);
+        document()->setUndoRedoEnabled (false);
+    }
+    pendingChunks_.append (qMakePair (chunk, progress));
+    if (chunkTimerId == 0)
+        chunkTimerId = startTimer (0);
+}
+/*************************/
+void TextEdit::discardChunks()
+{
+    if (!streaming_)
+    {
+        streaming_ = true;
+        readOnlyAfterLoading_ = isReadOnly();
+        setReadOnly (true);
+        document()->setUndoRedoEnabled (false);
+    }
+    pendingChunks_.clear();
+    setPlainText (QString());
+    document()->setModified (false);
 }
 /*************************/
 void TextEdit::highlightCurrentLine()
@@ -410,7 +510,7 @@ void TextEdit::lineNumberAreaPaintEvent (QPaintEvent *event)
     {
         if (block.isVisible() && bottom >= event->rect().top())
         {
-            QString number = QString::number (blockNumber + 1);
+            QString number = QString::number (firstLine_ + blockNumber + 1);
             painter.setPen (darkScheme ? Qt::black : Qt::white);
             painter.drawText (0, top, lineNumberArea->width() - 2, fontMetrics().height(),
                               Qt::AlignRight, number);
@@ -423,6 +523,125 @@ void TextEdit::lineNumberAreaPaintEvent (QPaintEvent *event)
     }
 }
 /*************************/
+void TextEdit::setLargeFile (LargeFile *largeFile)
+{
+    if (largeFile_ == largeFile) return;
+    findAll_->cancel();
+    delete largeFile_;
+    largeFile_ = largeFile;
+    firstLine_ = 0;
+}
+/*************************/
+qint64 TextEdit::totalLineCount() const
+{
+    if (largeFile_)
+        return largeFile_->lineCount();
+    return blockCount();
+}
+/*************************/
+void TextEdit::loadLargeFileWindow (qint64 first)
+{
+    first = qBound (static_cast<qint64>(0), first, largeFile_->lastPageStart());
+    firstLine_ = first;
+    shiftPending_ = true; // no shifting while the text is being set
+    setPlainText (largeFile_->text (first, LargeFile::windowLines));
+    shiftPending_ = false;
+    lineNumberArea->update();
+}
+/*************************/
+// Show a line of the huge file (and select a text there),
+// while loading its page if it isn't already loaded.
+void TextEdit::showLargeFileLine (qint64 line, int column, int length)
+{
+    if (!largeFile_) return;
+    line = qBound (static_cast<qint64>(0), line, largeFile_->lineCount() - 1);
+    const int margin = 100; // lines near the page edges
+    if (line < firstLine_ || line >= firstLine_ + blockCount()
+        || (firstLine_ > 0 && line < firstLine_ + margin)
+        || (firstLine_ + blockCount() < largeFile_->lineCount() && line >= firstLine_ + blockCount() - margin))
+    {
+        loadLargeFileWindow (largeFile_->pageStart (line));
+    }
+    QTextBlock block = document()->findBlockByNumber (static_cast<int>(line - firstLine_));
+    QTextCursor cur (block);
+    int pos = block.position() + qMin (column, block.length() - 1);
+    cur.setPosition (pos);
+    if (length > 0)
+        cur.setPosition (qMin (pos + length, document()->characterCount() - 1), QTextCursor::KeepAnchor);
+    setTextCursor (cur);
+}
+/*************************/
+bool TextEdit::findInLargeFile (const QString& str, QTextDocument::FindFlags flags)
+{
+    if (!largeFile_ || str.isEmpty()) return false;
+
+    bool forward = !(flags & QTextDocument::FindBackward);
+    Qt::CaseSensitivity cs = (flags & QTextDocument::FindCaseSensitively)
+                             ? Qt::CaseSensitive : Qt::CaseInsensitive;
+    bool wholeWords = (flags & QTextDocument::FindWholeWords);
+
+    QTextCursor cur = textCursor();
+    int pos = forward ? cur.selectionEnd() : cur.selectionStart();
+    QTextBlock block = document()->findBlock (pos);
+    qint64 line = firstLine_ + block.blockNumber();
+    int column = pos - block.position();
+    if (!largeFile_->find (str, line, column, forward, cs, wholeWords))
+    { // search from the start or end of the file
+        if (forward)
+        {
+            line = 0;
+            column = 0;
+        }
+        else
+        {
+            line = largeFile_->lineCount() - 1;
+            column = largeFile_->text (line, 1).length();
+        }
+        if (!largeFile_->find (str, line, column, forward, cs, wholeWords))
+            return false;
+    }
+    showLargeFileLine (line, column, str.length());
+    return true;
+}
+/*************************/
+// Change the page of the huge file when an edge of the current page is reached.
+void TextEdit::scrollLargeFile (int value)
+{
+    if (!largeFile_ || shiftPending_) return;
+    QScrollBar *vbar = verticalScrollBar();
+    if ((value == vbar->maximum() && firstLine_ + blockCount() < largeFile_->lineCount())
+        || (value == vbar->minimum() && firstLine_ > 0))
+    {
+        shiftPending_ = true;
+        QTimer::singleShot (0, this, SLOT (shiftLargeFileWindow()));
+    }
+}
+/*************************/
+void TextEdit::shiftLargeFileWindow()
+{
+    shiftPending_ = false;
+    if (!largeFile_) return;
+
+    /* keep the first visible line and the cursor where they are */
+    qint64 topLine = firstLine_ + firstVisibleBlock().blockNumber();
+    QTextCursor cur = textCursor();
+    qint64 curLine = firstLine_ + cur.blockNumber();
+    int curColumn = cur.positionInBlock();
+
+    loadLargeFileWindow (largeFile_->pageStart (topLine));
+
+    if (curLine >= firstLine_ && curLine < firstLine_ + blockCount())
+    {
+        QTextBlock block = document()->findBlockByNumber (static_cast<int>(curLine - firstLine_));
+        cur = QTextCursor (block);
+        cur.setPosition (block.position() + qMin (curColumn, block.length() - 1));
+    }
+    else
+        cur = QTextCursor (document()->findBlockByNumber (static_cast<int>(topLine - firstLine_)));
+    QPlainTextEdit::setTextCursor (cur);
+    verticalScrollBar()->setValue (static_cast<int>(topLine - firstLine_));
+}
+/*************************/
 void TextEdit::updateEditorGeometry()
 {
     updateGeometry();
@@ -23,6 +23,10 @@
 
 namespace FeatherPad {
 
+class LargeFile;
+class FindAll;
+class MatchCache;
+
 /* This is for auto-indentation, line numbers, DnD, zooming, customized
    vertical scrollbar, appropriate signals, and saving/getting useful info. */
 class TextEdit : public QPlainTextEdit
@@ -65,6 +69,13 @@ public:
 
     void zooming (float range);
 
+    /* the plain text of the document for searching (made only once after each change) */
+    const QString &plainTextSnapshot();
+    /* changes with every change of the text (the undo stack may be disabled) */
+    int textRevision() const {
+        return textRevision_;
+    }
+
     qint64 getSize() const {
         return size_;
     }
@@ -134,6 +145,39 @@ public:
         highlighter_ = h;
     }
 
+    /* for the progressive loading of huge files */
+    void appendChunk (const QString& chunk, int progress);
+    /* removes the received text (and the waiting chunks) when it should be received again */
+    void discardChunks();
+    bool isStreaming() const {
+        return streaming_;
+    }
+    void setReadOnlyAfterLoading (bool readOnly) {
+        readOnlyAfterLoading_ = readOnly;
+    }
+
+    /* for the read-only paged viewer of files that are too large for a document */
+    void setLargeFile (LargeFile *largeFile); // takes the ownership
+    LargeFile *getLargeFile() const {
+        return largeFile_;
+    }
+    qint64 totalLineCount() const;
+    void showLargeFileLine (qint64 line, int column = 0, int length = 0);
+    bool findInLargeFile (const QString& str, QTextDocument::FindFlags flags);
+    qint64 getFirstLine() const {
+        return firstLine_;
+    }
+
+    /* the matches of the searched text in the parts of the document that have been visible */
+    MatchCache *getMatchCache() const {
+        return matchCache_;
+    }
+
+    /* for finding all matches in the background */
+    FindAll *getFindAll() const {
+        return findAll_;
+    }
+
 signals:
     /* inform the main widget */
     void fileDropped (const QString& localFile,
@@ -141,6 +185,8 @@ signals:
     void resized(); // needed by syntax highlighting
     void updateRect (const QRect &rect, int dy);
     void zoomedOut (TextEdit *textEdit); // needed for reformatting text
+    void loadingProgress (int percent);
+    void streamingFinished();
 
 protected:
     void keyPressEvent (QKeyEvent *event);
@@ -176,9 +222,12 @@ private slots:
     void highlightCurrentLine();
     void updateLineNumberArea (const QRect&, int);
     void onUpdateRequesting (const QRect&, int dy);
+    void scrollLargeFile (int value);
+    void shiftLargeFileWindow();
 
 private:
     QString computeIndentation (QTextCursor& cur) const;
+    void loadLargeFileWindow (qint64 first);
 
     QWidget *lineNumberArea;
     QTextEdit::ExtraSelection currentLine;
@@ -187,6 +236,7 @@ private:
     bool darkScheme;
     QColor lineHColor;
     int resizeTimerId, updateTimerId; // for not wasting CPU's time
+    int chunkTimerId; // for appending text chunks in time slices
     int Dy;
     /********************************************
      ***** All needed information on a page *****
@@ -194,6 +244,9 @@ private:
     qint64 size_; // file size for limiting syntax highlighting (the file may be removed)
     int wordNumber_; // the calculated number of words (-1 if not counted yet)
     QString searchedText_; // the text that is being searched in the documnet
+    QString snapshot_; // the plain text of the document (for searching)
+    bool snapshotValid_; // Is the plain text up to date?
+    int textRevision_; // the number of text changes (for knowing if a search result is still valid)
     QString replaceTitle_; // the title of the Replacement dock (can change)
     QString fileName_; // opened file
     QString prog_; // programming language (for syntax highlighting)
@@ -207,6 +260,14 @@ private:
     QList<QTextEdit::ExtraSelection> greenSel_; // for replaced matches
     QList<QTextEdit::ExtraSelection> redSel_; // for bracket matches
     QSyntaxHighlighter *highlighter_; // // syntax highlighter
+    QList<QPair<QString, int> > pendingChunks_; // text chunks that wait to be appended (with progress)
+    bool streaming_; // Are text chunks being appended?
+    bool readOnlyAfterLoading_; // the read-only state after all chunks are appended
+    LargeFile *largeFile_; // a huge file whose lines are shown page by page
+    qint64 firstLine_; // the line number of the first block in the paged viewer
+    bool shiftPending_; // Is the page of the huge file going to change?
+    FindAll *findAll_; // finds all matches of the searched text in the background
+    MatchCache *matchCache_; // for highlighting the matches without searching on scrolling
 };
 /*************************/
 class LineNumberArea : public QWidget
@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014 <tsujan2000@gmail.com>
+ *
+ * FeatherPad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FeatherPad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "textfinder.h"
+
+namespace FeatherPad {
+
+TextFinder::TextFinder (const QString &str, Qt::CaseSensitivity cs, bool wholeWords) :
+    cs_ (cs),
+    wholeWords_ (wholeWords)
+{
+    /* QTextDocument::toPlainText() has spaces instead of nbsp */
+    needle_ = str;
+    needle_.replace (QChar::Nbsp, QLatin1Char (' '));
+    if (cs_ == Qt::CaseInsensitive)
+    {
+        ushort *d = reinterpret_cast<ushort*>(needle_.data());
+        for (int i = 0; i < needle_.length(); ++i)
+            d[i] = fold (d[i]);
+    }
+
+    /* the shifts of Horspool's algorithm (the low bytes may be shared by characters) */
+    const int n = needle_.length();
+    const ushort *N = needle_.utf16();
+    for (int i = 0; i < 256; ++i)
+    {
+        forwardShift_[i] = n;
+        backwardShift_[i] = n;
+    }
+    for (int i = 0; i < n - 1; ++i)
+        forwardShift_[N[i] & 0xff] = n - 1 - i;
+    for (int i = n - 1; i > 0; --i)
+        backwardShift_[N[i] & 0xff] = i;
+}
+/*************************/
+bool TextFinder::matchesAt (const QString &text, int pos) const
+{
+    const ushort *T = text.utf16() + pos;
+    const ushort *N = needle_.utf16();
+    const int n = needle_.length();
+    for (int i = 0; i < n; ++i)
+    {
+        if (fold (T[i]) != N[i])
+            return false;
+    }
+    return true;
+}
+/*************************/
+bool TextFinder::isWholeWord (const QString &text, int pos) const
+{
+    if (!wholeWords_) return true;
+    const int end = pos + needle_.length();
+    return (pos == 0 || !text.at (pos - 1).isLetterOrNumber())
+           && (end == text.length() || !text.at (end).isLetterOrNumber());
+}
+/*************************/
+int TextFinder::findForward (const QString &text, int from, int end) const
+{
+    const int n = needle_.length();
+    if (n == 0) return -1;
+    from = qMax (from, 0);
+    int last = text.length() - n; // the last possible start
+    if (end >= 0)
+        last = qMin (last, end - 1);
+
+    if (n == 1)
+    {
+        const QChar c (needle_.at (0));
+        int i = from;
+        while (i <= last && (i = text.indexOf (c, i, cs_)) != -1 && i <= last)
+        {
+            if (isWholeWord (text, i))
+                return i;
+            ++i;
+        }
+        return -1;
+    }
+
+    const ushort *T = text.utf16();
+    const ushort lastChar = needle_.at (n - 1).unicode();
+    int i = from;
+    while (i <= last)
+    {
+        const ushort c = fold (T[i + n - 1]);
+        if (c == lastChar && matchesAt (text, i) && isWholeWord (text, i))
+            return i;
+        i += forwardShift_[c & 0xff];
+    }
+    return -1;
+}
+/*************************/
+int TextFinder::findBackward (const QString &text, int from) const
+{
+    const int n = needle_.length();
+    if (n == 0) return -1;
+    int i = qMin (from, text.length() - n);
+
+    if (n == 1)
+    {
+        const QChar c (needle_.at (0));
+        while (i >= 0 && (i = text.lastIndexOf (c, i, cs_)) != -1)
+        {
+            if (isWholeWord (text, i))
+                return i;
+            --i;
+        }
+        return -1;
+    }
+
+    const ushort *T = text.utf16();
+    const ushort firstChar = needle_.at (0).unicode();
+    while (i >= 0)
+    {
+        const ushort c = fold (T[i]);
+        if (c == firstChar && matchesAt (text, i) && isWholeWord (text, i))
+            return i;
+        i -= backwardShift_[c & 0xff];
+    }
+    return -1;
+}
+
+}
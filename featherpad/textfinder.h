@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014 <tsujan2000@gmail.com>
+ *
+ * FeatherPad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FeatherPad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TEXTFINDER_H
+#define TEXTFINDER_H
+
+#include <QString>
+
+namespace FeatherPad {
+
+/* Searches for a literal string in a plain text (usually, the snapshot
+   of a document, where blocks are separated by newlines). Needles with
+   newlines are found like other needles. With Horspool's algorithm, the
+   text is scanned with jumps, whose length is nearly the needle's length
+   when the needle is long. For a one-character needle, QString's
+   vectorized character search is used instead. */
+class TextFinder
+{
+public:
+    TextFinder (const QString &str, Qt::CaseSensitivity cs, bool wholeWords);
+
+    /* The start of the first match that starts at or after "from",
+       or -1. If "end" isn't negative, matches should start before it. */
+    int findForward (const QString &text, int from, int end = -1) const;
+    /* The start of the last match that starts at or before "from", or -1. */
+    int findBackward (const QString &text, int from) const;
+
+    int length() const {
+        return needle_.length();
+    }
+
+private:
+    ushort fold (ushort c) const {
+        if (cs_ == Qt::CaseSensitive)
+            return c;
+        if (c < 128)
+            return c >= 'A' && c <= 'Z' ? static_cast<ushort>(c + 32) : c;
+        return QChar::toCaseFolded (c);
+    }
+    bool matchesAt (const QString &text, int pos) const;
+    bool isWholeWord (const QString &text, int pos) const;
+
+    QString needle_; // case folded if the search is case insensitive
+    Qt::CaseSensitivity cs_;
+    bool wholeWords_;
+    int forwardShift_[256]; // by the low byte of the last character of the window
+    int backwardShift_[256]; // by the low byte of the first character of the window
+};
+
+}
+
+#endif // TEXTFINDER_H
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014 <tsujan2000@gmail.com>
+ *
+ * FeatherPad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FeatherPad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "textwriter.h"
+#include <QTextDocument>
+#include <QTextBlock>
+#include <QTextCodec>
+#include <QSaveFile>
+
+namespace FeatherPad {
+
+bool writeDocument (const QTextDocument *doc, const QString& fileName,
+                    QTextCodec *codec, bool windowsEol)
+{
+    if (!doc || !codec) return false;
+
+    QSaveFile file (fileName);
+    /* if a temporary file can't be made in the folder of a writable file */
+    file.setDirectWriteFallback (true);
+    if (!file.open (QIODevice::WriteOnly))
+        return false;
+
+    const int bufferSize = 256*1024;
+    const QString eol = windowsEol ? QStringLiteral ("\r\n") : QStringLiteral ("\n");
+    QTextEncoder *encoder = codec->makeEncoder(); // keeps the state (and writes BOM once)
+    QByteArray buffer;
+    buffer.reserve (bufferSize + 4096);
+    bool success = true;
+    QTextBlock block = doc->firstBlock();
+    while (block.isValid())
+    {
+        /* do what QTextDocument::toPlainText() does */
+        QString text = block.text();
+        QChar *c = text.data();
+        const QChar *end = c + text.size();
+        bool hasSeparator = false;
+        for (; c < end; ++c)
+        {
+            if (*c == QChar::Nbsp)
+                *c = QLatin1Char (' ');
+            else if (*c == QChar::LineSeparator || *c == QChar::ParagraphSeparator)
+            {
+                *c = QLatin1Char ('\n');
+                hasSeparator = true;
+            }
+        }
+        if (hasSeparator && windowsEol)
+            text.replace (QLatin1Char ('\n'), eol);
+
+        block = block.next();
+        if (block.isValid())
+            text += eol;
+
+        buffer += encoder->fromUnicode (text);
+        if (buffer.size() >= bufferSize || !block.isValid())
+        {
+            if (file.write (buffer) != buffer.size())
+            {
+                success = false;
+                break;
+            }
+            buffer.resize (0);
+        }
+    }
+    delete encoder;
+
+    if (!success)
+    {
+        file.cancelWriting();
+        return false;
+    }
+    return file.commit(); // flushes, syncs and renames
+}
+
+}
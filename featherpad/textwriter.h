@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014 <tsujan2000@gmail.com>
+ *
+ * FeatherPad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FeatherPad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef TEXTWRITER_H
+#define TEXTWRITER_H
+
+#include <QString>
+
+class QTextDocument;
+class QTextCodec;
+
+namespace FeatherPad {
+
+/* Writes the plain text of a document block by block, so that the whole
+   text isn't copied in memory. The file is written to a temporary file
+   that replaces the original one only when everything is written. */
+bool writeDocument (const QTextDocument *doc, const QString& fileName,
+                    QTextCodec *codec, bool windowsEol = false);
+
+}
+
+#endif // TEXTWRITER_H
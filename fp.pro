@@ -1,5 +1,8 @@
 SUBDIRS += featherpad
 
+# "make check" runs the tests
+qtHaveModule(testlib): SUBDIRS += tests
+
 TEMPLATE = subdirs 
 
 CONFIG += qt \
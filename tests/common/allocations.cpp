@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014 <tsujan2000@gmail.com>
+ *
+ * FeatherPad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FeatherPad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "allocations.h"
+#include <atomic>
+#include <cstddef>
+#if defined(__GLIBC__)
+#include <malloc.h> // malloc_usable_size
+#endif
+
+/* the counters are zero-initialized before any allocation */
+static std::atomic<long long> allocationCount (0);
+static std::atomic<long long> allocationBytes (0);
+static std::atomic<long long> liveBytes (0);
+
+#if defined(__GLIBC__)
+extern "C" {
+void *__libc_malloc (size_t size);
+void *__libc_calloc (size_t num, size_t size);
+void *__libc_realloc (void *ptr, size_t size);
+void __libc_free (void *ptr);
+
+static inline void *counted (void *p, size_t size, size_t oldUsable)
+{
+    allocationCount.fetch_add (1, std::memory_order_relaxed);
+    allocationBytes.fetch_add (static_cast<long long>(size), std::memory_order_relaxed);
+    if (p != nullptr)
+    {
+        liveBytes.fetch_add (static_cast<long long>(malloc_usable_size (p))
+                             - static_cast<long long>(oldUsable),
+                             std::memory_order_relaxed);
+    }
+    return p;
+}
+
+/* these replace the functions of the C library for the whole process */
+void *malloc (size_t size) noexcept
+{
+    return counted (__libc_malloc (size), size, 0);
+}
+
+void *calloc (size_t num, size_t size) noexcept
+{
+    return counted (__libc_calloc (num, size), num * size, 0);
+}
+
+void *realloc (void *ptr, size_t size) noexcept
+{
+    const size_t oldUsable = ptr != nullptr ? malloc_usable_size (ptr) : 0;
+    void *p = __libc_realloc (ptr, size);
+    if (p == nullptr && ptr != nullptr && size == 0) // freed
+        liveBytes.fetch_sub (static_cast<long long>(oldUsable), std::memory_order_relaxed);
+    return counted (p, size, p != nullptr ? oldUsable : 0);
+}
+
+void free (void *ptr) noexcept
+{
+    if (ptr != nullptr)
+        liveBytes.fetch_sub (static_cast<long long>(malloc_usable_size (ptr)), std::memory_order_relaxed);
+    __libc_free (ptr);
+}
+}
+#endif
+
+namespace FeatherPad {
+
+Allocations allocationsSoFar()
+{
+    Allocations res;
+    res.count = allocationCount.load (std::memory_order_relaxed);
+    res.bytes = allocationBytes.load (std::memory_order_relaxed);
+    res.liveBytes = liveBytes.load (std::memory_order_relaxed);
+    return res;
+}
+/*************************/
+bool countsAllocations()
+{
+#if defined(__GLIBC__)
+    return true;
+#else
+    return false;
+#endif
+}
+
+}
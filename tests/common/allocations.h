@@ -0,0 +1,40 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014 <tsujan2000@gmail.com>
+ *
+ * FeatherPad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FeatherPad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ALLOCATIONS_H
+#define ALLOCATIONS_H
+
+namespace FeatherPad {
+
+/* The number and total size of the heap allocations made by the test process
+   so far (by malloc, calloc and realloc, which also serve operator new), and the
+   usable size of the heap blocks that are in use. They are counted only with glibc,
+   where malloc can be interposed; otherwise, they remain zero and "countsAllocations()"
+   returns false. */
+struct Allocations
+{
+    long long count;
+    long long bytes;
+    long long liveBytes;
+};
+
+Allocations allocationsSoFar();
+bool countsAllocations();
+
+}
+
+#endif // ALLOCATIONS_H
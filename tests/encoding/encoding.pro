@@ -0,0 +1,17 @@
+CONFIG += qt \
+          warn_on \
+          testcase
+QT += core \
+      testlib
+
+TARGET = tst_encoding
+TEMPLATE = app
+CONFIG += c++11
+
+SRCDIR = ../../featherpad
+INCLUDEPATH += $$SRCDIR
+
+SOURCES += tst_encoding.cpp \
+           $$SRCDIR/encoding.cpp
+
+HEADERS += $$SRCDIR/encoding.h
@@ -0,0 +1,179 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014 <tsujan2000@gmail.com>
+ *
+ * FeatherPad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FeatherPad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QtTest>
+#include <QElapsedTimer>
+#include "encoding.h"
+
+/* The benchmarks are skipped unless FEATHERPAD_BENCHMARKS is set.
+   They print their results with qDebug(). */
+
+namespace FeatherPad {
+
+class TestEncoding : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void utf8Scan_data();
+    void utf8Scan();
+};
+
+/* validateUTF8() as it was before scanBytes(): one code point at a time, up to a null byte */
+static bool oldValidateUTF8 (const QByteArray &byteArray)
+{
+    const unsigned char *bytes = reinterpret_cast<const unsigned char*>(byteArray.constData());
+    unsigned int cp;
+    int bn;
+    while (*bytes != 0x00)
+    {
+        if ((*bytes & 0x80) == 0x00)
+        {
+            cp = (*bytes & 0x7F);
+            bn = 1;
+        }
+        else if ((*bytes & 0xE0) == 0xC0)
+        {
+            cp = (*bytes & 0x1F);
+            bn = 2;
+        }
+        else if ((*bytes & 0xF0) == 0xE0)
+        {
+            cp = (*bytes & 0x0F);
+            bn = 3;
+        }
+        else if ((*bytes & 0xF8) == 0xF0)
+        {
+            cp = (*bytes & 0x07);
+            bn = 4;
+        }
+        else
+            return false;
+
+        bytes += 1;
+        for (int i = 1; i < bn; ++i)
+        {
+            if ((*bytes & 0xC0) != 0x80)
+                return false;
+            cp = (cp << 6) | (*bytes & 0x3F);
+            bytes += 1;
+        }
+
+        if (cp > 0x10FFFF
+            || (cp >= 0xD800 && cp <= 0xDFFF)
+            || (cp <= 0x007F && bn != 1)
+            || (cp >= 0x0080 && cp <= 0x07FF && bn != 2)
+            || (cp >= 0x0800 && cp <= 0xFFFF && bn != 3)
+            || (cp >= 0x10000 && cp <= 0x1FFFFF && bn != 4))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+/*************************/
+/* the second walk of the old detectCharset() over a valid UTF-8 text,
+   which looked for non-ASCII bytes and ESC sequences */
+static bool oldHasNonAscii (const QByteArray &byteArray, bool &hasEscape)
+{
+    const char *text = byteArray.constData();
+    uchar c;
+    hasEscape = false;
+    while ((c = *text++) != '\0')
+    {
+        if (c > 0x7F)
+            return true;
+        if (c == 0x1B)
+            hasEscape = true;
+    }
+    return false;
+}
+/*************************/
+// About "size" bytes of lines, in which every "period"-th word is "nonAscii".
+static QByteArray makeText (int size, const QByteArray &nonAscii, int period)
+{
+    QByteArray text;
+    text.reserve (size + 100);
+    int n = 0;
+    while (text.size() < size)
+    {
+        text += ++n % period == 0 ? nonAscii : QByteArray ("word");
+        text += n % 12 == 0 ? '\n' : ' ';
+    }
+    return text;
+}
+/*************************/
+void TestEncoding::utf8Scan_data()
+{
+    QTest::addColumn<QByteArray>("nonAscii");
+    QTest::addColumn<int>("period");
+    QTest::addColumn<bool>("validUTF8");
+
+    QTest::newRow ("ASCII") << QByteArray() << 0x7FFFFFFF << true;
+    QTest::newRow ("mixed UTF-8") << QByteArray ("caf\xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80") << 20 << true;
+    QTest::newRow ("Latin-1") << QByteArray ("caf\xe9") << 20 << false;
+}
+/*************************/
+// The old validation and walk of detectCharset() in comparison with scanBytes(), best of three runs.
+void TestEncoding::utf8Scan()
+{
+    if (!qEnvironmentVariableIsSet ("FEATHERPAD_BENCHMARKS"))
+        QSKIP ("Set FEATHERPAD_BENCHMARKS to run the benchmarks.");
+
+    QFETCH (QByteArray, nonAscii);
+    QFETCH (int, period);
+    QFETCH (bool, validUTF8);
+
+    const QByteArray text = makeText (64*1024*1024, nonAscii, period);
+
+    QElapsedTimer timer;
+    qint64 oldNsecs = -1, newNsecs = -1;
+    for (int i = 0; i < 3; ++i)
+    {
+        timer.start();
+        const bool valid = oldValidateUTF8 (text);
+        bool hasEscape = false;
+        if (valid)
+            oldHasNonAscii (text, hasEscape);
+        qint64 nsecs = timer.nsecsElapsed();
+        if (oldNsecs < 0 || nsecs < oldNsecs)
+            oldNsecs = nsecs;
+        QCOMPARE (valid, validUTF8);
+
+        timer.restart();
+        const CharsetInfo info = scanBytes (text.constData(), text.size());
+        nsecs = timer.nsecsElapsed();
+        if (newNsecs < 0 || nsecs < newNsecs)
+            newNsecs = nsecs;
+        QCOMPARE (info.validUTF8, validUTF8);
+        QCOMPARE (info.nullPos, static_cast<qint64>(-1));
+    }
+
+    const double mib = static_cast<double>(text.size()) / (1024*1024);
+    qDebug ("%s: old functions %.0f MiB/s, scanBytes() %.0f MiB/s",
+            QTest::currentDataTag(),
+            mib * 1e9 / qMax (oldNsecs, static_cast<qint64>(1)),
+            mib * 1e9 / qMax (newNsecs, static_cast<qint64>(1)));
+    if (!validUTF8)
+        qDebug ("(the old validation stops at the first invalid byte but scanBytes() goes on for null bytes and ESC)");
+}
+
+}
+
+QTEST_GUILESS_MAIN (FeatherPad::TestEncoding)
+
+#include "tst_encoding.moc"
@@ -0,0 +1,31 @@
+# A small sample of CMake for the highlighter tests.
+cmake_minimum_required(VERSION 3.1)
+project(Sample LANGUAGES CXX)
+
+set(CMAKE_CXX_STANDARD 11)
+set(CMAKE_AUTOMOC ON)
+option(WITH_TESTS "Build the tests" OFF)
+
+find_package(Qt5 COMPONENTS Core Gui Widgets REQUIRED)
+
+set(SOURCES
+    main.cpp
+    window.cpp # the main window
+)
+
+if(WITH_TESTS AND NOT CMAKE_CROSSCOMPILING)
+    enable_testing()
+    add_subdirectory(tests)
+elseif(UNIX)
+    message(STATUS "Tests are disabled on ${CMAKE_SYSTEM_NAME}")
+endif()
+
+add_executable(sample ${SOURCES})
+target_link_libraries(sample Qt5::Core Qt5::Gui Qt5::Widgets)
+target_compile_definitions(sample PRIVATE DATADIR="${CMAKE_INSTALL_PREFIX}/share")
+
+foreach(dir IN ITEMS data help)
+    install(DIRECTORY ${dir} DESTINATION share/sample)
+endforeach()
+
+install(TARGETS sample RUNTIME DESTINATION bin)
@@ -0,0 +1,49 @@
+/* A small sample of C++ for the highlighter tests.
+   It has a multiline comment, quotes, raw strings,
+   preprocessor lines, keywords and types. */
+
+#include <QString>
+#include "sample.h"
+
+#define SQUARE(x) ((x) * (x)) // a macro
+
+namespace Sample {
+
+static const char *greeting = "Hello, \"world\"!\n";
+static const char *path = R"(C:\some\path)";
+
+template <typename T>
+class Box
+{
+public:
+    explicit Box (const T &value) : value_ (value) {}
+    virtual ~Box() {}
+
+    const T &value() const {
+        return value_; // the stored value
+    }
+
+private:
+    T value_;
+};
+
+enum Color { red = 0x10, green = 020, blue = 3 };
+
+int count (const QString &str, QChar c)
+{
+    int n = 0;
+    for (int i = 0; i < str.length(); ++i)
+    {
+        if (str.at (i) == c && c != '\'')
+            ++n;
+    }
+    /* an unfinished
+       comment */ return n + SQUARE (2) + 1.5e3;
+}
+
+bool isEmpty (const Box<int> *box)
+{
+    return box == nullptr || box->value() == 0; // (unbalanced "quote in comment
+}
+
+}
@@ -0,0 +1,41 @@
+#!/usr/bin/env python3
+# A small sample of Python for the highlighter tests.
+
+"""A module docstring
+that spans several lines."""
+
+import os
+from collections import OrderedDict
+
+
+class Counter(object):
+    '''Counts words.'''
+
+    def __init__(self, words=None):
+        self.words = OrderedDict()
+        for w in words or []:
+            self.add(w)
+
+    def add(self, word):
+        if word in self.words:
+            self.words[word] += 1
+        else:
+            self.words[word] = 1
+        return self  # allows chaining
+
+    @property
+    def total(self):
+        return sum(self.words.values())
+
+
+def main():
+    path = os.path.join("a", 'b', r"c\d")
+    c = Counter(["x", "y", "x"])
+    print("%s: %d" % (path, c.total), 0x1F, 3.14, None, True)
+    text = '''triple "quoted"
+    text'''
+    return lambda x: x * 2 if x > 0 else -x
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,40 @@
+#!/bin/bash
+# A small sample of shell script for the highlighter tests.
+
+set -e
+
+NAME="world"
+COUNT=$((3 + 4))
+FILES=$(ls -1 /tmp | wc -l)
+
+greet() {
+    local who="$1"
+    echo "Hello, ${who}!" # a comment after a command
+    printf '%s\n' 'single $quoted'
+}
+
+if [ -n "$NAME" ] && [[ $COUNT -gt 5 ]]; then
+    greet "$NAME"
+elif test -z "$FILES"; then
+    exit 1
+else
+    echo `date`
+fi
+
+for f in *.txt; do
+    case "$f" in
+        a*) echo "starts with a" ;;
+        *) echo "other: $f" ;;
+    esac
+done
+
+cat <<EOT
+This is a "here" document.
+    $NAME is expanded here.
+EOT
+
+cat <<'EOF2' | grep -v x
+No $expansion here.
+EOF2
+
+while read -r line; do echo "$line"; done < /etc/hostname
@@ -0,0 +1,26 @@
+CONFIG += qt \
+          warn_on \
+          testcase
+QT += core gui \
+      concurrent \
+      testlib
+
+TARGET = tst_highlighter
+TEMPLATE = app
+CONFIG += c++11
+
+SRCDIR = ../../featherpad
+INCLUDEPATH += $$SRCDIR ../common
+DEFINES += TESTDATA=\\\"$$PWD/data\\\" GOLDEN=\\\"$$PWD/golden\\\"
+
+SOURCES += tst_highlighter.cpp \
+           ../common/allocations.cpp \
+           $$SRCDIR/highlighter.cpp \
+           $$SRCDIR/highlighter-sh.cpp \
+           $$SRCDIR/highlighter-html.cpp \
+           $$SRCDIR/highlighter-patterns.cpp \
+           $$SRCDIR/bracketindex.cpp
+
+HEADERS += ../common/allocations.h \
+           $$SRCDIR/highlighter.h \
+           $$SRCDIR/bracketindex.h
@@ -0,0 +1,563 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014 <tsujan2000@gmail.com>
+ *
+ * FeatherPad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FeatherPad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QtTest>
+#include <QGuiApplication>
+#include <QTextDocument>
+#include <QTextBlock>
+#include <QTextLayout>
+#include <QElapsedTimer>
+#include <QRegExp>
+#include <algorithm> // std::sort
+#include "highlighter.h"
+#include "allocations.h"
+
+/* Run by "make check" (or directly, without a display).
+
+   goldenFormats: Each sample of the "data" directory is highlighted completely and the
+   states, open nests and format ranges of its blocks are compared with a golden file of
+   the "golden" directory. If FEATHERPAD_UPDATE_GOLDEN is set, the golden files are
+   written instead; that should be done only when a change of the output is intended.
+   A sample without a golden file is reported as an expected failure.
+
+   The benchmarks are skipped unless FEATHERPAD_BENCHMARKS is set because they take time.
+   They print their results with qDebug(). */
+
+namespace FeatherPad {
+
+class TestHighlighter : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void goldenFormats_data();
+    void goldenFormats();
+    void highlightingCost_data();
+    void highlightingCost();
+    void keywordMatching_data();
+    void keywordMatching();
+    void ruleMatching_data();
+    void ruleMatching();
+    void blockMemory_data();
+    void blockMemory();
+
+private:
+    Highlighter *highlightAll (QTextDocument *doc, const QString &lang);
+    static bool isHighlighted (const Highlighter *highlighter);
+    void addSamples();
+    QStringList sampleLines (const QString &fileName, int minLines);
+};
+
+static QString readSample (const QString &fileName)
+{
+    QFile file (QString (TESTDATA) + "/" + fileName);
+    if (!file.open (QIODevice::ReadOnly)) return QString();
+    return QString::fromUtf8 (file.readAll());
+}
+/*************************/
+static bool benchmarksEnabled()
+{
+    return qEnvironmentVariableIsSet ("FEATHERPAD_BENCHMARKS");
+}
+/*************************/
+// Highlights the whole document as if it were visible and waits until it's done.
+Highlighter *TestHighlighter::highlightAll (QTextDocument *doc, const QString &lang)
+{
+    QTextCursor start (doc);
+    QTextCursor end (doc);
+    end.movePosition (QTextCursor::End);
+    Highlighter *highlighter = new Highlighter (doc, lang, start, end, false);
+    /* QSyntaxHighlighter rehighlights the document with a queued call, the highlighter
+       catches up with next blocks in time slices and its lexer may run in a thread */
+    QElapsedTimer timer;
+    timer.start();
+    while (!isHighlighted (highlighter) && timer.elapsed() < 60000)
+        QCoreApplication::processEvents();
+    return highlighter;
+}
+/*************************/
+bool TestHighlighter::isHighlighted (const Highlighter *highlighter)
+{
+    if (!highlighter->isIdle()) return false;
+    for (QTextBlock block = highlighter->document()->firstBlock(); block.isValid(); block = block.next())
+    {
+        const TextBlockData *data = static_cast<TextBlockData *>(block.userData());
+        if (!data || !data->isHighlighted())
+            return false;
+    }
+    return true;
+}
+/*************************/
+static QString formatToString (const QTextCharFormat &format)
+{
+    QString str;
+    if (format.hasProperty (QTextFormat::ForegroundBrush))
+        str += " fg=" + format.foreground().color().name (QColor::HexArgb);
+    if (format.hasProperty (QTextFormat::BackgroundBrush))
+        str += " bg=" + format.background().color().name (QColor::HexArgb);
+    if (format.hasProperty (QTextFormat::FontWeight) && format.fontWeight() >= QFont::Bold)
+        str += " bold";
+    if (format.fontItalic())
+        str += " italic";
+    if (format.fontUnderline())
+        str += " underline";
+    return str;
+}
+/*************************/
+// One line per block with its state and open nests, and one line per format range.
+static QStringList describeFormats (QTextDocument *doc)
+{
+    QStringList lines;
+    for (QTextBlock block = doc->firstBlock(); block.isValid(); block = block.next())
+    {
+        const TextBlockData *data = static_cast<TextBlockData *>(block.userData());
+        lines << QString ("block %1: state %2, nests %3")
+                 .arg (block.blockNumber() + 1)
+                 .arg (block.userState())
+                 .arg (data ? data->openNests() : 0);
+#if QT_VERSION >= 0x050600
+        QVector<QTextLayout::FormatRange> ranges = block.layout()->formats();
+#else
+        QVector<QTextLayout::FormatRange> ranges = block.layout()->additionalFormats().toVector();
+#endif
+        std::sort (ranges.begin(), ranges.end(), [] (const QTextLayout::FormatRange &a, const QTextLayout::FormatRange &b) {
+            return a.start < b.start || (a.start == b.start && a.length < b.length);
+        });
+        foreach (const QTextLayout::FormatRange &range, ranges)
+        {
+            const QString format = formatToString (range.format);
+            if (range.length > 0 && !format.isEmpty())
+                lines << QString ("  %1+%2%3").arg (range.start).arg (range.length).arg (format);
+        }
+    }
+    return lines;
+}
+/*************************/
+void TestHighlighter::addSamples()
+{
+    QTest::addColumn<QString>("lang");
+    QTest::addColumn<QString>("fileName");
+
+    QTest::newRow ("cpp") << "cpp" << "sample.cpp";
+    QTest::newRow ("python") << "python" << "sample.py";
+    QTest::newRow ("sh") << "sh" << "sample.sh";
+    QTest::newRow ("cmake") << "cmake" << "sample.cmake";
+    QTest::newRow ("html") << "html" << "sample.html";
+}
+/*************************/
+// The lines of a sample, repeated until there are at least "minLines" lines.
+QStringList TestHighlighter::sampleLines (const QString &fileName, int minLines)
+{
+    const QStringList lines = readSample (fileName).split ('\n');
+    QStringList res;
+    while (res.size() < minLines && !lines.isEmpty())
+        res << lines;
+    return res;
+}
+/*************************/
+void TestHighlighter::goldenFormats_data()
+{
+    addSamples();
+}
+/*************************/
+void TestHighlighter::goldenFormats()
+{
+    QFETCH (QString, lang);
+    QFETCH (QString, fileName);
+
+    const QString text = readSample (fileName);
+    QVERIFY2 (!text.isEmpty(), qPrintable ("Cannot read " + fileName));
+
+    QTextDocument doc;
+    doc.setPlainText (text);
+    Highlighter *highlighter = highlightAll (&doc, lang);
+    const bool highlighted = isHighlighted (highlighter);
+    const QStringList actual = describeFormats (&doc);
+    delete highlighter;
+    QVERIFY2 (highlighted, "The highlighting isn't finished in a minute.");
+
+    QFile golden (QString (GOLDEN) + "/" + lang + ".golden");
+    if (qEnvironmentVariableIsSet ("FEATHERPAD_UPDATE_GOLDEN"))
+    {
+        QDir().mkpath (QString (GOLDEN));
+        QVERIFY (golden.open (QIODevice::WriteOnly | QIODevice::Truncate));
+        golden.write (actual.join ("\n").toUtf8() + "\n");
+        golden.close();
+        QSKIP ("The golden file is written.");
+    }
+    if (!golden.exists())
+        QEXPECT_FAIL ("", "There is no golden file; set FEATHERPAD_UPDATE_GOLDEN to write it.", Abort);
+    QVERIFY (golden.open (QIODevice::ReadOnly));
+
+    QStringList expected = QString::fromUtf8 (golden.readAll()).split ("\n");
+    if (!expected.isEmpty() && expected.last().isEmpty())
+        expected.removeLast();
+    QCOMPARE (actual, expected);
+}
+/*************************/
+void TestHighlighter::highlightingCost_data()
+{
+    addSamples();
+}
+/*************************/
+// The time and allocations of highlighting a big text, per line.
+void TestHighlighter::highlightingCost()
+{
+    if (!benchmarksEnabled())
+        QSKIP ("Set FEATHERPAD_BENCHMARKS to run the benchmarks.");
+
+    QFETCH (QString, lang);
+    QFETCH (QString, fileName);
+
+    const QString sample = readSample (fileName);
+    QVERIFY (!sample.isEmpty());
+    const int sampleLines = sample.count ('\n') + 1;
+    QString text;
+    int lines = 0;
+    while (lines < 20000)
+    {
+        text += sample;
+        lines += sampleLines;
+    }
+
+    QTextDocument doc;
+    doc.setPlainText (text);
+    lines = doc.blockCount();
+
+    QElapsedTimer timer;
+    const Allocations before = allocationsSoFar();
+    timer.start();
+    Highlighter *highlighter = highlightAll (&doc, lang);
+    const qint64 nsecs = timer.nsecsElapsed();
+    const Allocations after = allocationsSoFar();
+    const bool highlighted = isHighlighted (highlighter);
+    delete highlighter;
+    QVERIFY2 (highlighted, "The highlighting isn't finished in a minute.");
+
+    qDebug ("%s: %d lines, %.2f us/line, %.2f allocations/line, %.0f allocated bytes/line",
+            qPrintable (lang), lines,
+            static_cast<double>(nsecs) / 1000.0 / lines,
+            static_cast<double>(after.count - before.count) / lines,
+            static_cast<double>(after.bytes - before.bytes) / lines);
+    if (!countsAllocations())
+        qDebug ("(allocations aren't counted on this system)");
+}
+
+/*************************/
+void TestHighlighter::keywordMatching_data()
+{
+    QTest::addColumn<QString>("lang");
+    QTest::addColumn<QString>("fileName");
+
+    QTest::newRow ("cpp") << "cpp" << "sample.cpp";
+    QTest::newRow ("cmake") << "cmake" << "sample.cmake";
+    QTest::newRow ("sh") << "sh" << "sample.sh";
+}
+/*************************/
+/* The time of finding keywords with "\\b(word1|word2|...)\\b" patterns, as before, and with
+   hashes of words, as now. Only the matching is timed, not the formatting. The numbers of
+   matches may differ a little because the old patterns had no other condition. */
+void TestHighlighter::keywordMatching()
+{
+    if (!benchmarksEnabled())
+        QSKIP ("Set FEATHERPAD_BENCHMARKS to run the benchmarks.");
+
+    QFETCH (QString, lang);
+    QFETCH (QString, fileName);
+
+    const QStringList lines = sampleLines (fileName, 20000);
+    QVERIFY (!lines.isEmpty());
+
+    QTextDocument doc; // only for having the rules
+    Highlighter *highlighter = new Highlighter (&doc, lang, QTextCursor (&doc), QTextCursor (&doc), false);
+    QVector<Highlighter::HighlightingRule> rules;
+    QVector<QRegExp> alternations;
+    foreach (const Highlighter::HighlightingRule &rule, highlighter->highlightingRules)
+    {
+        if (rule.keywords.isEmpty()) continue;
+        rules << rule;
+        alternations << QRegExp ("\\b(" + QStringList (rule.keywords.toList()).join ("|") + ")\\b");
+    }
+    delete highlighter;
+    QVERIFY (!rules.isEmpty());
+
+    QElapsedTimer timer;
+    int oldMatches = 0;
+    timer.start();
+    foreach (const QString &line, lines)
+    {
+        for (int i = 0; i < alternations.size(); ++i)
+        {
+            QRegExp expression (alternations.at (i)); // the old code copied it for each block
+            int index = expression.indexIn (line);
+            while (index >= 0)
+            {
+                ++oldMatches;
+                index = expression.indexIn (line, index + qMax (expression.matchedLength(), 1));
+            }
+        }
+    }
+    const qint64 oldNsecs = timer.nsecsElapsed();
+
+    int newMatches = 0;
+    QVector<Highlighter::WordPos> words;
+    timer.restart();
+    foreach (const QString &line, lines)
+    {
+        Highlighter::findWords (line, words);
+        foreach (const Highlighter::HighlightingRule &rule, rules)
+        {
+            foreach (const Highlighter::WordPos &w, words)
+            {
+                if (rule.keywords.contains (QString::fromRawData (line.constData() + w.start, w.length)))
+                    ++newMatches;
+            }
+        }
+    }
+    const qint64 newNsecs = timer.nsecsElapsed();
+
+    qDebug ("%s: %d keyword rules, %d lines; alternations %.2f us/line (%d matches), "
+            "hashes %.2f us/line (%d matches)",
+            qPrintable (lang), rules.size(), lines.size(),
+            static_cast<double>(oldNsecs) / 1000.0 / lines.size(), oldMatches,
+            static_cast<double>(newNsecs) / 1000.0 / lines.size(), newMatches);
+}
+
+/*************************/
+void TestHighlighter::ruleMatching_data()
+{
+    addSamples();
+}
+/*************************/
+/* The time of matching the regex rules of a language with QRegExp, as before, and with
+   the compiled QRegularExpression patterns, as now. The rules that QRegExp can't parse
+   (e.g., with lookbehinds) are left out of both. Only the matching is timed. */
+void TestHighlighter::ruleMatching()
+{
+    if (!benchmarksEnabled())
+        QSKIP ("Set FEATHERPAD_BENCHMARKS to run the benchmarks.");
+
+    QFETCH (QString, lang);
+    QFETCH (QString, fileName);
+
+    const QStringList lines = sampleLines (fileName, 20000);
+    QVERIFY (!lines.isEmpty());
+
+    QTextDocument doc; // only for having the rules
+    Highlighter *highlighter = new Highlighter (&doc, lang, QTextCursor (&doc), QTextCursor (&doc), false);
+    QVector<QRegularExpression> patterns;
+    QVector<QRegExp> oldPatterns;
+    int skipped = 0;
+    foreach (const Highlighter::HighlightingRule &rule, highlighter->highlightingRules)
+    {
+        if (!rule.keywords.isEmpty()) continue;
+        QRegExp exp (rule.pattern.pattern());
+        if (!exp.isValid())
+        {
+            ++skipped;
+            continue;
+        }
+        patterns << rule.pattern;
+        oldPatterns << exp;
+    }
+    delete highlighter;
+    QVERIFY (!patterns.isEmpty());
+
+    QElapsedTimer timer;
+    int oldMatches = 0;
+    timer.start();
+    foreach (const QString &line, lines)
+    {
+        for (int i = 0; i < oldPatterns.size(); ++i)
+        {
+            QRegExp expression (oldPatterns.at (i)); // the old code copied it for each block
+            int index = expression.indexIn (line);
+            while (index >= 0)
+            {
+                ++oldMatches;
+                index = expression.indexIn (line, index + qMax (expression.matchedLength(), 1));
+            }
+        }
+    }
+    const qint64 oldNsecs = timer.nsecsElapsed();
+
+    int newMatches = 0;
+    timer.restart();
+    foreach (const QString &line, lines)
+    {
+        foreach (const QRegularExpression &pattern, patterns)
+        {
+            QRegularExpressionMatchIterator it = pattern.globalMatch (line);
+            while (it.hasNext())
+            {
+                it.next();
+                ++newMatches;
+            }
+        }
+    }
+    const qint64 newNsecs = timer.nsecsElapsed();
+
+    qDebug ("%s: %d regex rules (%d skipped), %d lines; QRegExp %.2f us/line (%d matches), "
+            "QRegularExpression %.2f us/line (%d matches)",
+            qPrintable (lang), patterns.size(), skipped, lines.size(),
+            static_cast<double>(oldNsecs) / 1000.0 / lines.size(), oldMatches,
+            static_cast<double>(newNsecs) / 1000.0 / lines.size(), newMatches);
+}
+
+/*************************/
+/* The block data as it was before TextBlockData was made compact, only for
+   measuring its memory: a heap object per block with vectors of separately
+   allocated parentheses and braces, which were kept in order by insertion. */
+struct OldBracketInfo
+{
+    char character;
+    int position;
+};
+
+class OldTextBlockData : public QTextBlockUserData
+{
+public:
+    OldTextBlockData() { Highlighted = false; OpenNests = 0; }
+    ~OldTextBlockData() {
+        qDeleteAll (allParentheses);
+        qDeleteAll (allBraces);
+    }
+    void insertInfo (char character, int position) {
+        if (character != '(' && character != ')' && character != '{' && character != '}')
+            return; // square brackets weren't matched
+        QVector<OldBracketInfo *> &infos = character == '(' || character == ')'
+                                           ? allParentheses : allBraces;
+        OldBracketInfo *info = new OldBracketInfo;
+        info->character = character;
+        info->position = position;
+        int i = 0;
+        while (i < infos.size() && position > infos.at (i)->position)
+            ++i;
+        infos.insert (i, info);
+    }
+    void insertInfo (const QString &str) {
+        Delimiter = str;
+    }
+
+private:
+    QVector<OldBracketInfo *> allParentheses;
+    QVector<OldBracketInfo *> allBraces;
+    QString Delimiter;
+    bool Highlighted;
+    int OpenNests;
+};
+/*************************/
+void TestHighlighter::blockMemory_data()
+{
+    addSamples();
+}
+/*************************/
+/* The heap memory that highlighting keeps per block: all of it (with the formats that
+   QTextLayout keeps) and that of the chunks of TextBlockData, which hold the brackets
+   inline unless there are more than the reserved ones in a block. Then, the block data
+   are copied to new TextBlockData objects and to objects with the old layout, and the
+   memory and allocations of both copies are measured. */
+void TestHighlighter::blockMemory()
+{
+    if (!benchmarksEnabled())
+        QSKIP ("Set FEATHERPAD_BENCHMARKS to run the benchmarks.");
+    if (!countsAllocations())
+        QSKIP ("Allocations aren't counted on this system.");
+
+    QFETCH (QString, lang);
+    QFETCH (QString, fileName);
+
+    QTextDocument doc;
+    doc.setPlainText (sampleLines (fileName, 20000).join ("\n"));
+    const int blocks = doc.blockCount();
+
+    const Allocations before = allocationsSoFar();
+    Highlighter *highlighter = highlightAll (&doc, lang);
+    const Allocations after = allocationsSoFar();
+    if (!isHighlighted (highlighter))
+    {
+        delete highlighter;
+        QFAIL ("The highlighting isn't finished in a minute.");
+    }
+
+    const int reserved = TextBlockData::Brackets().capacity();
+    int spilled = 0; // blocks with more brackets than the reserved ones
+    for (QTextBlock block = doc.firstBlock(); block.isValid(); block = block.next())
+    {
+        const TextBlockData *data = static_cast<TextBlockData *>(block.userData());
+        if (data && data->brackets().size() > reserved)
+            ++spilled;
+    }
+
+    QVector<TextBlockData *> newCopies;
+    QVector<OldTextBlockData *> oldCopies;
+    newCopies.reserve (blocks);
+    oldCopies.reserve (blocks);
+    const Allocations newBefore = allocationsSoFar();
+    for (QTextBlock block = doc.firstBlock(); block.isValid(); block = block.next())
+    {
+        const TextBlockData *data = static_cast<TextBlockData *>(block.userData());
+        TextBlockData *copy = new TextBlockData;
+        foreach (const BracketInfo &info, data->brackets())
+            copy->insertInfo (info.character, info.position);
+        copy->insertInfo (data->delimiter());
+        newCopies << copy;
+    }
+    const Allocations newAfter = allocationsSoFar();
+    for (QTextBlock block = doc.firstBlock(); block.isValid(); block = block.next())
+    {
+        const TextBlockData *data = static_cast<TextBlockData *>(block.userData());
+        OldTextBlockData *copy = new OldTextBlockData;
+        foreach (const BracketInfo &info, data->brackets())
+            copy->insertInfo (info.character, info.position);
+        copy->insertInfo (data->delimiter());
+        oldCopies << copy;
+    }
+    const Allocations oldAfter = allocationsSoFar();
+    qDeleteAll (newCopies);
+    qDeleteAll (oldCopies);
+    delete highlighter;
+
+    const int chunks = (blocks + 1023) / 1024; // see blockDataChunk in highlighter.cpp
+    qDebug ("%s: %d blocks; %.1f kept bytes/block; TextBlockData is %d bytes, "
+            "%.1f bytes/block in its chunks; %d blocks with extra brackets",
+            qPrintable (lang), blocks,
+            static_cast<double>(after.liveBytes - before.liveBytes) / blocks,
+            static_cast<int>(sizeof (TextBlockData)),
+            static_cast<double>(chunks) * 1024 * sizeof (TextBlockData) / blocks,
+            spilled);
+    qDebug ("%s: the same block data take %.1f bytes/block in %.2f allocations/block now "
+            "and %.1f bytes/block in %.2f allocations/block with the old layout",
+            qPrintable (lang),
+            static_cast<double>(newAfter.liveBytes - newBefore.liveBytes) / blocks,
+            static_cast<double>(newAfter.count - newBefore.count) / blocks,
+            static_cast<double>(oldAfter.liveBytes - newAfter.liveBytes) / blocks,
+            static_cast<double>(oldAfter.count - newAfter.count) / blocks);
+}
+
+}
+
+int main (int argc, char **argv)
+{
+    if (qEnvironmentVariableIsEmpty ("QT_QPA_PLATFORM"))
+        qputenv ("QT_QPA_PLATFORM", "offscreen");
+    QGuiApplication app (argc, argv);
+    FeatherPad::TestHighlighter test;
+    return QTest::qExec (&test, argc, argv);
+}
+
+#include "tst_highlighter.moc"
@@ -0,0 +1,24 @@
+CONFIG += qt \
+          warn_on \
+          testcase
+QT += core \
+      concurrent \
+      testlib
+
+TARGET = tst_loading
+TEMPLATE = app
+CONFIG += c++11
+
+SRCDIR = ../../featherpad
+INCLUDEPATH += $$SRCDIR ../common
+
+SOURCES += tst_loading.cpp \
+           ../common/allocations.cpp \
+           $$SRCDIR/loading.cpp \
+           $$SRCDIR/encoding.cpp \
+           $$SRCDIR/largefile.cpp
+
+HEADERS += ../common/allocations.h \
+           $$SRCDIR/loading.h \
+           $$SRCDIR/encoding.h \
+           $$SRCDIR/largefile.h
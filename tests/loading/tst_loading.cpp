@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014 <tsujan2000@gmail.com>
+ *
+ * FeatherPad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FeatherPad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QtTest>
+#include <QTemporaryDir>
+#include <QElapsedTimer>
+#include "loading.h"
+#include "allocations.h"
+
+/* The benchmarks are skipped unless FEATHERPAD_BENCHMARKS is set because they
+   write big files to the temporary directory. They print their results with qDebug(). */
+
+namespace FeatherPad {
+
+class TestLoading : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void loaderSpeed_data();
+    void loaderSpeed();
+};
+
+// Writes a text file of about "mib" MiB and returns its length in UTF-16 code units.
+static qint64 writeText (const QString &fileName, int mib)
+{
+    QFile file (fileName);
+    if (!file.open (QIODevice::WriteOnly)) return -1;
+    QByteArray block;
+    qint64 length = 0;
+    int n = 0;
+    while (block.size() < 1024*1024 - 100)
+    {
+        QByteArray line = "Line " + QByteArray::number (n++) + ": the quick brown fox jumps over the lazy dog";
+        if (n % 10 == 0)
+        {
+            line += " (caf\xc3\xa9)"; // some non-ASCII text
+            length -= 1; // two bytes for one character
+        }
+        line += "\n";
+        block += line;
+    }
+    length += block.size();
+    for (int i = 0; i < mib; ++i)
+    {
+        if (file.write (block) != block.size())
+            return -1;
+    }
+    return length * mib;
+}
+/*************************/
+// The loop of Loading::run() before the file was read in chunks.
+static QByteArray readByteByByte (const QString &fileName, bool &hasNull)
+{
+    QByteArray data;
+    hasNull = false;
+    QFile file (fileName);
+    if (!file.open (QFile::ReadOnly)) return data;
+    char c;
+    while (file.read (&c, sizeof (char)) > 0)
+    {
+        data.append (c);
+        if (c == '\0' && !hasNull)
+            hasNull = true;
+    }
+    return data;
+}
+/*************************/
+void TestLoading::loaderSpeed_data()
+{
+    QTest::addColumn<int>("mib");
+
+    QTest::newRow ("10 MiB") << 10;
+    QTest::newRow ("100 MiB") << 100;
+    QTest::newRow ("450 MiB") << 450;
+}
+/*************************/
+// The time of reading a file byte by byte, in comparison with the whole work of Loading.
+void TestLoading::loaderSpeed()
+{
+    if (!qEnvironmentVariableIsSet ("FEATHERPAD_BENCHMARKS"))
+        QSKIP ("Set FEATHERPAD_BENCHMARKS to run the benchmarks.");
+
+    QFETCH (int, mib);
+
+    QTemporaryDir dir;
+    QVERIFY (dir.isValid());
+    const QString fileName = dir.path() + "/text";
+    const qint64 length = writeText (fileName, mib);
+    QVERIFY2 (length > 0, "Cannot write the test file.");
+
+    QElapsedTimer timer;
+    Allocations before = allocationsSoFar();
+    timer.start();
+    bool hasNull;
+    qint64 bytes = readByteByByte (fileName, hasNull).size();
+    const qint64 oldMsecs = timer.elapsed();
+    Allocations after = allocationsSoFar();
+    const long long oldAllocations = after.count - before.count;
+    QVERIFY (!hasNull);
+    QCOMPARE (bytes, QFileInfo (fileName).size());
+
+    /* Loading sends big texts in chunks; the signals are received in its thread */
+    qint64 loaded = 0;
+    Loading loading (fileName, QString(), false, false);
+    connect (&loading, &Loading::completed, this, [&loaded] (const QString str) {
+        loaded += str.length();
+    }, Qt::DirectConnection);
+    connect (&loading, &Loading::chunkLoaded, this, [&loaded] (const QString chunk) {
+        loaded += chunk.length();
+    }, Qt::DirectConnection);
+    before = allocationsSoFar();
+    timer.restart();
+    loading.start();
+    QVERIFY (loading.wait());
+    const qint64 newMsecs = timer.elapsed();
+    after = allocationsSoFar();
+    QCOMPARE (loaded, length);
+
+    qDebug ("%d MiB: byte-by-byte reading %lld ms (%lld allocations); "
+            "reading, detection and decoding by Loading %lld ms (%lld allocations)",
+            mib, oldMsecs, oldAllocations, newMsecs, after.count - before.count);
+}
+
+}
+
+QTEST_GUILESS_MAIN (FeatherPad::TestLoading)
+
+#include "tst_loading.moc"